@@ -0,0 +1,179 @@
+//
+//  YYBoxBlur.c
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/18.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#include "YYBoxBlur.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define YY_BLUR_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define YY_BLUR_SSE2 1
+#endif
+
+// A pixel with 4 channels (8 bits per channel) in 32-bit lanes. All the paths store
+// the average as (uint8_t)(sum * scale + 0.5f), so they give the same result.
+#if YY_BLUR_NEON
+typedef uint32x4_t _YYBlurVec;
+static inline _YYBlurVec _YYBlurLoad(const uint8_t *p) {
+    uint8x8_t v = vreinterpret_u8_u32(vld1_dup_u32((const uint32_t *)(const void *)p));
+    return vmovl_u16(vget_low_u16(vmovl_u8(v)));
+}
+static inline _YYBlurVec _YYBlurAdd(_YYBlurVec a, _YYBlurVec b) { return vaddq_u32(a, b); }
+static inline _YYBlurVec _YYBlurSub(_YYBlurVec a, _YYBlurVec b) { return vsubq_u32(a, b); }
+static inline void _YYBlurStore(uint8_t *p, _YYBlurVec sum, float scale) {
+    uint32x4_t v = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(vcvtq_f32_u32(sum), scale), vdupq_n_f32(0.5f)));
+    uint8x8_t b = vmovn_u16(vcombine_u16(vmovn_u32(v), vdup_n_u16(0)));
+    vst1_lane_u32((uint32_t *)(void *)p, vreinterpret_u32_u8(b), 0);
+}
+#elif YY_BLUR_SSE2
+typedef __m128i _YYBlurVec;
+static inline _YYBlurVec _YYBlurLoad(const uint8_t *p) {
+    uint32_t pixel;
+    memcpy(&pixel, p, 4);
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pixel), zero), zero);
+}
+static inline _YYBlurVec _YYBlurAdd(_YYBlurVec a, _YYBlurVec b) { return _mm_add_epi32(a, b); }
+static inline _YYBlurVec _YYBlurSub(_YYBlurVec a, _YYBlurVec b) { return _mm_sub_epi32(a, b); }
+static inline void _YYBlurStore(uint8_t *p, _YYBlurVec sum, float scale) {
+    __m128i v = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(scale)), _mm_set1_ps(0.5f)));
+    v = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+    uint32_t pixel = (uint32_t)_mm_cvtsi128_si32(v);
+    memcpy(p, &pixel, 4);
+}
+#else
+typedef struct { uint32_t c[4]; } _YYBlurVec;
+static inline _YYBlurVec _YYBlurLoad(const uint8_t *p) {
+    _YYBlurVec v = {{p[0], p[1], p[2], p[3]}};
+    return v;
+}
+static inline _YYBlurVec _YYBlurAdd(_YYBlurVec a, _YYBlurVec b) {
+    for (int i = 0; i < 4; i++) a.c[i] += b.c[i];
+    return a;
+}
+static inline _YYBlurVec _YYBlurSub(_YYBlurVec a, _YYBlurVec b) {
+    for (int i = 0; i < 4; i++) a.c[i] -= b.c[i];
+    return a;
+}
+static inline void _YYBlurStore(uint8_t *p, _YYBlurVec sum, float scale) {
+    for (int i = 0; i < 4; i++) {
+        float value = sum.c[i] * scale; // not fused with the add below, same as the SIMD paths
+        p[i] = (uint8_t)(value + 0.5f);
+    }
+}
+#endif
+
+static inline size_t _YYBlurMin(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+/// Box blurs a row of `count` pixels with edge extend, and writes the result to `dst`
+/// with `dstStride` bytes between pixels (so a row can be written as a column).
+static void _YYBoxBlurRow(const uint8_t *src, uint8_t *dst, size_t count, size_t dstStride, size_t radius) {
+    float scale = 1.0f / (radius * 2 + 1);
+    size_t last = count - 1;
+    _YYBlurVec sum = _YYBlurLoad(src);
+    for (size_t i = 0; i < radius; i++) {
+        sum = _YYBlurAdd(sum, _YYBlurLoad(src));
+        sum = _YYBlurAdd(sum, _YYBlurLoad(src + (i + 1 > last ? last : i + 1) * 4));
+    }
+    for (size_t x = 0; x < count; x++) {
+        _YYBlurStore(dst + x * dstStride, sum, scale);
+        size_t add = x + radius + 1 > last ? last : x + radius + 1;
+        size_t sub = x < radius ? 0 : x - radius;
+        sum = _YYBlurSub(_YYBlurAdd(sum, _YYBlurLoad(src + add * 4)), _YYBlurLoad(src + sub * 4));
+    }
+}
+
+/// Box blurs a bitmap (in place) horizontally then vertically, `temp` should have
+/// `width * height * 4` bytes.
+static void _YYBoxBlur(uint8_t *data, size_t width, size_t height, size_t bytesPerRow, uint8_t *temp, size_t radius) {
+    for (size_t y = 0; y < height; y++) { // rows of data -> columns of temp
+        _YYBoxBlurRow(data + y * bytesPerRow, temp + y * 4, width, height * 4, radius);
+    }
+    for (size_t x = 0; x < width; x++) { // rows of temp -> columns of data
+        _YYBoxBlurRow(temp + x * height * 4, data + x * 4, height, bytesPerRow, radius);
+    }
+}
+
+bool YYCGBitmapBoxBlur(void *data, size_t width, size_t height, size_t bytesPerRow, uint32_t kernelSize, uint32_t iterations) {
+    if (!data || width == 0 || height == 0 || bytesPerRow < width * 4) return false;
+    if (kernelSize < 2 || iterations == 0) return true;
+    
+    // A large kernel is applied to a downsampled bitmap: the result is smooth enough to
+    // be upsampled, and it costs 1/(factor^2) of the time.
+    size_t factor = 1;
+    while (factor < 4 && kernelSize / (factor * 2) >= 8 && width / (factor * 2) >= 4 && height / (factor * 2) >= 4) factor *= 2;
+    size_t smallWidth = (width + factor - 1) / factor;
+    size_t smallHeight = (height + factor - 1) / factor;
+    size_t radius = (kernelSize / factor) / 2;
+    if (radius < 1) radius = 1;
+    
+    uint8_t *temp = malloc(smallWidth * smallHeight * 4 * (factor > 1 ? 2 : 1));
+    if (!temp) return false;
+    if (factor == 1) {
+        for (uint32_t i = 0; i < iterations; i++) {
+            _YYBoxBlur(data, width, height, bytesPerRow, temp, radius);
+        }
+        free(temp);
+        return true;
+    }
+    
+    // downsample (box average)
+    uint8_t *small = temp + smallWidth * smallHeight * 4;
+    for (size_t sy = 0; sy < smallHeight; sy++) {
+        size_t y0 = sy * factor, y1 = _YYBlurMin(y0 + factor, height);
+        for (size_t sx = 0; sx < smallWidth; sx++) {
+            size_t x0 = sx * factor, x1 = _YYBlurMin(x0 + factor, width);
+            uint32_t sum[4] = {0};
+            for (size_t y = y0; y < y1; y++) {
+                const uint8_t *p = (const uint8_t *)data + y * bytesPerRow + x0 * 4;
+                for (size_t x = x0; x < x1; x++, p += 4) {
+                    sum[0] += p[0]; sum[1] += p[1]; sum[2] += p[2]; sum[3] += p[3];
+                }
+            }
+            uint32_t count = (uint32_t)((y1 - y0) * (x1 - x0));
+            uint8_t *s = small + (sy * smallWidth + sx) * 4;
+            for (int c = 0; c < 4; c++) s[c] = (sum[c] + count / 2) / count;
+        }
+    }
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        _YYBoxBlur(small, smallWidth, smallHeight, smallWidth * 4, temp, radius);
+    }
+    
+    // upsample (bilinear, 8-bit fixed point weights)
+    for (size_t y = 0; y < height; y++) {
+        float fy = (y + 0.5f) / factor - 0.5f;
+        if (fy < 0) fy = 0;
+        size_t y0 = (size_t)fy, y1 = _YYBlurMin(y0 + 1, smallHeight - 1);
+        uint32_t wy = (uint32_t)((fy - y0) * 256);
+        uint8_t *dst = (uint8_t *)data + y * bytesPerRow;
+        for (size_t x = 0; x < width; x++, dst += 4) {
+            float fx = (x + 0.5f) / factor - 0.5f;
+            if (fx < 0) fx = 0;
+            size_t x0 = (size_t)fx, x1 = _YYBlurMin(x0 + 1, smallWidth - 1);
+            uint32_t wx = (uint32_t)((fx - x0) * 256);
+            const uint8_t *p00 = small + (y0 * smallWidth + x0) * 4, *p01 = small + (y0 * smallWidth + x1) * 4;
+            const uint8_t *p10 = small + (y1 * smallWidth + x0) * 4, *p11 = small + (y1 * smallWidth + x1) * 4;
+            for (int c = 0; c < 4; c++) {
+                uint32_t top = p00[c] * (256 - wx) + p01[c] * wx;
+                uint32_t bottom = p10[c] * (256 - wx) + p11[c] * wx;
+                dst[c] = (top * (256 - wy) + bottom * wy + (1 << 15)) >> 16;
+            }
+        }
+    }
+    free(temp);
+    return true;
+}
@@ -0,0 +1,39 @@
+//
+//  YYBoxBlur.h
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/18.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#ifndef YYBoxBlur_h
+#define YYBoxBlur_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Blurs a 32-bit bitmap (4 channels, 8 bits per channel, e.g. premultiplied BGRA) in place 
+/// with successive box blurs (with edge extend). Returns false if an error occurs.
+///
+/// @discussion Three box blurs approximate a Gaussian blur. The function is plain C with
+/// NEON/SSE2 code (when available), it doesn't depend on any framework. A large kernel
+/// (kernelSize >= 16) is applied to a downsampled copy of the bitmap, which is then
+/// upsampled (bilinear) back, it's much faster and the difference is hardly visible.
+///
+/// @param kernelSize The box kernel size in pixels, should be odd.
+/// @param iterations The count of box blurs.
+bool YYCGBitmapBoxBlur(void *data, size_t width, size_t height, size_t bytesPerRow, uint32_t kernelSize, uint32_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YYBoxBlur_h */
@@ -14,6 +14,7 @@
 #import "NSString+YYAdd.h"
 #import "YYKitMacro.h"
 #import "YYCGUtilities.h"
+#import "YYBoxBlur.h"
 #import <ImageIO/ImageIO.h>
 #import <Accelerate/Accelerate.h>
 #import <CoreText/CoreText.h>
@@ -649,13 +650,15 @@ static NSTimeInterval _yy_CGImageSourceGetGIFFrameDelayAtIndex(CGImageSourceRef
         if (blurRadius * scale < 0.5) iterations = 1;
         else if (blurRadius * scale < 1.5) iterations = 2;
         else iterations = 3;
-        NSInteger tempSize = vImageBoxConvolve_ARGB8888(input, output, NULL, 0, 0, radius, radius, NULL, kvImageGetTempBufferSize | kvImageEdgeExtend);
-        void *temp = malloc(tempSize);
-        for (int i = 0; i < iterations; i++) {
-            vImageBoxConvolve_ARGB8888(input, output, temp, 0, 0, radius, radius, NULL, kvImageEdgeExtend);
-            YY_SWAP(input, output);
+        if (!YYCGBitmapBoxBlur(input->data, input->width, input->height, input->rowBytes, radius, iterations)) { // in place
+            NSInteger tempSize = vImageBoxConvolve_ARGB8888(input, output, NULL, 0, 0, radius, radius, NULL, kvImageGetTempBufferSize | kvImageEdgeExtend);
+            void *temp = malloc(tempSize);
+            for (int i = 0; i < iterations; i++) {
+                vImageBoxConvolve_ARGB8888(input, output, temp, 0, 0, radius, radius, NULL, kvImageEdgeExtend);
+                YY_SWAP(input, output);
+            }
+            free(temp);
         }
-        free(temp);
     }
     
     
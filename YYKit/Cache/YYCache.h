@@ -11,7 +11,7 @@
 
 #import <Foundation/Foundation.h>
 
-@class YYMemoryCache, YYDiskCache;
+@class YYMemoryCache, YYDiskCache, YYCacheStatistics;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -33,6 +33,13 @@ NS_ASSUME_NONNULL_BEGIN
 /** The underlying disk cache. see `YYDiskCache` for more information.*/
 @property (strong, readonly) YYDiskCache *diskCache;
 
+/**
+ The statistics of the two-level cache, a read hits if the object is found in
+ either the memory cache or the disk cache. See `memoryCache.statistics` and
+ `diskCache.statistics` for each level (and the evictions).
+ */
+@property (strong, readonly) YYCacheStatistics *statistics;
+
 /**
  Create a new instance with the specified name.
  Multiple instances with the same name will make the cache unstable.
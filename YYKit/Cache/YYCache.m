@@ -12,6 +12,8 @@
 #import "YYCache.h"
 #import "YYMemoryCache.h"
 #import "YYDiskCache.h"
+#import "YYCacheStatistics.h"
+#import <QuartzCore/QuartzCore.h>
 
 @implementation YYCache
 
@@ -39,6 +41,7 @@
     _name = name;
     _diskCache = diskCache;
     _memoryCache = memoryCache;
+    _statistics = [YYCacheStatistics new];
     return self;
 }
 
@@ -67,6 +70,8 @@
 }
 
 - (id<NSCoding>)objectForKey:(NSString *)key {
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
     id<NSCoding> object = [_memoryCache objectForKey:key];
     if (!object) {
         object = [_diskCache objectForKey:key];
@@ -74,6 +79,8 @@
             [_memoryCache setObject:object forKey:key];
         }
     }
+    [_statistics recordReadWithHit:object != nil bytes:0];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRead];
     return object;
 }
 
@@ -81,6 +88,7 @@
     if (!block) return;
     id<NSCoding> object = [_memoryCache objectForKey:key];
     if (object) {
+        [_statistics recordReadWithHit:YES bytes:0];
         dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
             block(key, object);
         });
@@ -89,27 +97,38 @@
             if (object && ![_memoryCache objectForKey:key]) {
                 [_memoryCache setObject:object forKey:key];
             }
+            [_statistics recordReadWithHit:object != nil bytes:0];
             block(key, object);
         }];
     }
 }
 
 - (void)setObject:(id<NSCoding>)object forKey:(NSString *)key {
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
     [_memoryCache setObject:object forKey:key];
     [_diskCache setObject:object forKey:key];
+    [_statistics recordWriteWithBytes:0];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationWrite];
 }
 
 - (void)setObject:(id<NSCoding>)object forKey:(NSString *)key withBlock:(void (^)(void))block {
+    [_statistics recordWriteWithBytes:0];
     [_memoryCache setObject:object forKey:key];
     [_diskCache setObject:object forKey:key withBlock:block];
 }
 
 - (void)removeObjectForKey:(NSString *)key {
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
     [_memoryCache removeObjectForKey:key];
     [_diskCache removeObjectForKey:key];
+    [_statistics recordRemoveCount:1];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRemove];
 }
 
 - (void)removeObjectForKey:(NSString *)key withBlock:(void (^)(NSString *key))block {
+    [_statistics recordRemoveCount:1];
     [_memoryCache removeObjectForKey:key];
     [_diskCache removeObjectForKey:key withBlock:block];
 }
@@ -0,0 +1,141 @@
+//
+//  YYCacheStatistics.h
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/17.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The cache operations which have latency statistics.
+ */
+typedef NS_ENUM(NSUInteger, YYCacheOperation) {
+    YYCacheOperationRead = 0, ///< objectForKey:
+    YYCacheOperationWrite,    ///< setObject:forKey:
+    YYCacheOperationRemove,   ///< removeObjectForKey:
+};
+
+/// The bucket count of latency histogram.
+/// The bucket `i` counts the operations which take less than 2^i microseconds
+/// (and not less than 2^(i-1)), the last bucket counts all the slower operations.
+extern const NSUInteger YYCacheLatencyHistogramBucketCount;
+
+
+/**
+ YYCacheStatistics holds the counters of a cache instance.
+ 
+ @discussion The counters are updated with atomic operations, without any lock,
+ so it's cheap to keep them always on. They are striped by thread (each stripe in
+ its own cache line) and added up when read, so the concurrent operations don't
+ contend for one counter. The latency is only recorded when
+ `recordsLatency` is YES, because it needs to read the clock twice for each
+ operation.
+ 
+ Use `snapshot` to get a copy for logging or reporting, and `reset`
+ to start a new period.
+ */
+@interface YYCacheStatistics : NSObject <NSCopying>
+
+#pragma mark - Counter
+///=============================================================================
+/// @name Counter
+///=============================================================================
+
+/** The count of reads which found the object. */
+@property (readonly) int64_t hitCount;
+
+/** The count of reads which did not find the object. */
+@property (readonly) int64_t missCount;
+
+/** The count of writes. */
+@property (readonly) int64_t writeCount;
+
+/** The count of removes called by user (not including eviction). */
+@property (readonly) int64_t removeCount;
+
+/** The count of objects evicted by the limits or trim methods. */
+@property (readonly) int64_t evictionCount;
+
+/** The bytes of the objects read (0 for memory cache, the cost is not bytes). */
+@property (readonly) int64_t bytesRead;
+
+/** The bytes of the objects written (0 for memory cache, the cost is not bytes). */
+@property (readonly) int64_t bytesWritten;
+
+/** hitCount / (hitCount + missCount), 0 if there's no read. */
+@property (readonly) double hitRate;
+
+
+#pragma mark - Latency
+///=============================================================================
+/// @name Latency
+///=============================================================================
+
+/**
+ Whether to record the latency of operations. Default is NO.
+ */
+@property BOOL recordsLatency;
+
+/**
+ The average latency of an operation in seconds, 0 if there's no record.
+ 
+ @param operation The operation.
+ */
+- (NSTimeInterval)averageLatencyForOperation:(YYCacheOperation)operation;
+
+/**
+ The latency histogram of an operation.
+ 
+ @param operation The operation.
+ @return An array of `YYCacheLatencyHistogramBucketCount` numbers (int64_t),
+    see `YYCacheLatencyHistogramBucketCount`.
+ */
+- (NSArray<NSNumber *> *)latencyHistogramForOperation:(YYCacheOperation)operation;
+
+
+#pragma mark - Snapshot
+///=============================================================================
+/// @name Snapshot
+///=============================================================================
+
+/**
+ Returns a copy of current statistics, which is not changed by the cache.
+ */
+- (YYCacheStatistics *)snapshot;
+
+/**
+ Set all the counters to zero.
+ */
+- (void)reset;
+
+
+#pragma mark - Record
+///=============================================================================
+/// @name Record (for cache implementation)
+///=============================================================================
+
+/// Record a read, bytes is 0 if unknown.
+- (void)recordReadWithHit:(BOOL)hit bytes:(int64_t)bytes;
+
+/// Record a write, bytes is 0 if unknown.
+- (void)recordWriteWithBytes:(int64_t)bytes;
+
+/// Record removes called by user.
+- (void)recordRemoveCount:(int64_t)count;
+
+/// Record evicted objects.
+- (void)recordEvictionCount:(int64_t)count;
+
+/// Record the latency of an operation, only when `recordsLatency` is YES.
+- (void)recordLatency:(NSTimeInterval)latency forOperation:(YYCacheOperation)operation;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,234 @@
+//
+//  YYCacheStatistics.m
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/17.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "YYCacheStatistics.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+
+#define kBucketCount 21
+#define kOperationCount 3
+#define kStripeCount 16
+#define kStripeAlignment 128 // cache line size of arm64, and twice of x86
+
+const NSUInteger YYCacheLatencyHistogramBucketCount = kBucketCount;
+
+static inline int64_t _YYAtomicLoad(volatile int64_t *value) {
+    return OSAtomicAdd64(0, value);
+}
+
+static inline void _YYAtomicStore(volatile int64_t *value, int64_t newValue) {
+    int64_t old;
+    do {
+        old = *value;
+    } while (!OSAtomicCompareAndSwap64(old, newValue, value));
+}
+
+/**
+ The counters updated by each operation. They are striped by thread, each stripe
+ is in its own cache line, so the threads don't contend for one counter.
+ */
+typedef struct {
+    int64_t hitCount;
+    int64_t missCount;
+    int64_t writeCount;
+    int64_t removeCount;
+    int64_t evictionCount;
+    int64_t bytesRead;
+    int64_t bytesWritten;
+} __attribute__((aligned(kStripeAlignment))) _YYCacheCounterStripe;
+
+/**
+ The stripe of current thread. Each thread takes the next stripe the first time
+ it's called (round-robin), so the threads are spread evenly. The index is stored
+ plus 1 in a thread specific value, as 0 means not assigned.
+ */
+static inline NSUInteger _YYCounterStripeIndex() {
+    static pthread_key_t key;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&key, NULL);
+    });
+    uintptr_t index = (uintptr_t)pthread_getspecific(key);
+    if (index == 0) {
+        static volatile int32_t nextIndex = 0;
+        index = (uint32_t)OSAtomicIncrement32(&nextIndex) % kStripeCount + 1;
+        pthread_setspecific(key, (void *)index);
+    }
+    return index - 1;
+}
+
+static inline NSUInteger _YYLatencyBucket(int64_t nanoseconds) {
+    int64_t microseconds = nanoseconds / 1000;
+    NSUInteger bucket = 0;
+    while (bucket < kBucketCount - 1 && microseconds >= ((int64_t)1 << bucket)) bucket++;
+    return bucket;
+}
+
+/// Sum of a counter of all stripes.
+#define YYCounterSum(stripes, counter) ({ \
+    int64_t __sum = 0; \
+    for (NSUInteger __i = 0; __i < kStripeCount; __i++) __sum += _YYAtomicLoad(&stripes[__i].counter); \
+    __sum; })
+
+@implementation YYCacheStatistics {
+    _YYCacheCounterStripe *_stripes; ///< kStripeCount stripes
+    int64_t _latencyCount[kOperationCount];
+    int64_t _latencyTotal[kOperationCount]; ///< nanoseconds
+    int64_t _histogram[kOperationCount][kBucketCount];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) return nil;
+    void *stripes = NULL;
+    if (posix_memalign(&stripes, kStripeAlignment, sizeof(_YYCacheCounterStripe) * kStripeCount) != 0) return nil;
+    memset(stripes, 0, sizeof(_YYCacheCounterStripe) * kStripeCount);
+    _stripes = stripes;
+    return self;
+}
+
+- (void)dealloc {
+    free(_stripes);
+}
+
+- (int64_t)hitCount {
+    return YYCounterSum(_stripes, hitCount);
+}
+
+- (int64_t)missCount {
+    return YYCounterSum(_stripes, missCount);
+}
+
+- (int64_t)writeCount {
+    return YYCounterSum(_stripes, writeCount);
+}
+
+- (int64_t)removeCount {
+    return YYCounterSum(_stripes, removeCount);
+}
+
+- (int64_t)evictionCount {
+    return YYCounterSum(_stripes, evictionCount);
+}
+
+- (int64_t)bytesRead {
+    return YYCounterSum(_stripes, bytesRead);
+}
+
+- (int64_t)bytesWritten {
+    return YYCounterSum(_stripes, bytesWritten);
+}
+
+- (double)hitRate {
+    int64_t hit = self.hitCount;
+    int64_t total = hit + self.missCount;
+    return total > 0 ? (double)hit / total : 0;
+}
+
+- (NSTimeInterval)averageLatencyForOperation:(YYCacheOperation)operation {
+    if (operation >= kOperationCount) return 0;
+    int64_t count = _YYAtomicLoad(&_latencyCount[operation]);
+    if (count == 0) return 0;
+    return _YYAtomicLoad(&_latencyTotal[operation]) / (double)count / NSEC_PER_SEC;
+}
+
+- (NSArray<NSNumber *> *)latencyHistogramForOperation:(YYCacheOperation)operation {
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:kBucketCount];
+    for (NSUInteger i = 0; i < kBucketCount; i++) {
+        int64_t count = operation < kOperationCount ? _YYAtomicLoad(&_histogram[operation][i]) : 0;
+        [histogram addObject:@(count)];
+    }
+    return histogram;
+}
+
+- (YYCacheStatistics *)snapshot {
+    return [self copy];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    YYCacheStatistics *one = [self.class new];
+    if (!one) return nil;
+    _YYCacheCounterStripe *sum = one->_stripes; // the copy keeps the sum in first stripe
+    sum->hitCount = self.hitCount;
+    sum->missCount = self.missCount;
+    sum->writeCount = self.writeCount;
+    sum->removeCount = self.removeCount;
+    sum->evictionCount = self.evictionCount;
+    sum->bytesRead = self.bytesRead;
+    sum->bytesWritten = self.bytesWritten;
+    for (NSUInteger i = 0; i < kOperationCount; i++) {
+        one->_latencyCount[i] = _YYAtomicLoad(&_latencyCount[i]);
+        one->_latencyTotal[i] = _YYAtomicLoad(&_latencyTotal[i]);
+        for (NSUInteger j = 0; j < kBucketCount; j++) {
+            one->_histogram[i][j] = _YYAtomicLoad(&_histogram[i][j]);
+        }
+    }
+    one.recordsLatency = self.recordsLatency;
+    return one;
+}
+
+- (void)reset {
+    for (NSUInteger i = 0; i < kStripeCount; i++) {
+        _YYCacheCounterStripe *stripe = _stripes + i;
+        _YYAtomicStore(&stripe->hitCount, 0);
+        _YYAtomicStore(&stripe->missCount, 0);
+        _YYAtomicStore(&stripe->writeCount, 0);
+        _YYAtomicStore(&stripe->removeCount, 0);
+        _YYAtomicStore(&stripe->evictionCount, 0);
+        _YYAtomicStore(&stripe->bytesRead, 0);
+        _YYAtomicStore(&stripe->bytesWritten, 0);
+    }
+    for (NSUInteger i = 0; i < kOperationCount; i++) {
+        _YYAtomicStore(&_latencyCount[i], 0);
+        _YYAtomicStore(&_latencyTotal[i], 0);
+        for (NSUInteger j = 0; j < kBucketCount; j++) {
+            _YYAtomicStore(&_histogram[i][j], 0);
+        }
+    }
+}
+
+- (void)recordReadWithHit:(BOOL)hit bytes:(int64_t)bytes {
+    _YYCacheCounterStripe *stripe = _stripes + _YYCounterStripeIndex();
+    OSAtomicIncrement64(hit ? &stripe->hitCount : &stripe->missCount);
+    if (bytes > 0) OSAtomicAdd64(bytes, &stripe->bytesRead);
+}
+
+- (void)recordWriteWithBytes:(int64_t)bytes {
+    _YYCacheCounterStripe *stripe = _stripes + _YYCounterStripeIndex();
+    OSAtomicIncrement64(&stripe->writeCount);
+    if (bytes > 0) OSAtomicAdd64(bytes, &stripe->bytesWritten);
+}
+
+- (void)recordRemoveCount:(int64_t)count {
+    if (count > 0) OSAtomicAdd64(count, &_stripes[_YYCounterStripeIndex()].removeCount);
+}
+
+- (void)recordEvictionCount:(int64_t)count {
+    if (count > 0) OSAtomicAdd64(count, &_stripes[_YYCounterStripeIndex()].evictionCount);
+}
+
+- (void)recordLatency:(NSTimeInterval)latency forOperation:(YYCacheOperation)operation {
+    if (operation >= kOperationCount || latency < 0) return;
+    int64_t nanoseconds = (int64_t)(latency * NSEC_PER_SEC);
+    OSAtomicIncrement64(&_latencyCount[operation]);
+    OSAtomicAdd64(nanoseconds, &_latencyTotal[operation]);
+    OSAtomicIncrement64(&_histogram[operation][_YYLatencyBucket(nanoseconds)]);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> hit:%lld miss:%lld (%.1f%%) write:%lld remove:%lld eviction:%lld read:%lldB written:%lldB latency(us) read:%.1f write:%.1f remove:%.1f",
+            self.class, self, self.hitCount, self.missCount, self.hitRate * 100, self.writeCount, self.removeCount, self.evictionCount, self.bytesRead, self.bytesWritten,
+            [self averageLatencyForOperation:YYCacheOperationRead] * 1000000,
+            [self averageLatencyForOperation:YYCacheOperationWrite] * 1000000,
+            [self averageLatencyForOperation:YYCacheOperationRemove] * 1000000];
+}
+
+@end
@@ -11,6 +11,8 @@
 
 #import <Foundation/Foundation.h>
 
+@class YYCacheStatistics;
+
 NS_ASSUME_NONNULL_BEGIN
 
 /**
@@ -52,6 +54,37 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (readonly) NSUInteger inlineThreshold;
 
+/**
+ The number of shards of the cache. Default is 1.
+ 
+ @discussion Each shard is an independent storage (with its own lock and sqlite
+ database), and the keys are distributed to the shards by a hash of the key.
+ The accesses to different shards can be executed concurrently.
+ */
+@property (readonly) NSUInteger shardCount;
+
+/**
+ The number of read-only sqlite connections of each shard. Default is 0.
+ 
+ @discussion If this value is larger than 0, `objectForKey:` and 
+ `containsObjectForKey:` don't wait for the writes and trims of the same shard,
+ they read from a pool of read-only connections.
+ */
+@property (readonly) NSUInteger readerCount;
+
+/**
+ If an object is stored as a file and the file size (in bytes) is not less than 
+ this value, the file is mapped into memory instead of being copied when the 
+ object is read, the `customUnarchiveBlock` receives the mapped data.
+ 
+ @discussion This avoids a copy and a large memory allocation for large objects 
+ (such as images). The mapped data stays valid even if the object is updated or 
+ removed later.
+ 
+ The default value is NSUIntegerMax, which means the files are never mapped.
+ */
+@property NSUInteger mappedReadThreshold;
+
 /**
  If this block is not nil, then the block will be used to archive object instead
  of NSKeyedArchiver. You can use this block to support the objects which do not
@@ -79,6 +112,13 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nullable, copy) NSString *(^customFileNameBlock)(NSString *key);
 
+/**
+ The statistics of the cache (hit, miss, write, remove and eviction counters,
+ bytes read and written, and optional latency), it's updated lock-free and can 
+ be reset.
+ */
+@property (readonly) YYCacheStatistics *statistics;
+
 
 
 #pragma mark - Limit
@@ -131,6 +171,17 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property NSTimeInterval autoTrimInterval;
 
+/**
+ The group commit time window in seconds. Default is 0, which means disabled.
+ 
+ @discussion When this value is larger than 0, the writes made by `setObject:forKey:`
+ and `removeObjectForKey:` are grouped into one sqlite transaction, which is
+ committed after this time interval. This saves a commit for each write when you
+ write a lot of small objects in a short time, but the writes in the current time
+ window may be lost if the app crashes.
+ */
+@property NSTimeInterval groupCommitInterval;
+
 /**
  Set `YES` to enable error logs for debug.
  */
@@ -157,7 +208,7 @@ NS_ASSUME_NONNULL_BEGIN
 - (nullable instancetype)initWithPath:(NSString *)path;
 
 /**
- The designated initializer.
+ Create a new cache based on the specified path and inline threshold.
  
  @param path       Full path of a directory in which the cache will write data.
      Once initialized you should not read and write to this directory.
@@ -175,7 +226,65 @@ NS_ASSUME_NONNULL_BEGIN
      this method will return it directly, instead of creating a new instance.
  */
 - (nullable instancetype)initWithPath:(NSString *)path
-                      inlineThreshold:(NSUInteger)threshold NS_DESIGNATED_INITIALIZER;
+                      inlineThreshold:(NSUInteger)threshold;
+
+/**
+ Create a new cache which stores the objects in multiple shards.
+ 
+ @param path       Full path of a directory in which the cache will write data.
+     Once initialized you should not read and write to this directory.
+ 
+ @param threshold  The data store inline threshold in bytes. See
+     `initWithPath:inlineThreshold:` for more information.
+ 
+ @param shardCount The number of shards (1~64). If the value is larger than 1, 
+     the objects are stored in `shardCount` sub directories of the path, each with
+     its own lock and sqlite database, so that the accesses of different keys won't
+     block each other. The count and cost limits are shared by all the shards.
+     Pass 1 to get a single storage (same as `initWithPath:inlineThreshold:`).
+     If the path was used with another shard count, the existing objects are 
+     moved to the new shards in background, they may be missed until then. The
+     objects written or removed meanwhile are not overwritten by the old ones.
+ 
+ @return A new cache object, or nil if an error occurs.
+ 
+ @warning If the cache instance for the specified path already exists in memory,
+     this method will return it directly, instead of creating a new instance.
+     It returns nil if the existing instance has a different shard count.
+ */
+- (nullable instancetype)initWithPath:(NSString *)path
+                      inlineThreshold:(NSUInteger)threshold
+                           shardCount:(NSUInteger)shardCount;
+
+/**
+ The designated initializer.
+ 
+ @param path        Full path of a directory in which the cache will write data.
+     Once initialized you should not read and write to this directory.
+ 
+ @param threshold   The data store inline threshold in bytes. See
+     `initWithPath:inlineThreshold:` for more information.
+ 
+ @param shardCount  The number of shards (1~64). See
+     `initWithPath:inlineThreshold:shardCount:` for more information.
+ 
+ @param readerCount The number of read-only sqlite connections of each shard (0~16).
+     If the value is larger than 0, the reads are not blocked by the writes and 
+     the trims (such as a long `trimToCost:`). The reads only see the committed
+     data, so if `groupCommitInterval` is enabled, the objects written in current
+     time window are invisible to the reads until committed. Pass 0 to serialize
+     all accesses of a shard.
+ 
+ @return A new cache object, or nil if an error occurs.
+ 
+ @warning If the cache instance for the specified path already exists in memory,
+     this method will return it directly, instead of creating a new instance.
+     It returns nil if the existing instance has a different shard count.
+ */
+- (nullable instancetype)initWithPath:(NSString *)path
+                      inlineThreshold:(NSUInteger)threshold
+                           shardCount:(NSUInteger)shardCount
+                          readerCount:(NSUInteger)readerCount NS_DESIGNATED_INITIALIZER;
 
 
 #pragma mark - Access Methods
@@ -202,6 +311,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)containsObjectForKey:(NSString *)key withBlock:(void(^)(NSString *key, BOOL contains))block;
 
+/**
+ Gets the size and modification time of the archived data for a key, without
+ reading the data. This method may blocks the calling thread until the database
+ query finished.
+ 
+ @param key     A string identifying the value. If nil, just return NO.
+ @param size    Output the size of the archived data in bytes. Pass NULL to ignore.
+ @param modTime Output the last modification time (unix timestamp, in seconds).
+    Pass NULL to ignore.
+ @return Whether the key is in cache.
+ */
+- (BOOL)getInfoForKey:(NSString *)key size:(nullable int64_t *)size modificationTime:(nullable int64_t *)modTime;
+
 /**
  Returns the value associated with a given key.
  This method may blocks the calling thread until file read finished.
@@ -240,6 +362,30 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)setObject:(nullable id<NSCoding>)object forKey:(NSString *)key withBlock:(void(^)(void))block;
 
+/**
+ Sets the values of the specified keys in the cache.
+ This method may blocks the calling thread until file write finished.
+ 
+ @discussion All the objects are archived first, then they are written to disk 
+ in a single sqlite transaction, which is much faster than calling 
+ `setObject:forKey:` for each object.
+ 
+ @param objects A dictionary which key is the cache key and value is the object
+     to be stored in the cache. The objects failed to archive are ignored.
+ */
+- (void)setObjects:(NSDictionary<NSString *, id<NSCoding>> *)objects;
+
+/**
+ Sets the values of the specified keys in the cache.
+ This method returns immediately and invoke the passed block in background queue
+ when the operation finished.
+ 
+ @param objects A dictionary which key is the cache key and value is the object
+     to be stored in the cache. The objects failed to archive are ignored.
+ @param block  A block which will be invoked in background queue when finished.
+ */
+- (void)setObjects:(NSDictionary<NSString *, id<NSCoding>> *)objects withBlock:(nullable void(^)(void))block;
+
 /**
  Removes the value of the specified key in the cache.
  This method may blocks the calling thread until file delete finished.
@@ -258,6 +404,24 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)removeObjectForKey:(NSString *)key withBlock:(void(^)(NSString *key))block;
 
+/**
+ Removes the values of the specified keys in the cache.
+ This method may blocks the calling thread until file delete finished.
+ 
+ @param keys The keys identifying the values to be removed.
+ */
+- (void)removeObjectsForKeys:(NSArray<NSString *> *)keys;
+
+/**
+ Removes the values of the specified keys in the cache.
+ This method returns immediately and invoke the passed block in background queue
+ when the operation finished.
+ 
+ @param keys   The keys identifying the values to be removed.
+ @param block  A block which will be invoked in background queue when finished.
+ */
+- (void)removeObjectsForKeys:(NSArray<NSString *> *)keys withBlock:(nullable void(^)(void))block;
+
 /**
  Empties the cache.
  This method may blocks the calling thread until file delete finished.
@@ -11,15 +11,19 @@
 
 #import "YYDiskCache.h"
 #import "YYKVStorage.h"
+#import "YYCacheStatistics.h"
 #import "NSString+YYAdd.h"
 #import "UIDevice+YYAdd.h"
 #import <objc/runtime.h>
+#import <QuartzCore/QuartzCore.h>
 #import <time.h>
 
-#define Lock() dispatch_semaphore_wait(self->_lock, DISPATCH_TIME_FOREVER)
-#define Unlock() dispatch_semaphore_signal(self->_lock)
+#define Lock(shard) dispatch_semaphore_wait(shard->_lock, DISPATCH_TIME_FOREVER)
+#define Unlock(shard) dispatch_semaphore_signal(shard->_lock)
 
 static const int extended_data_key;
+static const NSUInteger kMaxShardCount = 64;
+static const int kMigrationBatchCount = 32;
 
 /// Free disk space in bytes.
 static int64_t _YYDiskSpaceFree() {
@@ -31,6 +35,24 @@ static int64_t _YYDiskSpaceFree() {
     return space;
 }
 
+/// FNV-1a hash of the key's UTF-8 bytes, it's stable between launches
+/// (NSString's `hash` is not guaranteed to be).
+static uint32_t _YYDiskCacheKeyHash(NSString *key) {
+    const unsigned char *str = (const unsigned char *)key.UTF8String;
+    uint32_t hash = 2166136261U;
+    if (!str) return hash;
+    while (*str) {
+        hash ^= *str++;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/// Record the items removed by a trim, the count is -1 if error occurs.
+static inline void _YYDiskCacheRecordEviction(YYCacheStatistics *statistics, int countBefore, int countAfter) {
+    if (countBefore > countAfter && countAfter >= 0) [statistics recordEvictionCount:countBefore - countAfter];
+}
+
 
 /// weak reference for all instances
 static NSMapTable *_globalInstances;
@@ -61,14 +83,64 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     dispatch_semaphore_signal(_globalInstancesLock);
 }
 
+static NSString *_YYDiskCacheShardPath(NSString *path, NSUInteger index) {
+    return [path stringByAppendingPathComponent:[NSString stringWithFormat:@"shard%lu", (unsigned long)index]];
+}
+
+/**
+ The storages under the path which are created with another shard count, their
+ items are not in the shards they belong to now.
+ */
+static NSArray *_YYDiskCacheStalePaths(NSString *path, NSUInteger shardCount) {
+    NSMutableArray *paths = [NSMutableArray new];
+    if (shardCount > 1 && [YYKVStorage storageExistsAtPath:path]) [paths addObject:path];
+    NSMutableArray *shardPaths = [NSMutableArray new];
+    NSUInteger oldCount = 0;
+    for (NSUInteger i = 0; i < kMaxShardCount; i++) {
+        NSString *shardPath = _YYDiskCacheShardPath(path, i);
+        if (![YYKVStorage storageExistsAtPath:shardPath]) continue;
+        [shardPaths addObject:shardPath];
+        oldCount = i + 1;
+    }
+    if (oldCount > 0 && oldCount != shardCount) [paths addObjectsFromArray:shardPaths];
+    return paths;
+}
+
+/**
+ A shard of disk cache, a storage with its own lock.
+ The `kv` property is atomic, for the reads which don't hold the lock.
+ 
+ While the stale storages are migrating, the removals are recorded, so the old
+ items removed from this shard are not copied back.
+ */
+@interface _YYDiskCacheShard : NSObject {
+    @package
+    YYKVStorage *_kv;
+    dispatch_semaphore_t _lock;
+    NSMutableSet *_removedKeys; ///< keys removed while migrating, nil if not migrating
+    BOOL _removedAll;           ///< all items are removed while migrating
+}
+@property (strong) YYKVStorage *kv;
+@end
+
+@implementation _YYDiskCacheShard
+@synthesize kv = _kv;
+@end
+
 
 
 @implementation YYDiskCache {
-    YYKVStorage *_kv;
-    dispatch_semaphore_t _lock;
+    NSArray<_YYDiskCacheShard *> *_shards;
+    YYKVStorageType _type;
     dispatch_queue_t _queue;
 }
 
+- (_YYDiskCacheShard *)_shardForKey:(NSString *)key {
+    NSUInteger count = _shards.count;
+    if (count == 1) return _shards.firstObject;
+    return _shards[_YYDiskCacheKeyHash(key) % count];
+}
+
 - (void)_trimRecursively {
     __weak typeof(self) _self = self;
     dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_autoTrimInterval * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
@@ -84,41 +156,91 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     dispatch_async(_queue, ^{
         __strong typeof(_self) self = _self;
         if (!self) return;
-        Lock();
         [self _trimToCost:self.costLimit];
         [self _trimToCount:self.countLimit];
         [self _trimToAge:self.ageLimit];
         [self _trimToFreeDiskSpace:self.freeDiskSpaceLimit];
-        Unlock();
     });
 }
 
+/*
+ The trim methods lock each shard by themselves.
+ With multiple shards, the limit is split between the shards in proportion to
+ their current size, so the overall LRU order is roughly kept.
+ */
+
 - (void)_trimToCost:(NSUInteger)costLimit {
     if (costLimit >= INT_MAX) return;
-    [_kv removeItemsToFitSize:(int)costLimit];
-    
+    if (_shards.count == 1) {
+        _YYDiskCacheShard *shard = _shards.firstObject;
+        Lock(shard);
+        int count = [shard->_kv getItemsCount];
+        [shard->_kv removeItemsToFitSize:(int)costLimit];
+        _YYDiskCacheRecordEviction(_statistics, count, [shard->_kv getItemsCount]);
+        Unlock(shard);
+        return;
+    }
+    int64_t total = [self totalCost];
+    if (total <= (int64_t)costLimit) return;
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        int size = [shard->_kv getItemsSize];
+        if (size > 0) {
+            int64_t limit = (int64_t)size * costLimit / total;
+            int count = [shard->_kv getItemsCount];
+            [shard->_kv removeItemsToFitSize:(int)limit];
+            _YYDiskCacheRecordEviction(_statistics, count, [shard->_kv getItemsCount]);
+        }
+        Unlock(shard);
+    }
 }
 
 - (void)_trimToCount:(NSUInteger)countLimit {
     if (countLimit >= INT_MAX) return;
-    [_kv removeItemsToFitCount:(int)countLimit];
+    if (_shards.count == 1) {
+        _YYDiskCacheShard *shard = _shards.firstObject;
+        Lock(shard);
+        int count = [shard->_kv getItemsCount];
+        [shard->_kv removeItemsToFitCount:(int)countLimit];
+        _YYDiskCacheRecordEviction(_statistics, count, [shard->_kv getItemsCount]);
+        Unlock(shard);
+        return;
+    }
+    int64_t total = [self totalCount];
+    if (total <= (int64_t)countLimit) return;
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        int count = [shard->_kv getItemsCount];
+        if (count > 0) {
+            int64_t limit = (int64_t)count * countLimit / total;
+            [shard->_kv removeItemsToFitCount:(int)limit];
+            _YYDiskCacheRecordEviction(_statistics, count, [shard->_kv getItemsCount]);
+        }
+        Unlock(shard);
+    }
 }
 
 - (void)_trimToAge:(NSTimeInterval)ageLimit {
     if (ageLimit <= 0) {
-        [_kv removeAllItems];
+        [self removeAllObjects];
         return;
     }
     long timestamp = time(NULL);
     if (timestamp <= ageLimit) return;
     long age = timestamp - ageLimit;
     if (age >= INT_MAX) return;
-    [_kv removeItemsEarlierThanTime:(int)age];
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        int count = [shard->_kv getItemsCount];
+        [shard->_kv removeItemsEarlierThanTime:(int)age];
+        _YYDiskCacheRecordEviction(_statistics, count, [shard->_kv getItemsCount]);
+        Unlock(shard);
+    }
 }
 
 - (void)_trimToFreeDiskSpace:(NSUInteger)targetFreeDiskSpace {
     if (targetFreeDiskSpace == 0) return;
-    int64_t totalBytes = [_kv getItemsSize];
+    int64_t totalBytes = [self totalCost];
     if (totalBytes <= 0) return;
     int64_t diskFreeBytes = _YYDiskSpaceFree();
     if (diskFreeBytes < 0) return;
@@ -136,10 +258,116 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     return filename;
 }
 
+- (NSData *)_archivedDataWithObject:(id<NSCoding>)object {
+    NSData *value = nil;
+    if (_customArchiveBlock) {
+        value = _customArchiveBlock(object);
+    } else {
+        @try {
+            value = [NSKeyedArchiver archivedDataWithRootObject:object];
+        }
+        @catch (NSException *exception) {
+            // nothing to do...
+        }
+    }
+    return value;
+}
+
+- (NSString *)_storageFilenameForKey:(NSString *)key value:(NSData *)value {
+    if (_type == YYKVStorageTypeSQLite) return nil;
+    if (value.length <= _inlineThreshold) return nil;
+    return [self _filenameForKey:key];
+}
+
+/**
+ Moves the items of a storage created with another shard count to the shards they
+ belong to now. The items are enumerated page by page, each item is removed from
+ the old storage after it's saved to its shard. The keys which are written or
+ removed after the cache is opened are skipped (and removed from the old storage).
+ A stale storage which is not a shard is removed when it's empty.
+ */
+- (void)_migrateStorageAtPath:(NSString *)path {
+    _YYDiskCacheShard *source = nil;
+    for (NSUInteger i = 0; i < _shards.count && _shards.count > 1; i++) {
+        if ([_YYDiskCacheShardPath(_path, i) isEqualToString:path]) source = _shards[i];
+    }
+    @autoreleasepool {
+        YYKVStorage *kv = nil;
+        if (!source) {
+            kv = [[YYKVStorage alloc] initWithPath:path type:_type];
+            if (!kv) return;
+        }
+        NSString *lastKey = nil;
+        while (YES) {
+            @autoreleasepool {
+                if (source) Lock(source);
+                NSArray *infos = [(source ? source->_kv : kv) getItemInfosAfterKey:lastKey limit:kMigrationBatchCount];
+                if (source) Unlock(source);
+                if (infos.count == 0) break;
+                lastKey = ((YYKVStorageItem *)infos.lastObject).key;
+                
+                for (YYKVStorageItem *info in infos) {
+                    _YYDiskCacheShard *target = [self _shardForKey:info.key];
+                    if (target == source) continue;
+                    YYKVStorageItem *item = nil;
+                    if (source) {
+                        Lock(source);
+                        item = [source->_kv getItemForKey:info.key];
+                        Unlock(source);
+                    } else {
+                        item = [kv getItemForKey:info.key];
+                    }
+                    if (!item.value) continue;
+                    
+                    Lock(target);
+                    BOOL done = YES;
+                    // the key may be written or removed after the cache is opened
+                    if (!target->_removedAll && ![target->_removedKeys containsObject:item.key] &&
+                        ![target->_kv itemExistsForKey:item.key]) {
+                        NSString *filename = [self _storageFilenameForKey:item.key value:item.value];
+                        done = [target->_kv saveItemWithKey:item.key value:item.value filename:filename extendedData:item.extendedData];
+                    }
+                    Unlock(target);
+                    if (!done) continue; // keep it in the old storage, retry at next launch
+                    
+                    if (source) {
+                        Lock(source);
+                        [source->_kv removeItemForKey:item.key];
+                        Unlock(source);
+                    } else {
+                        [kv removeItemForKey:item.key];
+                    }
+                }
+            }
+        }
+        if (source || [kv getItemsCount] != 0) return;
+        kv = nil;
+    }
+    if ([path isEqualToString:_path]) {
+        [YYKVStorage removeStorageAtPath:path];
+    } else {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    }
+}
+
+/// Should be called with the shard's lock held.
+- (void)_beginGroupCommitIfNeeded:(_YYDiskCacheShard *)shard {
+    NSTimeInterval interval = self.groupCommitInterval;
+    if (interval <= 0 || !shard->_kv || shard->_kv.inTransaction) return;
+    if (![shard->_kv beginTransaction]) return;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), _queue, ^{
+        Lock(shard);
+        [shard->_kv commitTransaction];
+        Unlock(shard);
+    });
+}
+
 - (void)_appWillBeTerminated {
-    Lock();
-    _kv = nil;
-    Unlock();
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        shard.kv = nil;
+        Unlock(shard);
+    }
 }
 
 #pragma mark - public
@@ -150,7 +378,7 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 
 - (instancetype)init {
     @throw [NSException exceptionWithName:@"YYDiskCache init error" reason:@"YYDiskCache must be initialized with a path. Use 'initWithPath:' or 'initWithPath:inlineThreshold:' instead." userInfo:nil];
-    return [self initWithPath:@"" inlineThreshold:0];
+    return [self initWithPath:@"" inlineThreshold:0 shardCount:1 readerCount:0];
 }
 
 - (instancetype)initWithPath:(NSString *)path {
@@ -159,11 +387,36 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 
 - (instancetype)initWithPath:(NSString *)path
              inlineThreshold:(NSUInteger)threshold {
+    return [self initWithPath:path inlineThreshold:threshold shardCount:1];
+}
+
+- (instancetype)initWithPath:(NSString *)path
+             inlineThreshold:(NSUInteger)threshold
+                  shardCount:(NSUInteger)shardCount {
+    return [self initWithPath:path inlineThreshold:threshold shardCount:shardCount readerCount:0];
+}
+
+- (instancetype)initWithPath:(NSString *)path
+             inlineThreshold:(NSUInteger)threshold
+                  shardCount:(NSUInteger)shardCount
+                 readerCount:(NSUInteger)readerCount {
     self = [super init];
     if (!self) return nil;
     
     YYDiskCache *globalCache = _YYDiskCacheGetGlobal(path);
-    if (globalCache) return globalCache;
+    if (globalCache) {
+        if (globalCache.shardCount != shardCount) {
+            NSLog(@"YYDiskCache init error: the cache of path [%@] is already opened with shard count %lu.", path, (unsigned long)globalCache.shardCount);
+            return nil;
+        }
+        return globalCache;
+    }
+    
+    if (shardCount == 0 || shardCount > kMaxShardCount) {
+        NSLog(@"YYDiskCache init error: invalid shard count: %lu.", (unsigned long)shardCount);
+        return nil;
+    }
+    NSArray *stalePaths = _YYDiskCacheStalePaths(path, shardCount);
     
     YYKVStorageType type;
     if (threshold == 0) {
@@ -174,20 +427,53 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
         type = YYKVStorageTypeMixed;
     }
     
-    YYKVStorage *kv = [[YYKVStorage alloc] initWithPath:path type:type];
-    if (!kv) return nil;
+    NSMutableArray *shards = [NSMutableArray new];
+    for (NSUInteger i = 0; i < shardCount; i++) {
+        // A single shard uses the path directly, to keep the layout of old caches.
+        NSString *shardPath = shardCount > 1 ? _YYDiskCacheShardPath(path, i) : path;
+        YYKVStorage *kv = [[YYKVStorage alloc] initWithPath:shardPath type:type readerCount:readerCount];
+        if (!kv) return nil;
+        _YYDiskCacheShard *shard = [_YYDiskCacheShard new];
+        shard->_kv = kv;
+        shard->_lock = dispatch_semaphore_create(1);
+        [shards addObject:shard];
+    }
     
-    _kv = kv;
+    _shards = shards;
+    _type = type;
     _path = path;
-    _lock = dispatch_semaphore_create(1);
     _queue = dispatch_queue_create("com.ibireme.cache.disk", DISPATCH_QUEUE_CONCURRENT);
     _inlineThreshold = threshold;
+    _shardCount = shardCount;
+    _readerCount = readerCount;
     _countLimit = NSUIntegerMax;
     _costLimit = NSUIntegerMax;
     _ageLimit = DBL_MAX;
     _freeDiskSpaceLimit = 0;
     _autoTrimInterval = 60;
+    _statistics = [YYCacheStatistics new];
     
+    if (stalePaths.count > 0) {
+        for (_YYDiskCacheShard *shard in shards) {
+            shard->_removedKeys = [NSMutableSet new];
+        }
+        __weak typeof(self) _self = self;
+        dispatch_async(_queue, ^{
+            for (NSString *stalePath in stalePaths) {
+                __strong typeof(_self) self = _self;
+                if (!self) return;
+                [self _migrateStorageAtPath:stalePath];
+            }
+            __strong typeof(_self) self = _self;
+            if (!self) return;
+            for (_YYDiskCacheShard *shard in self->_shards) {
+                Lock(shard);
+                shard->_removedKeys = nil;
+                shard->_removedAll = NO;
+                Unlock(shard);
+            }
+        });
+    }
     [self _trimRecursively];
     _YYDiskCacheSetGlobal(self);
     
@@ -197,9 +483,12 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 
 - (BOOL)containsObjectForKey:(NSString *)key {
     if (!key) return NO;
-    Lock();
-    BOOL contains = [_kv itemExistsForKey:key];
-    Unlock();
+    _YYDiskCacheShard *shard = [self _shardForKey:key];
+    YYKVStorage *kv = shard.kv;
+    if (kv.readerCount > 0) return [kv itemExistsForKey:key]; // thread-safe
+    Lock(shard);
+    BOOL contains = [shard->_kv itemExistsForKey:key];
+    Unlock(shard);
     return contains;
 }
 
@@ -213,12 +502,43 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     });
 }
 
+- (BOOL)getInfoForKey:(NSString *)key size:(int64_t *)size modificationTime:(int64_t *)modTime {
+    if (!key) return NO;
+    _YYDiskCacheShard *shard = [self _shardForKey:key];
+    YYKVStorage *kv = shard.kv;
+    YYKVStorageItem *item = nil;
+    if (kv.readerCount > 0) {
+        item = [kv getItemInfoForKey:key]; // thread-safe
+    } else {
+        Lock(shard);
+        item = [shard->_kv getItemInfoForKey:key];
+        Unlock(shard);
+    }
+    if (!item) return NO;
+    if (size) *size = item.size;
+    if (modTime) *modTime = item.modTime;
+    return YES;
+}
+
 - (id<NSCoding>)objectForKey:(NSString *)key {
     if (!key) return nil;
-    Lock();
-    YYKVStorageItem *item = [_kv getItemForKey:key];
-    Unlock();
-    if (!item.value) return nil;
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
+    _YYDiskCacheShard *shard = [self _shardForKey:key];
+    YYKVStorage *kv = shard.kv;
+    YYKVStorageItem *item = nil;
+    if (kv.readerCount > 0) {
+        item = [kv getItemForKey:key]; // thread-safe
+    } else {
+        Lock(shard);
+        item = [shard->_kv getItemForKey:key];
+        Unlock(shard);
+    }
+    if (!item.value) {
+        [_statistics recordReadWithHit:NO bytes:0];
+        if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRead];
+        return nil;
+    }
     
     id object = nil;
     if (_customUnarchiveBlock) {
@@ -234,6 +554,8 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     if (object && item.extendedData) {
         [YYDiskCache setExtendedData:item.extendedData toObject:object];
     }
+    [_statistics recordReadWithHit:object != nil bytes:object ? item.value.length : 0];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRead];
     return object;
 }
 
@@ -254,29 +576,20 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
         return;
     }
     
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
     NSData *extendedData = [YYDiskCache getExtendedDataFromObject:object];
-    NSData *value = nil;
-    if (_customArchiveBlock) {
-        value = _customArchiveBlock(object);
-    } else {
-        @try {
-            value = [NSKeyedArchiver archivedDataWithRootObject:object];
-        }
-        @catch (NSException *exception) {
-            // nothing to do...
-        }
-    }
+    NSData *value = [self _archivedDataWithObject:object];
     if (!value) return;
-    NSString *filename = nil;
-    if (_kv.type != YYKVStorageTypeSQLite) {
-        if (value.length > _inlineThreshold) {
-            filename = [self _filenameForKey:key];
-        }
-    }
+    NSString *filename = [self _storageFilenameForKey:key value:value];
     
-    Lock();
-    [_kv saveItemWithKey:key value:value filename:filename extendedData:extendedData];
-    Unlock();
+    _YYDiskCacheShard *shard = [self _shardForKey:key];
+    Lock(shard);
+    [self _beginGroupCommitIfNeeded:shard];
+    [shard->_kv saveItemWithKey:key value:value filename:filename extendedData:extendedData];
+    Unlock(shard);
+    [_statistics recordWriteWithBytes:value.length];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationWrite];
 }
 
 - (void)setObject:(id<NSCoding>)object forKey:(NSString *)key withBlock:(void(^)(void))block {
@@ -288,11 +601,56 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     });
 }
 
+- (void)setObjects:(NSDictionary<NSString *, id<NSCoding>> *)objects {
+    if (objects.count == 0) return;
+    NSMapTable *shardItems = [NSMapTable strongToStrongObjectsMapTable];
+    [objects enumerateKeysAndObjectsUsingBlock:^(NSString *key, id<NSCoding> object, BOOL *stop) {
+        NSData *value = [self _archivedDataWithObject:object];
+        if (!value) return;
+        YYKVStorageItem *item = [YYKVStorageItem new];
+        item.key = key;
+        item.value = value;
+        item.filename = [self _storageFilenameForKey:key value:value];
+        item.extendedData = [YYDiskCache getExtendedDataFromObject:object];
+    
+        _YYDiskCacheShard *shard = [self _shardForKey:key];
+        NSMutableArray *items = [shardItems objectForKey:shard];
+        if (!items) {
+            items = [NSMutableArray new];
+            [shardItems setObject:items forKey:shard];
+        }
+        [items addObject:item];
+        [self->_statistics recordWriteWithBytes:value.length];
+    }];
+    
+    for (_YYDiskCacheShard *shard in shardItems) {
+        Lock(shard);
+        [shard->_kv saveItems:[shardItems objectForKey:shard]];
+        Unlock(shard);
+    }
+}
+
+- (void)setObjects:(NSDictionary<NSString *, id<NSCoding>> *)objects withBlock:(void(^)(void))block {
+    __weak typeof(self) _self = self;
+    dispatch_async(_queue, ^{
+        __strong typeof(_self) self = _self;
+        [self setObjects:objects];
+        if (block) block();
+    });
+}
+
 - (void)removeObjectForKey:(NSString *)key {
     if (!key) return;
-    Lock();
-    [_kv removeItemForKey:key];
-    Unlock();
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
+    _YYDiskCacheShard *shard = [self _shardForKey:key];
+    Lock(shard);
+    [self _beginGroupCommitIfNeeded:shard];
+    [shard->_kv removeItemForKey:key];
+    [shard->_removedKeys addObject:key];
+    Unlock(shard);
+    [_statistics recordRemoveCount:1];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRemove];
 }
 
 - (void)removeObjectForKey:(NSString *)key withBlock:(void(^)(NSString *key))block {
@@ -304,10 +662,44 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     });
 }
 
+- (void)removeObjectsForKeys:(NSArray<NSString *> *)keys {
+    if (keys.count == 0) return;
+    NSMapTable *shardKeys = [NSMapTable strongToStrongObjectsMapTable];
+    for (NSString *key in keys) {
+        _YYDiskCacheShard *shard = [self _shardForKey:key];
+        NSMutableArray *array = [shardKeys objectForKey:shard];
+        if (!array) {
+            array = [NSMutableArray new];
+            [shardKeys setObject:array forKey:shard];
+        }
+        [array addObject:key];
+    }
+    
+    for (_YYDiskCacheShard *shard in shardKeys) {
+        Lock(shard);
+        [shard->_kv removeItemForKeys:[shardKeys objectForKey:shard]];
+        [shard->_removedKeys addObjectsFromArray:[shardKeys objectForKey:shard]];
+        Unlock(shard);
+    }
+    [_statistics recordRemoveCount:keys.count];
+}
+
+- (void)removeObjectsForKeys:(NSArray<NSString *> *)keys withBlock:(void(^)(void))block {
+    __weak typeof(self) _self = self;
+    dispatch_async(_queue, ^{
+        __strong typeof(_self) self = _self;
+        [self removeObjectsForKeys:keys];
+        if (block) block();
+    });
+}
+
 - (void)removeAllObjects {
-    Lock();
-    [_kv removeAllItems];
-    Unlock();
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        [shard->_kv removeAllItems];
+        if (shard->_removedKeys) shard->_removedAll = YES;
+        Unlock(shard);
+    }
 }
 
 - (void)removeAllObjectsWithBlock:(void(^)(void))block {
@@ -328,16 +720,45 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
             if (end) end(YES);
             return;
         }
-        Lock();
-        [_kv removeAllItemsWithProgressBlock:progress endBlock:end];
-        Unlock();
+        if (self->_shards.count == 1) {
+            _YYDiskCacheShard *shard = self->_shards.firstObject;
+            Lock(shard);
+            [shard->_kv removeAllItemsWithProgressBlock:progress endBlock:end];
+            if (shard->_removedKeys) shard->_removedAll = YES;
+            Unlock(shard);
+            return;
+        }
+    
+        // Report the aggregated progress of all shards.
+        int total = (int)[self totalCount];
+        __block int removed = 0;
+        __block BOOL error = NO;
+        for (_YYDiskCacheShard *shard in self->_shards) {
+            Lock(shard);
+            __block int shardRemoved = 0;
+            [shard->_kv removeAllItemsWithProgressBlock:^(int removedCount, int totalCount) {
+                shardRemoved = removedCount;
+                if (progress) progress(removed + removedCount, MAX(total, removed + totalCount));
+            } endBlock:^(BOOL shardError) {
+                if (shardError) error = YES;
+            }];
+            removed += shardRemoved;
+            if (shard->_removedKeys) shard->_removedAll = YES;
+            Unlock(shard);
+        }
+        if (end) end(error);
     });
 }
 
 - (NSInteger)totalCount {
-    Lock();
-    int count = [_kv getItemsCount];
-    Unlock();
+    NSInteger count = 0;
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        int shardCount = [shard->_kv getItemsCount];
+        Unlock(shard);
+        if (shardCount < 0) return -1;
+        count += shardCount;
+    }
     return count;
 }
 
@@ -352,10 +773,15 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 }
 
 - (NSInteger)totalCost {
-    Lock();
-    int count = [_kv getItemsSize];
-    Unlock();
-    return count;
+    NSInteger cost = 0;
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        int shardCost = [shard->_kv getItemsSize];
+        Unlock(shard);
+        if (shardCost < 0) return -1;
+        cost += shardCost;
+    }
+    return cost;
 }
 
 - (void)totalCostWithBlock:(void(^)(NSInteger totalCost))block {
@@ -369,9 +795,7 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 }
 
 - (void)trimToCount:(NSUInteger)count {
-    Lock();
     [self _trimToCount:count];
-    Unlock();
 }
 
 - (void)trimToCount:(NSUInteger)count withBlock:(void(^)(void))block {
@@ -384,9 +808,7 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 }
 
 - (void)trimToCost:(NSUInteger)cost {
-    Lock();
     [self _trimToCost:cost];
-    Unlock();
 }
 
 - (void)trimToCost:(NSUInteger)cost withBlock:(void(^)(void))block {
@@ -399,9 +821,7 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
 }
 
 - (void)trimToAge:(NSTimeInterval)age {
-    Lock();
     [self _trimToAge:age];
-    Unlock();
 }
 
 - (void)trimToAge:(NSTimeInterval)age withBlock:(void(^)(void))block {
@@ -428,17 +848,36 @@ static void _YYDiskCacheSetGlobal(YYDiskCache *cache) {
     else return [NSString stringWithFormat:@"<%@: %p> (%@)", self.class, self, _path];
 }
 
+- (NSUInteger)mappedReadThreshold {
+    _YYDiskCacheShard *shard = _shards.firstObject;
+    Lock(shard);
+    NSUInteger threshold = shard->_kv.mappedReadThreshold;
+    Unlock(shard);
+    return threshold;
+}
+
+- (void)setMappedReadThreshold:(NSUInteger)mappedReadThreshold {
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        shard->_kv.mappedReadThreshold = mappedReadThreshold;
+        Unlock(shard);
+    }
+}
+
 - (BOOL)errorLogsEnabled {
-    Lock();
-    BOOL enabled = _kv.errorLogsEnabled;
-    Unlock();
+    _YYDiskCacheShard *shard = _shards.firstObject;
+    Lock(shard);
+    BOOL enabled = shard->_kv.errorLogsEnabled;
+    Unlock(shard);
     return enabled;
 }
 
 - (void)setErrorLogsEnabled:(BOOL)errorLogsEnabled {
-    Lock();
-    _kv.errorLogsEnabled = errorLogsEnabled;
-    Unlock();
+    for (_YYDiskCacheShard *shard in _shards) {
+        Lock(shard);
+        shard->_kv.errorLogsEnabled = errorLogsEnabled;
+        Unlock(shard);
+    }
 }
 
 @end
@@ -61,17 +61,19 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
  YYKVStorage is a key-value storage based on sqlite and file system.
  Typically, you should not use this class directly.
  
- @discussion The designated initializer for YYKVStorage is `initWithPath:type:`. 
+ @discussion The designated initializer for YYKVStorage is `initWithPath:type:readerCount:`. 
  After initialized, a directory is created based on the `path` to hold key-value data.
  Once initialized you should not read or write this directory without the instance.
  
  You may compile the latest version of sqlite and ignore the libsqlite3.dylib in
  iOS system to get 2x~4x speed up.
  
- @warning The instance of this class is *NOT* thread safe, you need to make sure 
+ @warning The instance of this class is *NOT* thread safe (except the read methods
+ listed in `initWithPath:type:readerCount:`), you need to make sure 
  that there's only one thread to access the instance at the same time. If you really 
  need to process large amounts of data in multi-thread, you should split the data
- to multiple KVStorage instance (sharding).
+ to multiple KVStorage instance (sharding), `YYDiskCache` can do this for you, 
+ see `-[YYDiskCache initWithPath:inlineThreshold:shardCount:]`.
  */
 @interface YYKVStorage : NSObject
 
@@ -83,6 +85,21 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
 @property (nonatomic, readonly) NSString *path;        ///< The path of this storage.
 @property (nonatomic, readonly) YYKVStorageType type;  ///< The type of this storage.
 @property (nonatomic) BOOL errorLogsEnabled;           ///< Set `YES` to enable error logs for debug.
+@property (nonatomic, readonly) NSUInteger readerCount; ///< The count of read-only sqlite connections.
+
+/**
+ If the size of an item's file is not less than this value (in bytes), the file is
+ mapped into memory instead of being copied when the item's value is read.
+ Default is NSUIntegerMax, which means the files are never mapped.
+ 
+ @discussion The mapped value is read from the page cache on demand, and the file is 
+ unmapped when the `NSData` is deallocated. When the mapping is enabled, the files 
+ are replaced (not overwritten) on save, and a mapped value stays valid even if the
+ item is updated or removed later. If the file can not be mapped, it's copied as usual.
+ 
+ You should set this value before accessing the storage.
+ */
+@property (nonatomic) NSUInteger mappedReadThreshold;
 
 #pragma mark - Initializer
 ///=============================================================================
@@ -92,7 +109,7 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
 + (instancetype)new UNAVAILABLE_ATTRIBUTE;
 
 /**
- The designated initializer. 
+ Create a storage with a single sqlite connection.
  
  @param path  Full path of a directory in which the storage will write data. If
     the directory is not exists, it will try to create one, otherwise it will 
@@ -102,7 +119,56 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
  @return  A new storage object, or nil if an error occurs.
  @warning Multiple instances with the same path will make the storage unstable.
  */
-- (nullable instancetype)initWithPath:(NSString *)path type:(YYKVStorageType)type NS_DESIGNATED_INITIALIZER;
+- (nullable instancetype)initWithPath:(NSString *)path type:(YYKVStorageType)type;
+
+/**
+ The designated initializer.
+ 
+ @discussion If `readerCount` is larger than 0, a pool of read-only sqlite 
+ connections is opened beside the writer connection (the database runs in WAL 
+ mode, so the readers are not blocked by the writer). Then these methods are 
+ thread-safe, they can be called concurrently with each other, and with the 
+ thread which calls the other methods (such as save and trim):
+ 
+ * `getItemForKey:`
+ * `getItemInfoForKey:`
+ * `getItemValueForKey:`
+ * `itemExistsForKey:`
+ 
+ The readers only see the committed data, so the writes in an open transaction
+ (see `beginTransaction`) are invisible to them. The access time of the items
+ read by the readers is recorded in memory, and written to the database by the
+ next save or trim.
+ 
+ @param path  Full path of a directory in which the storage will write data.
+ @param type  The storage type. After first initialized you should not change the
+    type of the specified path.
+ @param readerCount  The count of read-only connections (0~16), pass 0 to use 
+    only one connection for all accesses.
+ @return  A new storage object, or nil if an error occurs.
+ @warning Multiple instances with the same path will make the storage unstable.
+ */
+- (nullable instancetype)initWithPath:(NSString *)path
+                                 type:(YYKVStorageType)type
+                          readerCount:(NSUInteger)readerCount NS_DESIGNATED_INITIALIZER;
+
+/**
+ Whether a storage has been created at the path.
+ 
+ @param path  Full path of a storage directory.
+ @return `YES` if the sqlite database of a storage exists in the directory.
+ */
++ (BOOL)storageExistsAtPath:(NSString *)path;
+
+/**
+ Delete the sqlite database and the files of a storage, the other files in the
+ directory are not touched.
+ 
+ @param path  Full path of a storage directory.
+ @return Whether succeed.
+ @warning The storage at the path should not be in use.
+ */
++ (BOOL)removeStorageAtPath:(NSString *)path;
 
 
 #pragma mark - Save Items
@@ -160,6 +226,51 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
                filename:(nullable NSString *)filename
            extendedData:(nullable NSData *)extendedData;
 
+/**
+ Save an array of items in a single sqlite transaction.
+ 
+ @discussion Each item follows the same rules as `saveItem:`. The file blobs are
+ written first, and then all the records are inserted in one transaction, so a
+ large batch costs only one commit. The batch is saved all or nothing: if any of
+ the items fails, the records are rolled back and the written files are deleted.
+ 
+ @param items  An array of items, should not be empty.
+ @return Whether succeed.
+ */
+- (BOOL)saveItems:(NSArray<YYKVStorageItem *> *)items;
+
+#pragma mark - Transaction
+///=============================================================================
+/// @name Transaction
+///=============================================================================
+
+/**
+ Whether there's an open transaction started by `beginTransaction`.
+ */
+@property (nonatomic, readonly, getter=isInTransaction) BOOL inTransaction;
+
+/**
+ Begin a transaction, all the following writes are grouped together until
+ `commitTransaction` is called (group commit).
+ 
+ @discussion The writes in an open transaction are visible to this instance, but
+ they are not durable until committed. The pending transaction is committed 
+ automatically when the database is closed. Does nothing if a transaction is 
+ already open.
+ 
+ @return Whether succeed.
+ */
+- (BOOL)beginTransaction;
+
+/**
+ Commit the transaction started by `beginTransaction`.
+ Does nothing if there's no open transaction.
+ 
+ @return Whether succeed.
+ */
+- (BOOL)commitTransaction;
+
+
 #pragma mark - Remove Items
 ///=============================================================================
 /// @name Remove Items
@@ -223,6 +334,9 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
  folder, and then clear the folder in background queue. So this method is much 
  faster than `removeAllItemsWithProgressBlock:endBlock:`.
  
+ The read-only connections are reopened with the new database. If it fails, the 
+ storage falls back to the single connection, and `readerCount` becomes 0.
+ 
  @return Whether succeed.
  */
 - (BOOL)removeAllItems;
@@ -308,6 +422,16 @@ typedef NS_ENUM(NSUInteger, YYKVStorageType) {
  */
 - (BOOL)itemExistsForKey:(NSString *)key;
 
+/**
+ Get item informations (without `value` and `extendedData`) in the order of key,
+ it can be used to enumerate all items page by page.
+ 
+ @param key    The items after this key are returned, pass nil to start from the first one.
+ @param count  The max count of the items.
+ @return Item informations, or nil if an error occurs.
+ */
+- (nullable NSArray<YYKVStorageItem *> *)getItemInfosAfterKey:(nullable NSString *)key limit:(int)count;
+
 /**
  Get total item count.
  @return Total item count, -1 when an error occurs.
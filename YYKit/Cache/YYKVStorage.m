@@ -13,6 +13,8 @@
 #import "UIApplication+YYAdd.h"
 #import <UIKit/UIKit.h>
 #import <time.h>
+#import <pthread.h>
+#import <sys/stat.h>
 
 #if __has_include(<sqlite3.h>)
 #import <sqlite3.h>
@@ -24,6 +26,8 @@
 static const NSUInteger kMaxErrorRetryCount = 8;
 static const NSTimeInterval kMinRetryTimeInterval = 2.0;
 static const int kPathLengthMax = PATH_MAX - 64;
+static const NSUInteger kMaxJoinedKeyCount = 512; // less than SQLITE_MAX_VARIABLE_NUMBER
+static const NSUInteger kMaxReaderCount = 16;
 static NSString *const kDBFileName = @"manifest.sqlite";
 static NSString *const kDBShmFileName = @"manifest.sqlite-shm";
 static NSString *const kDBWalFileName = @"manifest.sqlite-wal";
@@ -54,11 +58,34 @@ static NSString *const kTrashDirectoryName = @"trash";
     primary key(key)
  ); 
  create index if not exists last_access_time_idx on manifest(last_access_time);
+ 
+ The total size and count of the items are kept in a single row table, which is 
+ maintained by triggers in the same transaction as the manifest changes, so they
+ can be queried in O(1). The row is recomputed from the manifest when the database
+ is opened, in case it was changed without the triggers (such as by an old version):
+ 
+ create table if not exists manifest_stats (
+    id                  integer,
+    total_size          integer,
+    total_count         integer,
+    primary key(id)
+ );
+ 
+ The 'insert or replace' deletes the old row without firing the delete trigger
+ (recursive_triggers is off), so the insert trigger subtracts the old row itself.
  */
 
 @implementation YYKVStorageItem
 @end
 
+
+/// A read-only sqlite connection in the reader pool.
+typedef struct {
+    sqlite3 *db;
+    CFMutableDictionaryRef stmtCache;
+    BOOL inUse;
+} _YYKVStorageReader;
+
 @implementation YYKVStorage {
     dispatch_queue_t _trashQueue;
     
@@ -71,6 +98,15 @@ static NSString *const kTrashDirectoryName = @"trash";
     CFMutableDictionaryRef _dbStmtCache;
     NSTimeInterval _dbLastOpenErrorTime;
     NSUInteger _dbOpenErrorCount;
+    BOOL _dbInTransaction;
+    
+    _YYKVStorageReader *_readers;
+    dispatch_semaphore_t _readerSemaphore; ///< count of the idle readers
+    pthread_mutex_t _readerPoolLock;       ///< guards `inUse` of the readers
+    pthread_rwlock_t _readerResetLock;     ///< write locked while the db files are replaced
+    pthread_mutex_t _pendingLock;
+    NSMutableDictionary *_pendingAccessTimes; ///< key -> access time, recorded by readers
+    NSMutableSet *_pendingDeletes;            ///< keys whose file is missing, recorded by readers
 }
 
 
@@ -108,6 +144,15 @@ static NSString *const kTrashDirectoryName = @"trash";
     BOOL retry = NO;
     BOOL stmtFinalized = NO;
     
+    if (_dbInTransaction) {
+        // Do not lose the pending group commit, sqlite will rollback it on close.
+        result = sqlite3_exec(_db, "commit transaction;", NULL, NULL, NULL);
+        if (result != SQLITE_OK && _errorLogsEnabled) {
+            NSLog(@"%s line:%d sqlite commit failed (%d).", __FUNCTION__, __LINE__, result);
+        }
+        _dbInTransaction = NO;
+    }
+    
     if (_dbStmtCache) CFRelease(_dbStmtCache);
     _dbStmtCache = NULL;
     
@@ -147,7 +192,23 @@ static NSString *const kTrashDirectoryName = @"trash";
 
 - (BOOL)_dbInitialize {
     NSString *sql = @"pragma journal_mode = wal; pragma synchronous = normal; create table if not exists manifest (key text, filename text, size integer, inline_data blob, modification_time integer, last_access_time integer, extended_data blob, primary key(key)); create index if not exists last_access_time_idx on manifest(last_access_time);";
-    return [self _dbExecute:sql];
+    if (![self _dbExecute:sql]) return NO;
+    
+    NSString *statsSql = @"create table if not exists manifest_stats (id integer, total_size integer, total_count integer, primary key(id)); "
+    "create trigger if not exists manifest_stats_before_insert before insert on manifest begin "
+        "update manifest_stats set total_size = total_size - ifnull((select size from manifest where key = new.key), 0), total_count = total_count - (select count(*) from manifest where key = new.key) where id = 0; "
+    "end; "
+    "create trigger if not exists manifest_stats_after_insert after insert on manifest begin "
+        "update manifest_stats set total_size = total_size + new.size, total_count = total_count + 1 where id = 0; "
+    "end; "
+    "create trigger if not exists manifest_stats_after_delete after delete on manifest begin "
+        "update manifest_stats set total_size = total_size - old.size, total_count = total_count - 1 where id = 0; "
+    "end; "
+    "create trigger if not exists manifest_stats_after_update after update of size on manifest begin "
+        "update manifest_stats set total_size = total_size - old.size + new.size where id = 0; "
+    "end; "
+    "insert or replace into manifest_stats (id, total_size, total_count) select 0, ifnull(sum(size), 0), count(*) from manifest;";
+    return [self _dbExecute:statsSql];
 }
 
 - (void)_dbCheckpoint {
@@ -170,6 +231,21 @@ static NSString *const kTrashDirectoryName = @"trash";
     return result == SQLITE_OK;
 }
 
+- (BOOL)_dbBeginTransaction {
+    if (_dbInTransaction) return YES;
+    if (![self _dbExecute:@"begin immediate transaction;"]) return NO;
+    _dbInTransaction = YES;
+    return YES;
+}
+
+- (BOOL)_dbCommitTransaction {
+    if (!_dbInTransaction) return YES;
+    BOOL suc = [self _dbExecute:@"commit transaction;"];
+    if (!suc) [self _dbExecute:@"rollback transaction;"];
+    _dbInTransaction = NO;
+    return suc;
+}
+
 - (sqlite3_stmt *)_dbPrepareStmt:(NSString *)sql {
     if (![self _dbCheck] || sql.length == 0 || !_dbStmtCache) return NULL;
     sqlite3_stmt *stmt = (sqlite3_stmt *)CFDictionaryGetValue(_dbStmtCache, (__bridge const void *)(sql));
@@ -244,6 +320,20 @@ static NSString *const kTrashDirectoryName = @"trash";
     return YES;
 }
 
+- (BOOL)_dbUpdateAccessTime:(int)accessTime withKey:(NSString *)key {
+    NSString *sql = @"update manifest set last_access_time = ?1 where key = ?2 and last_access_time < ?1;";
+    sqlite3_stmt *stmt = [self _dbPrepareStmt:sql];
+    if (!stmt) return NO;
+    sqlite3_bind_int(stmt, 1, accessTime);
+    sqlite3_bind_text(stmt, 2, key.UTF8String, -1, NULL);
+    int result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE) {
+        if (_errorLogsEnabled) NSLog(@"%s line:%d sqlite update error (%d): %s", __FUNCTION__, __LINE__, result, sqlite3_errmsg(_db));
+        return NO;
+    }
+    return YES;
+}
+
 - (BOOL)_dbUpdateAccessTimeWithKeys:(NSArray *)keys {
     if (![self _dbCheck]) return NO;
     int t = (int)time(NULL);
@@ -525,6 +615,39 @@ static NSString *const kTrashDirectoryName = @"trash";
     return filenames;
 }
 
+- (NSMutableArray *)_dbGetItemSizeInfoAfterKey:(NSString *)lastKey limit:(int)count {
+    NSString *sql = @"select key, filename, size from manifest where key > ?1 order by key limit ?2;";
+    sqlite3_stmt *stmt = [self _dbPrepareStmt:sql];
+    if (!stmt) return nil;
+    sqlite3_bind_text(stmt, 1, lastKey ? lastKey.UTF8String : "", -1, NULL);
+    sqlite3_bind_int(stmt, 2, count);
+    
+    NSMutableArray *items = [NSMutableArray new];
+    do {
+        int result = sqlite3_step(stmt);
+        if (result == SQLITE_ROW) {
+            char *key = (char *)sqlite3_column_text(stmt, 0);
+            char *filename = (char *)sqlite3_column_text(stmt, 1);
+            int size = sqlite3_column_int(stmt, 2);
+            NSString *keyStr = key ? [NSString stringWithUTF8String:key] : nil;
+            if (keyStr) {
+                YYKVStorageItem *item = [YYKVStorageItem new];
+                item.key = keyStr;
+                item.filename = filename ? [NSString stringWithUTF8String:filename] : nil;
+                item.size = size;
+                [items addObject:item];
+            }
+        } else if (result == SQLITE_DONE) {
+            break;
+        } else {
+            if (_errorLogsEnabled) NSLog(@"%s line:%d sqlite query error (%d): %s", __FUNCTION__, __LINE__, result, sqlite3_errmsg(_db));
+            items = nil;
+            break;
+        }
+    } while (1);
+    return items;
+}
+
 - (NSMutableArray *)_dbGetItemSizeInfoOrderByTimeAscWithLimit:(int)count {
     NSString *sql = @"select key, filename, size from manifest order by last_access_time asc limit ?1;";
     sqlite3_stmt *stmt = [self _dbPrepareStmt:sql];
@@ -571,7 +694,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 }
 
 - (int)_dbGetTotalItemSize {
-    NSString *sql = @"select sum(size) from manifest;";
+    NSString *sql = @"select total_size from manifest_stats where id = 0;";
     sqlite3_stmt *stmt = [self _dbPrepareStmt:sql];
     if (!stmt) return -1;
     int result = sqlite3_step(stmt);
@@ -583,7 +706,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 }
 
 - (int)_dbGetTotalItemCount {
-    NSString *sql = @"select count(*) from manifest;";
+    NSString *sql = @"select total_count from manifest_stats where id = 0;";
     sqlite3_stmt *stmt = [self _dbPrepareStmt:sql];
     if (!stmt) return -1;
     int result = sqlite3_step(stmt);
@@ -595,15 +718,197 @@ static NSString *const kTrashDirectoryName = @"trash";
 }
 
 
+#pragma mark - reader
+
+- (BOOL)_readersOpen {
+    for (NSUInteger i = 0; i < _readerCount; i++) {
+        _YYKVStorageReader *reader = &_readers[i];
+        if (reader->db) continue;
+        int result = sqlite3_open_v2(_dbPath.UTF8String, &reader->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL);
+        if (result != SQLITE_OK) {
+            if (_errorLogsEnabled) NSLog(@"%s line:%d sqlite open reader failed (%d).", __FUNCTION__, __LINE__, result);
+            if (reader->db) sqlite3_close(reader->db);
+            reader->db = NULL;
+            [self _readersClose];
+            return NO;
+        }
+        CFDictionaryKeyCallBacks keyCallbacks = kCFCopyStringDictionaryKeyCallBacks;
+        CFDictionaryValueCallBacks valueCallbacks = {0};
+        reader->stmtCache = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &keyCallbacks, &valueCallbacks);
+    }
+    return YES;
+}
+
+- (void)_readersClose {
+    for (NSUInteger i = 0; i < _readerCount; i++) {
+        _YYKVStorageReader *reader = &_readers[i];
+        if (reader->stmtCache) CFRelease(reader->stmtCache);
+        reader->stmtCache = NULL;
+        if (!reader->db) continue;
+        sqlite3_stmt *stmt;
+        while ((stmt = sqlite3_next_stmt(reader->db, nil)) != 0) {
+            sqlite3_finalize(stmt);
+        }
+        int result = sqlite3_close(reader->db);
+        if (result != SQLITE_OK && _errorLogsEnabled) {
+            NSLog(@"%s line:%d sqlite close reader failed (%d).", __FUNCTION__, __LINE__, result);
+        }
+        reader->db = NULL;
+    }
+}
+
+/// Wait for an idle reader.
+- (_YYKVStorageReader *)_readerCheckout {
+    dispatch_semaphore_wait(_readerSemaphore, DISPATCH_TIME_FOREVER);
+    _YYKVStorageReader *reader = NULL;
+    pthread_mutex_lock(&_readerPoolLock);
+    for (NSUInteger i = 0; i < _readerCount; i++) {
+        if (!_readers[i].inUse) {
+            reader = &_readers[i];
+            reader->inUse = YES;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_readerPoolLock);
+    return reader;
+}
+
+- (void)_readerCheckin:(_YYKVStorageReader *)reader {
+    pthread_mutex_lock(&_readerPoolLock);
+    reader->inUse = NO;
+    pthread_mutex_unlock(&_readerPoolLock);
+    dispatch_semaphore_signal(_readerSemaphore);
+}
+
+- (sqlite3_stmt *)_reader:(_YYKVStorageReader *)reader prepareStmt:(NSString *)sql {
+    if (!reader->db || !reader->stmtCache) return NULL;
+    sqlite3_stmt *stmt = (sqlite3_stmt *)CFDictionaryGetValue(reader->stmtCache, (__bridge const void *)(sql));
+    if (!stmt) {
+        int result = sqlite3_prepare_v2(reader->db, sql.UTF8String, -1, &stmt, NULL);
+        if (result != SQLITE_OK) {
+            if (_errorLogsEnabled) NSLog(@"%s line:%d sqlite stmt prepare error (%d): %s", __FUNCTION__, __LINE__, result, sqlite3_errmsg(reader->db));
+            return NULL;
+        }
+        CFDictionarySetValue(reader->stmtCache, (__bridge const void *)(sql), stmt);
+    }
+    return stmt;
+}
+
+- (YYKVStorageItem *)_reader:(_YYKVStorageReader *)reader getItemWithKey:(NSString *)key excludeInlineData:(BOOL)excludeInlineData {
+    NSString *sql = excludeInlineData ? @"select key, filename, size, modification_time, last_access_time, extended_data from manifest where key = ?1;" : @"select key, filename, size, inline_data, modification_time, last_access_time, extended_data from manifest where key = ?1;";
+    sqlite3_stmt *stmt = [self _reader:reader prepareStmt:sql];
+    if (!stmt) return nil;
+    sqlite3_bind_text(stmt, 1, key.UTF8String, -1, NULL);
+    
+    YYKVStorageItem *item = nil;
+    int result = sqlite3_step(stmt);
+    if (result == SQLITE_ROW) {
+        item = [self _dbGetItemFromStmt:stmt excludeInlineData:excludeInlineData];
+    } else {
+        if (result != SQLITE_DONE) {
+            if (_errorLogsEnabled) NSLog(@"%s line:%d sqlite query error (%d): %s", __FUNCTION__, __LINE__, result, sqlite3_errmsg(reader->db));
+        }
+    }
+    // Reset now to end the read transaction, an open one would block the wal checkpoint.
+    sqlite3_reset(stmt);
+    return item;
+}
+
+/**
+ Read an item with an idle reader, and the item's value from file if needed.
+ The access time is recorded and will be written by the writer connection later.
+ */
+- (YYKVStorageItem *)_readItemWithKey:(NSString *)key excludeInlineData:(BOOL)excludeInlineData {
+    pthread_rwlock_rdlock(&_readerResetLock);
+    if (_readerCount == 0) { // the readers are closed by a failed `removeAllItems`
+        pthread_rwlock_unlock(&_readerResetLock);
+        return nil;
+    }
+    _YYKVStorageReader *reader = [self _readerCheckout];
+    YYKVStorageItem *item = [self _reader:reader getItemWithKey:key excludeInlineData:excludeInlineData];
+    [self _readerCheckin:reader];
+    if (item && !excludeInlineData) {
+        if (item.filename) {
+            item.value = [self _fileReadWithName:item.filename];
+            if (!item.value) {
+                pthread_mutex_lock(&_pendingLock);
+                [_pendingDeletes addObject:key];
+                pthread_mutex_unlock(&_pendingLock);
+                item = nil;
+            }
+        }
+        if (item) {
+            pthread_mutex_lock(&_pendingLock);
+            _pendingAccessTimes[key] = @((int)time(NULL));
+            pthread_mutex_unlock(&_pendingLock);
+        }
+    }
+    pthread_rwlock_unlock(&_readerResetLock);
+    return item;
+}
+
+- (void)_pendingReadsDiscard {
+    pthread_mutex_lock(&_pendingLock);
+    [_pendingAccessTimes removeAllObjects];
+    [_pendingDeletes removeAllObjects];
+    pthread_mutex_unlock(&_pendingLock);
+}
+
+/// Write the access times and deletions recorded by the readers to db.
+- (void)_dbFlushPendingReads {
+    if (_readerCount == 0) return;
+    NSDictionary *accessTimes = nil;
+    NSSet *deletes = nil;
+    pthread_mutex_lock(&_pendingLock);
+    if (_pendingAccessTimes.count) {
+        accessTimes = _pendingAccessTimes;
+        _pendingAccessTimes = [NSMutableDictionary new];
+    }
+    if (_pendingDeletes.count) {
+        deletes = _pendingDeletes;
+        _pendingDeletes = [NSMutableSet new];
+    }
+    pthread_mutex_unlock(&_pendingLock);
+    if (!accessTimes && !deletes) return;
+    
+    if (![self _dbExecute:@"savepoint yy_flush_reads;"]) return;
+    for (NSString *key in deletes) {
+        // The key may be saved again after the read, only delete it if the file
+        // of the current row is still missing.
+        NSString *filename = [self _dbGetFilenameWithKey:key];
+        if (!filename) continue;
+        if ([[NSFileManager defaultManager] fileExistsAtPath:[_dataPath stringByAppendingPathComponent:filename]]) continue;
+        [self _dbDeleteItemWithKey:key];
+    }
+    [accessTimes enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSNumber *accessTime, BOOL *stop) {
+        [self _dbUpdateAccessTime:accessTime.intValue withKey:key];
+    }];
+    [self _dbExecute:@"release savepoint yy_flush_reads;"];
+}
+
+
 #pragma mark - file
 
 - (BOOL)_fileWriteWithName:(NSString *)filename data:(NSData *)data {
     NSString *path = [_dataPath stringByAppendingPathComponent:filename];
-    return [data writeToFile:path atomically:NO];
+    // When the files may be mapped or read by the readers (without the writer's lock),
+    // replace the file (write to a temporary file and rename) instead of overwriting
+    // it, so the data being read is never changed or truncated.
+    BOOL atomically = _readerCount > 0 || _mappedReadThreshold != NSUIntegerMax;
+    return [data writeToFile:path atomically:atomically];
 }
 
 - (NSData *)_fileReadWithName:(NSString *)filename {
     NSString *path = [_dataPath stringByAppendingPathComponent:filename];
+    NSUInteger threshold = _mappedReadThreshold;
+    if (threshold != NSUIntegerMax) {
+        struct stat st;
+        if (stat(path.fileSystemRepresentation, &st) == 0 && st.st_size >= (off_t)threshold) {
+            NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL];
+            if (data) return data;
+            // fallback to copy
+        }
+    }
     NSData *data = [NSData dataWithContentsOfFile:path];
     return data;
 }
@@ -658,10 +963,31 @@ static NSString *const kTrashDirectoryName = @"trash";
 
 - (instancetype)init {
     @throw [NSException exceptionWithName:@"YYKVStorage init error" reason:@"Please use the designated initializer and pass the 'path' and 'type'." userInfo:nil];
-    return [self initWithPath:@"" type:YYKVStorageTypeFile];
+    return [self initWithPath:@"" type:YYKVStorageTypeFile readerCount:0];
+}
+
++ (BOOL)storageExistsAtPath:(NSString *)path {
+    if (path.length == 0) return NO;
+    return [[NSFileManager defaultManager] fileExistsAtPath:[path stringByAppendingPathComponent:kDBFileName]];
+}
+
++ (BOOL)removeStorageAtPath:(NSString *)path {
+    if (path.length == 0) return NO;
+    NSFileManager *manager = [NSFileManager defaultManager];
+    BOOL suc = YES;
+    for (NSString *name in @[kDBFileName, kDBShmFileName, kDBWalFileName, kDataDirectoryName, kTrashDirectoryName]) {
+        NSString *itemPath = [path stringByAppendingPathComponent:name];
+        if (![manager fileExistsAtPath:itemPath]) continue;
+        if (![manager removeItemAtPath:itemPath error:NULL]) suc = NO;
+    }
+    return suc;
 }
 
 - (instancetype)initWithPath:(NSString *)path type:(YYKVStorageType)type {
+    return [self initWithPath:path type:type readerCount:0];
+}
+
+- (instancetype)initWithPath:(NSString *)path type:(YYKVStorageType)type readerCount:(NSUInteger)readerCount {
     if (path.length == 0 || path.length > kPathLengthMax) {
         NSLog(@"YYKVStorage init error: invalid path: [%@].", path);
         return nil;
@@ -670,6 +996,10 @@ static NSString *const kTrashDirectoryName = @"trash";
         NSLog(@"YYKVStorage init error: invalid type: %lu.", (unsigned long)type);
         return nil;
     }
+    if (readerCount > kMaxReaderCount) {
+        NSLog(@"YYKVStorage init error: invalid reader count: %lu.", (unsigned long)readerCount);
+        return nil;
+    }
     
     self = [super init];
     _path = path.copy;
@@ -679,6 +1009,7 @@ static NSString *const kTrashDirectoryName = @"trash";
     _trashQueue = dispatch_queue_create("com.ibireme.cache.disk.trash", DISPATCH_QUEUE_SERIAL);
     _dbPath = [path stringByAppendingPathComponent:kDBFileName];
     _errorLogsEnabled = YES;
+    _mappedReadThreshold = NSUIntegerMax;
     NSError *error = nil;
     if (![[NSFileManager defaultManager] createDirectoryAtPath:path
                                    withIntermediateDirectories:YES
@@ -707,11 +1038,38 @@ static NSString *const kTrashDirectoryName = @"trash";
         }
     }
     [self _fileEmptyTrashInBackground]; // empty the trash if failed at last time
+    
+    if (readerCount > 0) {
+        _readerCount = readerCount;
+        _readers = calloc(readerCount, sizeof(_YYKVStorageReader));
+        if (![self _readersOpen]) {
+            // fallback to the single connection
+            NSLog(@"YYKVStorage init error: fail to open sqlite readers.");
+            free(_readers);
+            _readers = NULL;
+            _readerCount = 0;
+        } else {
+            _readerSemaphore = dispatch_semaphore_create(readerCount);
+            pthread_mutex_init(&_readerPoolLock, NULL);
+            pthread_rwlock_init(&_readerResetLock, NULL);
+            pthread_mutex_init(&_pendingLock, NULL);
+            _pendingAccessTimes = [NSMutableDictionary new];
+            _pendingDeletes = [NSMutableSet new];
+        }
+    }
     return self;
 }
 
 - (void)dealloc {
     UIBackgroundTaskIdentifier taskID = [[UIApplication sharedExtensionApplication] beginBackgroundTaskWithExpirationHandler:^{}];
+    if (_readerSemaphore) { // the readers may be closed by a failed `removeAllItems`
+        [self _dbFlushPendingReads];
+        [self _readersClose];
+        free(_readers);
+        pthread_mutex_destroy(&_readerPoolLock);
+        pthread_rwlock_destroy(&_readerResetLock);
+        pthread_mutex_destroy(&_pendingLock);
+    }
     [self _dbClose];
     if (taskID != UIBackgroundTaskInvalid) {
         [[UIApplication sharedExtensionApplication] endBackgroundTask:taskID];
@@ -731,6 +1089,7 @@ static NSString *const kTrashDirectoryName = @"trash";
     if (_type == YYKVStorageTypeFile && filename.length == 0) {
         return NO;
     }
+    [self _dbFlushPendingReads];
     
     if (filename.length) {
         if (![self _fileWriteWithName:filename data:value]) {
@@ -752,6 +1111,90 @@ static NSString *const kTrashDirectoryName = @"trash";
     }
 }
 
+- (BOOL)saveItems:(NSArray<YYKVStorageItem *> *)items {
+    if (items.count == 0) return NO;
+    for (YYKVStorageItem *item in items) {
+        if (item.key.length == 0 || item.value.length == 0) return NO;
+        if (_type == YYKVStorageTypeFile && item.filename.length == 0) return NO;
+    }
+    [self _dbFlushPendingReads];
+    
+    // Write the file blobs first, so the transaction only contains manifest rows.
+    NSMutableArray *writtenFilenames = [NSMutableArray new];
+    NSMutableArray *inlineKeys = [NSMutableArray new];
+    BOOL suc = YES;
+    for (YYKVStorageItem *item in items) {
+        if (item.filename.length) {
+            if (![self _fileWriteWithName:item.filename data:item.value]) {
+                suc = NO;
+                break;
+            }
+            [writtenFilenames addObject:item.filename];
+        } else if (_type != YYKVStorageTypeSQLite) {
+            [inlineKeys addObject:item.key];
+        }
+    }
+    if (!suc) {
+        for (NSString *filename in writtenFilenames) {
+            [self _fileDeleteWithName:filename];
+        }
+        return NO;
+    }
+    
+    // A savepoint works both inside and outside of a group commit transaction.
+    if (![self _dbExecute:@"savepoint yy_batch_save;"]) {
+        for (NSString *filename in writtenFilenames) {
+            [self _fileDeleteWithName:filename];
+        }
+        return NO;
+    }
+    
+    // Old files of the items which are now stored inline are deleted after commit.
+    NSMutableArray *staleFilenames = nil;
+    if (inlineKeys.count) {
+        staleFilenames = [NSMutableArray new];
+        for (NSString *key in inlineKeys) {
+            NSString *filename = [self _dbGetFilenameWithKey:key];
+            if (filename) [staleFilenames addObject:filename];
+        }
+    }
+    for (YYKVStorageItem *item in items) {
+        NSString *filename = item.filename.length ? item.filename : nil;
+        if (![self _dbSaveWithKey:item.key value:item.value fileName:filename extendedData:item.extendedData]) {
+            suc = NO;
+            break;
+        }
+    }
+    
+    if (suc) {
+        suc = [self _dbExecute:@"release savepoint yy_batch_save;"];
+    }
+    if (!suc) {
+        [self _dbExecute:@"rollback transaction to savepoint yy_batch_save;"];
+        [self _dbExecute:@"release savepoint yy_batch_save;"];
+        for (NSString *filename in writtenFilenames) {
+            [self _fileDeleteWithName:filename];
+        }
+        return NO;
+    }
+    for (NSString *filename in staleFilenames) {
+        [self _fileDeleteWithName:filename];
+    }
+    return YES;
+}
+
+- (BOOL)beginTransaction {
+    return [self _dbBeginTransaction];
+}
+
+- (BOOL)commitTransaction {
+    return [self _dbCommitTransaction];
+}
+
+- (BOOL)isInTransaction {
+    return _dbInTransaction;
+}
+
 - (BOOL)removeItemForKey:(NSString *)key {
     if (key.length == 0) return NO;
     switch (_type) {
@@ -772,6 +1215,18 @@ static NSString *const kTrashDirectoryName = @"trash";
 
 - (BOOL)removeItemForKeys:(NSArray *)keys {
     if (keys.count == 0) return NO;
+    if (keys.count > kMaxJoinedKeyCount) {
+        // Too many host parameters for a single statement, remove in chunks.
+        if (![self _dbExecute:@"savepoint yy_batch_remove;"]) return NO;
+        BOOL suc = YES;
+        for (NSUInteger i = 0, max = keys.count; i < max && suc; i += kMaxJoinedKeyCount) {
+            NSRange range = NSMakeRange(i, MIN(kMaxJoinedKeyCount, max - i));
+            suc = [self removeItemForKeys:[keys subarrayWithRange:range]];
+        }
+        if (!suc) [self _dbExecute:@"rollback transaction to savepoint yy_batch_remove;"];
+        [self _dbExecute:@"release savepoint yy_batch_remove;"];
+        return suc;
+    }
     switch (_type) {
         case YYKVStorageTypeSQLite: {
             return [self _dbDeleteItemWithKeys:keys];
@@ -791,6 +1246,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 - (BOOL)removeItemsLargerThanSize:(int)size {
     if (size == INT_MAX) return YES;
     if (size <= 0) return [self removeAllItems];
+    [self _dbFlushPendingReads];
     
     switch (_type) {
         case YYKVStorageTypeSQLite: {
@@ -817,6 +1273,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 - (BOOL)removeItemsEarlierThanTime:(int)time {
     if (time <= 0) return YES;
     if (time == INT_MAX) return [self removeAllItems];
+    [self _dbFlushPendingReads];
     
     switch (_type) {
         case YYKVStorageTypeSQLite: {
@@ -843,6 +1300,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 - (BOOL)removeItemsToFitSize:(int)maxSize {
     if (maxSize == INT_MAX) return YES;
     if (maxSize <= 0) return [self removeAllItems];
+    [self _dbFlushPendingReads];
     
     int total = [self _dbGetTotalItemSize];
     if (total < 0) return NO;
@@ -873,6 +1331,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 - (BOOL)removeItemsToFitCount:(int)maxCount {
     if (maxCount == INT_MAX) return YES;
     if (maxCount <= 0) return [self removeAllItems];
+    [self _dbFlushPendingReads];
     
     int total = [self _dbGetTotalItemCount];
     if (total < 0) return NO;
@@ -901,15 +1360,34 @@ static NSString *const kTrashDirectoryName = @"trash";
 }
 
 - (BOOL)removeAllItems {
-    if (![self _dbClose]) return NO;
-    [self _reset];
-    if (![self _dbOpen]) return NO;
-    if (![self _dbInitialize]) return NO;
-    return YES;
+    if (_readerCount > 0) {
+        // The readers should not hold the db files which will be removed.
+        pthread_rwlock_wrlock(&_readerResetLock);
+        [self _readersClose];
+        [self _pendingReadsDiscard];
+    }
+    BOOL suc = [self _dbClose];
+    if (suc) {
+        [self _reset];
+        suc = [self _dbOpen] && [self _dbInitialize];
+    }
+    if (_readerCount > 0) {
+        if (!suc || ![self _readersOpen]) {
+            // fallback to the single connection, as init does
+            if (_errorLogsEnabled) NSLog(@"%s line:%d fail to reopen sqlite readers.", __FUNCTION__, __LINE__);
+            [self _readersClose];
+            free(_readers);
+            _readers = NULL;
+            _readerCount = 0;
+        }
+        pthread_rwlock_unlock(&_readerResetLock);
+    }
+    return suc;
 }
 
 - (void)removeAllItemsWithProgressBlock:(void(^)(int removedCount, int totalCount))progress
                                endBlock:(void(^)(BOOL error))end {
+    [self _dbFlushPendingReads];
     
     int total = [self _dbGetTotalItemCount];
     if (total <= 0) {
@@ -942,6 +1420,7 @@ static NSString *const kTrashDirectoryName = @"trash";
 
 - (YYKVStorageItem *)getItemForKey:(NSString *)key {
     if (key.length == 0) return nil;
+    if (_readerCount > 0) return [self _readItemWithKey:key excludeInlineData:NO];
     YYKVStorageItem *item = [self _dbGetItemWithKey:key excludeInlineData:NO];
     if (item) {
         [self _dbUpdateAccessTimeWithKey:key];
@@ -958,12 +1437,14 @@ static NSString *const kTrashDirectoryName = @"trash";
 
 - (YYKVStorageItem *)getItemInfoForKey:(NSString *)key {
     if (key.length == 0) return nil;
+    if (_readerCount > 0) return [self _readItemWithKey:key excludeInlineData:YES];
     YYKVStorageItem *item = [self _dbGetItemWithKey:key excludeInlineData:YES];
     return item;
 }
 
 - (NSData *)getItemValueForKey:(NSString *)key {
     if (key.length == 0) return nil;
+    if (_readerCount > 0) return [self _readItemWithKey:key excludeInlineData:NO].value;
     NSData *value = nil;
     switch (_type) {
         case YYKVStorageTypeFile: {
@@ -1039,14 +1520,23 @@ static NSString *const kTrashDirectoryName = @"trash";
 
 - (BOOL)itemExistsForKey:(NSString *)key {
     if (key.length == 0) return NO;
+    if (_readerCount > 0) return [self _readItemWithKey:key excludeInlineData:YES] != nil;
     return [self _dbGetItemCountWithKey:key] > 0;
 }
 
+- (NSArray *)getItemInfosAfterKey:(NSString *)key limit:(int)count {
+    if (count <= 0) return nil;
+    [self _dbFlushPendingReads];
+    return [self _dbGetItemSizeInfoAfterKey:key limit:count];
+}
+
 - (int)getItemsCount {
+    [self _dbFlushPendingReads];
     return [self _dbGetTotalItemCount];
 }
 
 - (int)getItemsSize {
+    [self _dbFlushPendingReads];
     return [self _dbGetTotalItemSize];
 }
 
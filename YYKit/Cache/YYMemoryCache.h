@@ -11,8 +11,28 @@
 
 #import <Foundation/Foundation.h>
 
+@class YYCacheStatistics;
+
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ The eviction policy of YYMemoryCache.
+ */
+typedef NS_ENUM(NSUInteger, YYMemoryCachePolicy) {
+    
+    /// Least-recently-used, evicts the object which is not accessed for the longest time.
+    YYMemoryCachePolicyLRU = 0,
+    
+    /// W-TinyLFU, a small LRU window in front of a segmented LRU main space, the
+    /// main space admits the new objects by the access frequency (count-min sketch).
+    /// It's resistant to scans and performs better with skewed access patterns.
+    YYMemoryCachePolicyTinyLFU,
+    
+    /// Adaptive Replacement Cache, balances the recency and frequency by the
+    /// history of the recently evicted keys.
+    YYMemoryCachePolicyARC,
+};
+
 /**
  YYMemoryCache is a fast in-memory cache that stores key-value pairs.
  In contrast to NSDictionary, keys are retained and not copied.
@@ -20,8 +40,8 @@ NS_ASSUME_NONNULL_BEGIN
  
  YYMemoryCache objects differ from NSCache in a few ways:
  
- * It uses LRU (least-recently-used) to remove objects; NSCache's eviction method
-   is non-deterministic.
+ * It uses LRU (least-recently-used) to remove objects by default, and W-TinyLFU
+   or ARC can be chosen at init; NSCache's eviction method is non-deterministic.
  * It can be controlled by cost, count and age; NSCache's limits are imprecise.
  * It can be configured to automatically evict objects when receive memory 
    warning or app enter background.
@@ -30,6 +50,44 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @interface YYMemoryCache : NSObject
 
+#pragma mark - Initializer
+///=============================================================================
+/// @name Initializer
+///=============================================================================
+
+/**
+ Create a new cache with LRU policy.
+ */
+- (instancetype)init;
+
+/**
+ Create a new cache with a single segment.
+ 
+ @param policy The eviction policy, used when the cache goes over the cost or
+    count limit. The age limit always evicts the objects which are not accessed
+    for the longest time.
+ 
+ @return A new cache object.
+ */
+- (instancetype)initWithPolicy:(YYMemoryCachePolicy)policy;
+
+/**
+ The designated initializer.
+ 
+ @discussion A segmented cache holds the objects in several independent segments
+ selected by the key's hash, each segment has its own lock, so the threads which
+ access different keys don't wait for each other. The cost and count limits are
+ divided equally between the segments, and each segment evicts objects by itself,
+ so an object may be evicted while the whole cache is still under the limit.
+ 
+ @param policy       The eviction policy of each segment.
+ @param segmentCount The count of segments (1 ~ 64), 1 means no segmentation.
+ 
+ @return A new cache object.
+ */
+- (instancetype)initWithPolicy:(YYMemoryCachePolicy)policy segmentCount:(NSUInteger)segmentCount NS_DESIGNATED_INITIALIZER;
+
+
 #pragma mark - Attribute
 ///=============================================================================
 /// @name Attribute
@@ -38,12 +96,37 @@ NS_ASSUME_NONNULL_BEGIN
 /** The name of the cache. Default is nil. */
 @property (nullable, copy) NSString *name;
 
+/** The eviction policy of the cache (read-only). */
+@property (readonly) YYMemoryCachePolicy policy;
+
+/** The count of segments of the cache (read-only). Default is 1. */
+@property (readonly) NSUInteger segmentCount;
+
 /** The number of objects in the cache (read-only) */
 @property (readonly) NSUInteger totalCount;
 
 /** The total cost of objects in the cache (read-only). */
 @property (readonly) NSUInteger totalCost;
 
+/** The number of objects evicted by the limits and trim methods (read-only). */
+@property (readonly) NSUInteger evictionCount;
+
+/** The total cost of objects evicted by the limits and trim methods (read-only). */
+@property (readonly) NSUInteger evictionCost;
+
+/** 
+ The total time in seconds spent in trim's eviction batches (read-only).
+ `evictionCount / evictionTime` is the eviction throughput of trimming, the 
+ objects evicted in the access methods are counted, but not timed.
+ */
+@property (readonly) NSTimeInterval evictionTime;
+
+/**
+ The statistics of the cache (hit, miss, write, remove and eviction counters,
+ and optional latency), it's updated lock-free and can be reset.
+ */
+@property (readonly) YYCacheStatistics *statistics;
+
 
 #pragma mark - Limit
 ///=============================================================================
@@ -85,6 +168,24 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property NSTimeInterval autoTrimInterval;
 
+/**
+ The maximum number of objects evicted in one lock acquisition while trimming.
+ Default is 64.
+ 
+ @discussion The trim evicts objects in batches, and releases the lock between
+ batches, so the access methods are not blocked by a long trim.
+ */
+@property NSUInteger evictionBatchSize;
+
+/**
+ The maximum time in seconds that one eviction batch can hold the lock.
+ Default is 0.002 (2ms), 0 means no limit.
+ 
+ @discussion A batch ends when `evictionBatchSize` objects are evicted or the
+ time budget is used up, whichever comes first.
+ */
+@property NSTimeInterval evictionTimeBudget;
+
 /**
  If `YES`, the cache will remove all objects when the app receives a memory warning.
  The default value is `YES`.
@@ -122,6 +223,10 @@ NS_ASSUME_NONNULL_BEGIN
  If `YES`, the key-value pair will be released asynchronously to avoid blocking 
  the access methods, otherwise it will be released in the access method  
  (such as removeObjectForKey:). Default is YES.
+ 
+ @discussion The removed and evicted pairs are collected and released in batch,
+ when enough pairs are collected or the cache is trimmed (including the automatic
+ trim, see `autoTrimInterval`), so a removed pair may be alive until then.
  */
 @property BOOL releaseAsynchronously;
 
@@ -10,9 +10,11 @@
 //
 
 #import "YYMemoryCache.h"
+#import "YYCacheStatistics.h"
 #import <UIKit/UIKit.h>
 #import <CoreFoundation/CoreFoundation.h>
 #import <QuartzCore/QuartzCore.h>
+#import <libkern/OSAtomic.h>
 #import <pthread.h>
 
 #if __has_include("YYDispatchQueuePool.h")
@@ -30,66 +32,163 @@ static inline dispatch_queue_t YYMemoryCacheGetReleaseQueue() {
 #endif
 
 /**
- A node in linked map.
- Typically, you should not use this class directly.
+ A node in linked map, the nodes are allocated from the map's node pool.
+ Typically, you should not use this struct directly.
  */
-@interface _YYLinkedMapNode : NSObject {
-    @package
-    __unsafe_unretained _YYLinkedMapNode *_prev; // retained by dic
-    __unsafe_unretained _YYLinkedMapNode *_next; // retained by dic
-    id _key;
-    id _value;
-    NSUInteger _cost;
-    NSTimeInterval _time;
+typedef struct _YYLinkedMapNode _YYLinkedMapNode;
+struct _YYLinkedMapNode {
+    _YYLinkedMapNode *prev;
+    _YYLinkedMapNode *next; ///< also links the free nodes in pool
+    CFTypeRef key;          ///< retained, NULL for free node
+    CFTypeRef value;        ///< retained
+    NSUInteger cost;
+    NSTimeInterval time;
+    uint8_t region;         ///< the list which holds this node, used by the non-LRU policies
+    _YYLinkedMapNode *agePrev; ///< newer node in access time order, used by W-TinyLFU
+    _YYLinkedMapNode *ageNext; ///< older node in access time order, used by W-TinyLFU
+};
+
+/**
+ A chunk of nodes, the nodes never move, so the pointers are stable.
+ */
+typedef struct _YYLinkedMapChunk _YYLinkedMapChunk;
+struct _YYLinkedMapChunk {
+    _YYLinkedMapChunk *next;
+    NSUInteger count;
+    _YYLinkedMapNode nodes[];
+};
+
+static const NSUInteger kMinChunkNodeCount = 32;
+static const NSUInteger kMaxChunkNodeCount = 1024;
+static const CFIndex kMaxReleaseHolderCount = 128;
+
+/// The dic does not retain the key, the key is owned by the node.
+static const CFDictionaryKeyCallBacks kYYLinkedMapKeyCallBacks = {0, NULL, NULL, CFCopyDescription, CFEqual, CFHash};
+
+/// Release the keys and values of the nodes in use, and free the chunks.
+static void _YYLinkedMapChunkFree(_YYLinkedMapChunk *chunk) {
+    while (chunk) {
+        _YYLinkedMapChunk *next = chunk->next;
+        for (NSUInteger i = 0; i < chunk->count; i++) {
+            _YYLinkedMapNode *node = chunk->nodes + i;
+            if (node->key) CFRelease(node->key);
+            if (node->value) CFRelease(node->value);
+        }
+        free(chunk);
+        chunk = next;
+    }
 }
-@end
 
-@implementation _YYLinkedMapNode
-@end
+
+/**
+ A doubly linked list of nodes.
+ */
+typedef struct {
+    _YYLinkedMapNode *head;
+    _YYLinkedMapNode *tail;
+    NSUInteger count;
+} _YYLinkedList;
+
+static inline void _YYLinkedListInsertAtHead(_YYLinkedList *list, _YYLinkedMapNode *node) {
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head) list->head->prev = node;
+    else list->tail = node;
+    list->head = node;
+    list->count++;
+}
+
+static inline void _YYLinkedListRemove(_YYLinkedList *list, _YYLinkedMapNode *node) {
+    if (node->next) node->next->prev = node->prev;
+    else list->tail = node->prev;
+    if (node->prev) node->prev->next = node->next;
+    else list->head = node->next;
+    node->prev = node->next = NULL;
+    list->count--;
+}
+
+static inline void _YYLinkedListBringToHead(_YYLinkedList *list, _YYLinkedMapNode *node) {
+    if (list->head == node) return;
+    _YYLinkedListRemove(list, node);
+    _YYLinkedListInsertAtHead(list, node);
+}
 
 
 /**
  A linked map used by YYMemoryCache.
  It's not thread-safe and does not validate the parameters.
  
+ The base class evicts the nodes with LRU, the subclasses implement the other
+ eviction policies by overriding the policy methods.
+ 
+ The nodes are C structs allocated from a pool, a removed node should be given 
+ back with `recycleNode:`, so the set/evict churn does not allocate memory. The 
+ keys and values of the recycled nodes are released in batch by `flushReleaseHolder`,
+ when the holder is full or at the end of a trim. The holders are reused, so a
+ flush does not allocate memory either.
+ 
  Typically, you should not use this class directly.
  */
 @interface _YYLinkedMap : NSObject {
     @package
-    CFMutableDictionaryRef _dic; // do not set object directly
+    CFMutableDictionaryRef _dic; // key -> node, do not set object directly
     NSUInteger _totalCost;
     NSUInteger _totalCount;
     _YYLinkedMapNode *_head; // MRU, do not change it directly
     _YYLinkedMapNode *_tail; // LRU, do not change it directly
     BOOL _releaseOnMainThread;
     BOOL _releaseAsynchronously;
+    
+    _YYLinkedMapChunk *_chunks;
+    _YYLinkedMapNode *_freeNodes;
+    CFMutableArrayRef _releaseHolder; // keys and values to be released
+    CFMutableArrayRef volatile _spareHolder; // an empty holder given back by the release queue
 }
 
-/// Insert a node at head and update the total cost.
+/// Get a zeroed node from pool.
+- (_YYLinkedMapNode *)allocNode;
+
+/// Give a removed node back to pool, its key and value will be released.
+- (void)recycleNode:(_YYLinkedMapNode *)node;
+
+/// Release the keys and values of the recycled nodes in specified queue.
+- (void)flushReleaseHolder;
+
+/// Insert a new node and update the total cost.
 /// Node and node.key should not be nil.
-- (void)insertNodeAtHead:(_YYLinkedMapNode *)node;
+- (void)insertNode:(_YYLinkedMapNode *)node;
 
-/// Bring a inner node to header.
+/// Tell the policy that a inner node is accessed.
 /// Node should already inside the dic.
-- (void)bringNodeToHead:(_YYLinkedMapNode *)node;
+- (void)accessNode:(_YYLinkedMapNode *)node;
 
 /// Remove a inner node and update the total cost.
 /// Node should already inside the dic.
 - (void)removeNode:(_YYLinkedMapNode *)node;
 
-/// Remove tail node if exist.
-- (_YYLinkedMapNode *)removeTailNode;
+/// Remove the node which should be evicted first, if exist.
+- (_YYLinkedMapNode *)removeEvictionNode;
+
+/// The node with the earliest access time, if exist.
+- (_YYLinkedMapNode *)oldestNode;
 
 /// Remove all node in background queue.
 - (void)removeAll;
 
+/// Add a node to the dic and update the total cost, for subclass.
+- (void)_addNodeToDic:(_YYLinkedMapNode *)node;
+
+/// Remove a node from the dic and update the total cost, for subclass.
+- (void)_removeNodeFromDic:(_YYLinkedMapNode *)node;
+
 @end
 
 @implementation _YYLinkedMap
 
 - (instancetype)init {
     self = [super init];
-    _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kYYLinkedMapKeyCallBacks, NULL);
+    _releaseHolder = CFArrayCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeArrayCallBacks);
     _releaseOnMainThread = NO;
     _releaseAsynchronously = YES;
     return self;
@@ -97,96 +196,570 @@ static inline dispatch_queue_t YYMemoryCacheGetReleaseQueue() {
 
 - (void)dealloc {
     CFRelease(_dic);
+    CFRelease(_releaseHolder);
+    if (_spareHolder) CFRelease(_spareHolder);
+    _YYLinkedMapChunkFree(_chunks);
 }
 
-- (void)insertNodeAtHead:(_YYLinkedMapNode *)node {
-    CFDictionarySetValue(_dic, (__bridge const void *)(node->_key), (__bridge const void *)(node));
-    _totalCost += node->_cost;
-    _totalCount++;
+- (_YYLinkedMapNode *)allocNode {
+    if (!_freeNodes) {
+        NSUInteger count = _chunks ? MIN(_chunks->count * 2, kMaxChunkNodeCount) : kMinChunkNodeCount;
+        _YYLinkedMapChunk *chunk = calloc(1, sizeof(_YYLinkedMapChunk) + count * sizeof(_YYLinkedMapNode));
+        if (!chunk) return NULL;
+        chunk->count = count;
+        chunk->next = _chunks;
+        _chunks = chunk;
+        for (NSUInteger i = 0; i < count; i++) {
+            chunk->nodes[i].next = i + 1 < count ? chunk->nodes + i + 1 : NULL;
+        }
+        _freeNodes = chunk->nodes;
+    }
+    _YYLinkedMapNode *node = _freeNodes;
+    _freeNodes = node->next;
+    node->next = NULL;
+    return node;
+}
+
+- (void)recycleNode:(_YYLinkedMapNode *)node {
+    if (!_releaseAsynchronously && !(_releaseOnMainThread && !pthread_main_np())) {
+        if (node->key) CFRelease(node->key);
+        if (node->value) CFRelease(node->value);
+    } else {
+        // the holder retains them
+        if (node->key) {
+            CFArrayAppendValue(_releaseHolder, node->key);
+            CFRelease(node->key);
+        }
+        if (node->value) {
+            CFArrayAppendValue(_releaseHolder, node->value);
+            CFRelease(node->value);
+        }
+        if (CFArrayGetCount(_releaseHolder) >= kMaxReleaseHolderCount) [self flushReleaseHolder];
+    }
+    memset(node, 0, sizeof(_YYLinkedMapNode));
+    node->next = _freeNodes;
+    _freeNodes = node;
+}
+
+- (void)flushReleaseHolder {
+    if (CFArrayGetCount(_releaseHolder) == 0) return;
+    if (_releaseAsynchronously || _releaseOnMainThread) {
+        // swap in the spare holder, the release queue gives the flushed one back
+        CFMutableArrayRef holder = _releaseHolder;
+        CFMutableArrayRef spare = _spareHolder;
+        if (spare && OSAtomicCompareAndSwapPtrBarrier(spare, NULL, (void * volatile *)&_spareHolder)) {
+            _releaseHolder = spare;
+        } else {
+            _releaseHolder = CFArrayCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeArrayCallBacks);
+        }
+        dispatch_queue_t queue = _releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
+        dispatch_async(queue, ^{
+            CFArrayRemoveAllValues(holder); // release in specified queue
+            if (!OSAtomicCompareAndSwapPtrBarrier(NULL, holder, (void * volatile *)&self->_spareHolder)) {
+                CFRelease(holder);
+            }
+        });
+    } else {
+        CFArrayRemoveAllValues(_releaseHolder);
+    }
+}
+
+- (void)insertNode:(_YYLinkedMapNode *)node {
+    [self _addNodeToDic:node];
     if (_head) {
-        node->_next = _head;
-        _head->_prev = node;
+        node->next = _head;
+        _head->prev = node;
         _head = node;
     } else {
         _head = _tail = node;
     }
 }
 
-- (void)bringNodeToHead:(_YYLinkedMapNode *)node {
+- (void)accessNode:(_YYLinkedMapNode *)node {
     if (_head == node) return;
     
     if (_tail == node) {
-        _tail = node->_prev;
-        _tail->_next = nil;
+        _tail = node->prev;
+        _tail->next = NULL;
     } else {
-        node->_next->_prev = node->_prev;
-        node->_prev->_next = node->_next;
+        node->next->prev = node->prev;
+        node->prev->next = node->next;
     }
-    node->_next = _head;
-    node->_prev = nil;
-    _head->_prev = node;
+    node->next = _head;
+    node->prev = NULL;
+    _head->prev = node;
     _head = node;
 }
 
 - (void)removeNode:(_YYLinkedMapNode *)node {
-    CFDictionaryRemoveValue(_dic, (__bridge const void *)(node->_key));
-    _totalCost -= node->_cost;
-    _totalCount--;
-    if (node->_next) node->_next->_prev = node->_prev;
-    if (node->_prev) node->_prev->_next = node->_next;
-    if (_head == node) _head = node->_next;
-    if (_tail == node) _tail = node->_prev;
+    [self _removeNodeFromDic:node];
+    if (node->next) node->next->prev = node->prev;
+    if (node->prev) node->prev->next = node->next;
+    if (_head == node) _head = node->next;
+    if (_tail == node) _tail = node->prev;
+    node->prev = node->next = NULL;
 }
 
-- (_YYLinkedMapNode *)removeTailNode {
-    if (!_tail) return nil;
+- (_YYLinkedMapNode *)removeEvictionNode {
+    if (!_tail) return NULL;
     _YYLinkedMapNode *tail = _tail;
-    CFDictionaryRemoveValue(_dic, (__bridge const void *)(_tail->_key));
-    _totalCost -= _tail->_cost;
-    _totalCount--;
+    [self _removeNodeFromDic:tail];
     if (_head == _tail) {
-        _head = _tail = nil;
+        _head = _tail = NULL;
     } else {
-        _tail = _tail->_prev;
-        _tail->_next = nil;
+        _tail = _tail->prev;
+        _tail->next = NULL;
     }
+    tail->prev = tail->next = NULL;
     return tail;
 }
 
+- (_YYLinkedMapNode *)oldestNode {
+    return _tail;
+}
+
 - (void)removeAll {
     _totalCost = 0;
     _totalCount = 0;
-    _head = nil;
-    _tail = nil;
-    if (CFDictionaryGetCount(_dic) > 0) {
-        CFMutableDictionaryRef holder = _dic;
-        _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    _head = NULL;
+    _tail = NULL;
+    [self flushReleaseHolder];
+    if (_chunks) {
+        // give the whole pool to the release queue, the nodes in use hold the keys and values
+        _YYLinkedMapChunk *chunks = _chunks;
+        _chunks = NULL;
+        _freeNodes = NULL;
+        if (CFDictionaryGetCount(_dic) > 0) CFDictionaryRemoveAllValues(_dic);
         
         if (_releaseAsynchronously) {
             dispatch_queue_t queue = _releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
             dispatch_async(queue, ^{
-                CFRelease(holder); // hold and release in specified queue
+                _YYLinkedMapChunkFree(chunks); // release in specified queue
             });
         } else if (_releaseOnMainThread && !pthread_main_np()) {
             dispatch_async(dispatch_get_main_queue(), ^{
-                CFRelease(holder); // hold and release in specified queue
+                _YYLinkedMapChunkFree(chunks); // release in specified queue
             });
         } else {
-            CFRelease(holder);
+            _YYLinkedMapChunkFree(chunks);
         }
     }
 }
 
+- (void)_addNodeToDic:(_YYLinkedMapNode *)node {
+    CFDictionarySetValue(_dic, node->key, node);
+    _totalCost += node->cost;
+    _totalCount++;
+}
+
+- (void)_removeNodeFromDic:(_YYLinkedMapNode *)node {
+    CFDictionaryRemoveValue(_dic, node->key);
+    _totalCost -= node->cost;
+    _totalCount--;
+}
+
 @end
 
 
+static inline _YYLinkedMapNode *_YYLinkedMapOlderNode(_YYLinkedMapNode *a, _YYLinkedMapNode *b) {
+    if (!a) return b;
+    if (!b) return a;
+    return a->time <= b->time ? a : b;
+}
 
-@implementation YYMemoryCache {
+
+/**
+ A count-min sketch of 4-bit counters, which estimates the access frequency of
+ the keys in a recent period (the counters are halved periodically).
+ */
+typedef struct {
+    uint8_t *table;    ///< 4 rows of `width` counters
+    NSUInteger width;  ///< power of 2
+    NSUInteger size;   ///< increments since last aging
+} _YYFrequencySketch;
+
+static const NSUInteger kFrequencySketchMaxWidth = 1 << 22;
+
+static void _YYFrequencySketchEnsureCapacity(_YYFrequencySketch *sketch, NSUInteger capacity) {
+    NSUInteger width = 64;
+    while (width < capacity && width < kFrequencySketchMaxWidth) width <<= 1;
+    if (sketch->table && width <= sketch->width) return;
+    uint8_t *table = calloc(4, width);
+    if (!table) return;
+    if (sketch->table) free(sketch->table);
+    sketch->table = table;
+    sketch->width = width;
+    sketch->size = 0;
+}
+
+static inline NSUInteger _YYFrequencySketchIndex(const _YYFrequencySketch *sketch, NSUInteger hash, int row) {
+    static const uint64_t seeds[] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+    uint64_t h = ((uint64_t)hash + seeds[row]) * seeds[row];
+    h ^= h >> 32;
+    return row * sketch->width + (NSUInteger)(h & (sketch->width - 1));
+}
+
+static void _YYFrequencySketchIncrement(_YYFrequencySketch *sketch, NSUInteger hash) {
+    if (!sketch->table) return;
+    for (int i = 0; i < 4; i++) {
+        uint8_t *counter = sketch->table + _YYFrequencySketchIndex(sketch, hash, i);
+        if (*counter < 15) (*counter)++;
+    }
+    if (++sketch->size >= sketch->width * 10) {
+        // aging, keep the recent history
+        for (NSUInteger i = 0, max = sketch->width * 4; i < max; i++) {
+            sketch->table[i] >>= 1;
+        }
+        sketch->size /= 2;
+    }
+}
+
+static uint8_t _YYFrequencySketchEstimate(const _YYFrequencySketch *sketch, NSUInteger hash) {
+    if (!sketch->table) return 0;
+    uint8_t frequency = 15;
+    for (int i = 0; i < 4; i++) {
+        uint8_t counter = sketch->table[_YYFrequencySketchIndex(sketch, hash, i)];
+        if (counter < frequency) frequency = counter;
+    }
+    return frequency;
+}
+
+
+typedef NS_ENUM(uint8_t, _YYTinyLFURegion) {
+    _YYTinyLFURegionWindow = 0,
+    _YYTinyLFURegionProbation,
+    _YYTinyLFURegionProtected,
+};
+
+/**
+ A linked map with W-TinyLFU policy.
+ 
+ The new nodes enter a small LRU window (1% of count), the nodes leaving the 
+ window enter the main space, which is a segmented LRU (probation 20% and 
+ protected 80%). When a node should be evicted, the newest node of probation 
+ (candidate) and the oldest one (victim) are compared with the frequency sketch,
+ and the less frequently used one is evicted. So the one-shot nodes of a scan
+ can't flush out the frequently used nodes.
+ 
+ The probation is not ordered by access time (the nodes from window and protected
+ keep their time), so all the nodes are also linked in access time order by the
+ `agePrev` and `ageNext`, for the age limit.
+ */
+@interface _YYTinyLFUMap : _YYLinkedMap {
+    @package
+    _YYLinkedList _window;
+    _YYLinkedList _probation;
+    _YYLinkedList _protected;
+    _YYFrequencySketch _sketch;
+    _YYLinkedMapNode *_ageHead; // most recently accessed
+    _YYLinkedMapNode *_ageTail; // least recently accessed
+}
+@end
+
+@implementation _YYTinyLFUMap
+
+- (void)dealloc {
+    if (_sketch.table) free(_sketch.table);
+}
+
+- (void)_insertAgeNodeAtHead:(_YYLinkedMapNode *)node {
+    node->agePrev = NULL;
+    node->ageNext = _ageHead;
+    if (_ageHead) _ageHead->agePrev = node;
+    else _ageTail = node;
+    _ageHead = node;
+}
+
+- (void)_removeAgeNode:(_YYLinkedMapNode *)node {
+    if (node->ageNext) node->ageNext->agePrev = node->agePrev;
+    else _ageTail = node->agePrev;
+    if (node->agePrev) node->agePrev->ageNext = node->ageNext;
+    else _ageHead = node->ageNext;
+    node->agePrev = node->ageNext = NULL;
+}
+
+- (_YYLinkedList *)_listForRegion:(uint8_t)region {
+    switch (region) {
+        case _YYTinyLFURegionProbation: return &_probation;
+        case _YYTinyLFURegionProtected: return &_protected;
+        default: return &_window;
+    }
+}
+
+- (void)insertNode:(_YYLinkedMapNode *)node {
+    [self _addNodeToDic:node];
+    _YYFrequencySketchEnsureCapacity(&_sketch, _totalCount);
+    _YYFrequencySketchIncrement(&_sketch, CFHash(node->key));
+    node->region = _YYTinyLFURegionWindow;
+    _YYLinkedListInsertAtHead(&_window, node);
+    [self _insertAgeNodeAtHead:node];
+    
+    NSUInteger windowMax = MAX(1, _totalCount / 100);
+    while (_window.count > windowMax) {
+        _YYLinkedMapNode *tail = _window.tail;
+        _YYLinkedListRemove(&_window, tail);
+        tail->region = _YYTinyLFURegionProbation;
+        _YYLinkedListInsertAtHead(&_probation, tail);
+    }
+}
+
+- (void)accessNode:(_YYLinkedMapNode *)node {
+    _YYFrequencySketchIncrement(&_sketch, CFHash(node->key));
+    if (_ageHead != node) {
+        [self _removeAgeNode:node];
+        [self _insertAgeNodeAtHead:node];
+    }
+    switch (node->region) {
+        case _YYTinyLFURegionWindow: {
+            _YYLinkedListBringToHead(&_window, node);
+        } break;
+        case _YYTinyLFURegionProtected: {
+            _YYLinkedListBringToHead(&_protected, node);
+        } break;
+        case _YYTinyLFURegionProbation: {
+            _YYLinkedListRemove(&_probation, node);
+            node->region = _YYTinyLFURegionProtected;
+            _YYLinkedListInsertAtHead(&_protected, node);
+            NSUInteger protectedMax = MAX(1, (_probation.count + _protected.count) * 4 / 5);
+            while (_protected.count > protectedMax) {
+                _YYLinkedMapNode *tail = _protected.tail;
+                _YYLinkedListRemove(&_protected, tail);
+                tail->region = _YYTinyLFURegionProbation;
+                _YYLinkedListInsertAtHead(&_probation, tail);
+            }
+        } break;
+    }
+}
+
+- (void)removeNode:(_YYLinkedMapNode *)node {
+    _YYLinkedListRemove([self _listForRegion:node->region], node);
+    [self _removeAgeNode:node];
+    [self _removeNodeFromDic:node];
+}
+
+- (_YYLinkedMapNode *)removeEvictionNode {
+    _YYLinkedMapNode *node = NULL;
+    if (_probation.count >= 2) {
+        _YYLinkedMapNode *candidate = _probation.head;
+        _YYLinkedMapNode *victim = _probation.tail;
+        uint8_t candidateFreq = _YYFrequencySketchEstimate(&_sketch, CFHash(candidate->key));
+        uint8_t victimFreq = _YYFrequencySketchEstimate(&_sketch, CFHash(victim->key));
+        node = candidateFreq > victimFreq ? victim : candidate;
+    } else if (_probation.count == 1) {
+        node = _probation.tail;
+    } else if (_protected.count) {
+        node = _protected.tail;
+    } else {
+        node = _window.tail;
+    }
+    if (!node) return NULL;
+    _YYLinkedListRemove([self _listForRegion:node->region], node);
+    [self _removeAgeNode:node];
+    [self _removeNodeFromDic:node];
+    return node;
+}
+
+- (_YYLinkedMapNode *)oldestNode {
+    return _ageTail;
+}
+
+- (void)removeAll {
+    [super removeAll];
+    memset(&_window, 0, sizeof(_YYLinkedList));
+    memset(&_probation, 0, sizeof(_YYLinkedList));
+    memset(&_protected, 0, sizeof(_YYLinkedList));
+    _ageHead = _ageTail = NULL;
+}
+
+@end
+
+
+typedef NS_ENUM(uint8_t, _YYARCRegion) {
+    _YYARCRegionRecent = 0,   ///< T1, seen once recently
+    _YYARCRegionFrequent,     ///< T2, seen at least twice recently
+    _YYARCRegionRecentGhost,  ///< B1, evicted from T1, key only
+    _YYARCRegionFrequentGhost ///< B2, evicted from T2, key only
+};
+
+/**
+ A linked map with ARC (Adaptive Replacement Cache) policy.
+ 
+ The map keeps the keys of the recently evicted nodes (ghosts), and adapts the
+ target size of the recent list by the ghost hits, to balance the recency and
+ frequency. The capacity `c` of ARC is the current count of the map.
+ */
+@interface _YYARCMap : _YYLinkedMap {
+    @package
+    _YYLinkedList _recent;
+    _YYLinkedList _frequent;
+    _YYLinkedList _recentGhost;
+    _YYLinkedList _frequentGhost;
+    CFMutableDictionaryRef _ghostDic;
+    NSUInteger _recentTarget; // the `p` of ARC
+}
+@end
+
+@implementation _YYARCMap
+
+- (instancetype)init {
+    self = [super init];
+    _ghostDic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kYYLinkedMapKeyCallBacks, NULL);
+    return self;
+}
+
+- (void)dealloc {
+    CFRelease(_ghostDic);
+}
+
+- (void)_removeGhost:(_YYLinkedMapNode *)ghost {
+    _YYLinkedListRemove(ghost->region == _YYARCRegionRecentGhost ? &_recentGhost : &_frequentGhost, ghost);
+    CFDictionaryRemoveValue(_ghostDic, ghost->key);
+    [self recycleNode:ghost];
+}
+
+- (void)insertNode:(_YYLinkedMapNode *)node {
+    [self _addNodeToDic:node];
+    _YYLinkedMapNode *ghost = CFDictionaryGetValue(_ghostDic, node->key);
+    if (ghost) {
+        // adapt the target size of recent list
+        if (ghost->region == _YYARCRegionRecentGhost) {
+            NSUInteger delta = MAX(1, _frequentGhost.count / MAX(1, _recentGhost.count));
+            _recentTarget = MIN(_recentTarget + delta, _totalCount);
+        } else {
+            NSUInteger delta = MAX(1, _recentGhost.count / MAX(1, _frequentGhost.count));
+            _recentTarget = _recentTarget > delta ? _recentTarget - delta : 0;
+        }
+        [self _removeGhost:ghost];
+        node->region = _YYARCRegionFrequent;
+        _YYLinkedListInsertAtHead(&_frequent, node);
+    } else {
+        node->region = _YYARCRegionRecent;
+        _YYLinkedListInsertAtHead(&_recent, node);
+    }
+}
+
+- (void)accessNode:(_YYLinkedMapNode *)node {
+    if (node->region == _YYARCRegionRecent) {
+        _YYLinkedListRemove(&_recent, node);
+        node->region = _YYARCRegionFrequent;
+        _YYLinkedListInsertAtHead(&_frequent, node);
+    } else {
+        _YYLinkedListBringToHead(&_frequent, node);
+    }
+}
+
+- (void)removeNode:(_YYLinkedMapNode *)node {
+    _YYLinkedListRemove(node->region == _YYARCRegionRecent ? &_recent : &_frequent, node);
+    [self _removeNodeFromDic:node];
+}
+
+- (_YYLinkedMapNode *)removeEvictionNode {
+    if (_totalCount == 0) return NULL;
+    NSUInteger capacity = _totalCount;
+    BOOL fromRecent = _recent.count > 0 && (_recent.count > _recentTarget || _frequent.count == 0);
+    _YYLinkedMapNode *node = fromRecent ? _recent.tail : _frequent.tail;
+    _YYLinkedListRemove(fromRecent ? &_recent : &_frequent, node);
+    [self _removeNodeFromDic:node];
+    
+    _YYLinkedMapNode *ghost = [self allocNode];
+    if (ghost) {
+        ghost->key = CFRetain(node->key);
+        ghost->region = fromRecent ? _YYARCRegionRecentGhost : _YYARCRegionFrequentGhost;
+        _YYLinkedListInsertAtHead(fromRecent ? &_recentGhost : &_frequentGhost, ghost);
+        CFDictionarySetValue(_ghostDic, ghost->key, ghost);
+    }
+    
+    // |T1| + |B1| <= c, |T1| + |T2| + |B1| + |B2| <= 2c
+    while (_recentGhost.count && _recent.count + _recentGhost.count > capacity) {
+        [self _removeGhost:_recentGhost.tail];
+    }
+    while (_frequentGhost.count && _totalCount + _recentGhost.count + _frequentGhost.count > capacity * 2) {
+        [self _removeGhost:_frequentGhost.tail];
+    }
+    return node;
+}
+
+- (_YYLinkedMapNode *)oldestNode {
+    return _YYLinkedMapOlderNode(_recent.tail, _frequent.tail);
+}
+
+- (void)removeAll {
+    // the ghosts are in the pool, and released with it
+    CFDictionaryRemoveAllValues(_ghostDic);
+    memset(&_recent, 0, sizeof(_YYLinkedList));
+    memset(&_frequent, 0, sizeof(_YYLinkedList));
+    memset(&_recentGhost, 0, sizeof(_YYLinkedList));
+    memset(&_frequentGhost, 0, sizeof(_YYLinkedList));
+    _recentTarget = 0;
+    [super removeAll];
+}
+
+@end
+
+
+static _YYLinkedMap *_YYLinkedMapCreate(YYMemoryCachePolicy policy) {
+    switch (policy) {
+        case YYMemoryCachePolicyTinyLFU: return [_YYTinyLFUMap new];
+        case YYMemoryCachePolicyARC: return [_YYARCMap new];
+        default: return [_YYLinkedMap new];
+    }
+}
+
+
+/**
+ A segment of memory cache, a linked map with its own lock.
+ */
+@interface _YYMemoryCacheSegment : NSObject {
+    @package
     pthread_mutex_t _lock;
-    _YYLinkedMap *_lru;
+    _YYLinkedMap *_map;
+    NSUInteger _evictionCount;
+    NSUInteger _evictionCost;
+    NSTimeInterval _evictionTime;
+}
+- (instancetype)initWithPolicy:(YYMemoryCachePolicy)policy;
+@end
+
+@implementation _YYMemoryCacheSegment
+
+- (instancetype)initWithPolicy:(YYMemoryCachePolicy)policy {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    _map = _YYLinkedMapCreate(policy);
+    return self;
+}
+
+- (void)dealloc {
+    [_map removeAll];
+    pthread_mutex_destroy(&_lock);
+}
+
+@end
+
+
+static const NSUInteger kMaxSegmentCount = 64;
+
+/// The limit of each segment, in proportion to the segment count.
+static inline NSUInteger _YYMemoryCacheSegmentLimit(NSUInteger limit, NSUInteger segmentCount) {
+    if (segmentCount <= 1 || limit == NSUIntegerMax) return limit;
+    return limit / segmentCount + (limit % segmentCount ? 1 : 0);
+}
+
+
+
+@implementation YYMemoryCache {
+    NSArray<_YYMemoryCacheSegment *> *_segments;
     dispatch_queue_t _queue;
 }
 
+- (_YYMemoryCacheSegment *)_segmentForKey:(id)key {
+    NSUInteger count = _segments.count;
+    if (count == 1) return _segments.firstObject;
+    NSUInteger hash = CFHash(key);
+    hash ^= hash >> 16; // mix the high bits, some hashes (e.g. pointers) are aligned
+    return _segments[hash % count];
+}
+
 - (void)_trimRecursively {
     __weak typeof(self) _self = self;
     dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_autoTrimInterval * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
@@ -206,105 +779,152 @@ static inline dispatch_queue_t YYMemoryCacheGetReleaseQueue() {
 }
 
 - (void)_trimToCost:(NSUInteger)costLimit {
+    NSUInteger segmentLimit = _YYMemoryCacheSegmentLimit(costLimit, _segments.count);
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        [self _trimSegment:segment toCost:segmentLimit];
+    }
+}
+
+- (void)_trimToCount:(NSUInteger)countLimit {
+    NSUInteger segmentLimit = _YYMemoryCacheSegmentLimit(countLimit, _segments.count);
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        [self _trimSegment:segment toCount:segmentLimit];
+    }
+}
+
+- (void)_trimToAge:(NSTimeInterval)ageLimit {
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        [self _trimSegment:segment toAge:ageLimit];
+    }
+}
+
+- (void)_trimSegment:(_YYMemoryCacheSegment *)segment toCost:(NSUInteger)costLimit {
+    _YYLinkedMap *map = segment->_map;
     BOOL finish = NO;
-    pthread_mutex_lock(&_lock);
+    pthread_mutex_lock(&segment->_lock);
     if (costLimit == 0) {
-        [_lru removeAll];
+        [map removeAll];
         finish = YES;
-    } else if (_lru->_totalCost <= costLimit) {
+    } else if (map->_totalCost <= costLimit) {
+        [map flushReleaseHolder];
         finish = YES;
     }
-    pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&segment->_lock);
     if (finish) return;
     
-    NSMutableArray *holder = [NSMutableArray new];
+    NSUInteger batchSize = MAX(self.evictionBatchSize, 1);
+    NSTimeInterval timeBudget = self.evictionTimeBudget;
     while (!finish) {
-        if (pthread_mutex_trylock(&_lock) == 0) {
-            if (_lru->_totalCost > costLimit) {
-                _YYLinkedMapNode *node = [_lru removeTailNode];
-                if (node) [holder addObject:node];
-            } else {
+        pthread_mutex_lock(&segment->_lock);
+        NSTimeInterval begin = CACurrentMediaTime();
+        NSUInteger count = 0;
+        while (count < batchSize) {
+            if (map->_totalCost <= costLimit) {
                 finish = YES;
+                break;
             }
-            pthread_mutex_unlock(&_lock);
-        } else {
-            usleep(10 * 1000); //10 ms
+            _YYLinkedMapNode *node = [map removeEvictionNode];
+            if (!node) {
+                finish = YES;
+                break;
+            }
+            segment->_evictionCost += node->cost;
+            [map recycleNode:node];
+            count++;
+            if (timeBudget > 0 && CACurrentMediaTime() - begin >= timeBudget) break;
         }
-    }
-    if (holder.count) {
-        dispatch_queue_t queue = _lru->_releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
-        dispatch_async(queue, ^{
-            [holder count]; // release in queue
-        });
+        [map flushReleaseHolder];
+        segment->_evictionCount += count;
+        segment->_evictionTime += CACurrentMediaTime() - begin;
+        pthread_mutex_unlock(&segment->_lock);
+        [_statistics recordEvictionCount:count];
     }
 }
 
-- (void)_trimToCount:(NSUInteger)countLimit {
+- (void)_trimSegment:(_YYMemoryCacheSegment *)segment toCount:(NSUInteger)countLimit {
+    _YYLinkedMap *map = segment->_map;
     BOOL finish = NO;
-    pthread_mutex_lock(&_lock);
+    pthread_mutex_lock(&segment->_lock);
     if (countLimit == 0) {
-        [_lru removeAll];
+        [map removeAll];
         finish = YES;
-    } else if (_lru->_totalCount <= countLimit) {
+    } else if (map->_totalCount <= countLimit) {
+        [map flushReleaseHolder];
         finish = YES;
     }
-    pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&segment->_lock);
     if (finish) return;
     
-    NSMutableArray *holder = [NSMutableArray new];
+    NSUInteger batchSize = MAX(self.evictionBatchSize, 1);
+    NSTimeInterval timeBudget = self.evictionTimeBudget;
     while (!finish) {
-        if (pthread_mutex_trylock(&_lock) == 0) {
-            if (_lru->_totalCount > countLimit) {
-                _YYLinkedMapNode *node = [_lru removeTailNode];
-                if (node) [holder addObject:node];
-            } else {
+        pthread_mutex_lock(&segment->_lock);
+        NSTimeInterval begin = CACurrentMediaTime();
+        NSUInteger count = 0;
+        while (count < batchSize) {
+            if (map->_totalCount <= countLimit) {
                 finish = YES;
+                break;
             }
-            pthread_mutex_unlock(&_lock);
-        } else {
-            usleep(10 * 1000); //10 ms
+            _YYLinkedMapNode *node = [map removeEvictionNode];
+            if (!node) {
+                finish = YES;
+                break;
+            }
+            segment->_evictionCost += node->cost;
+            [map recycleNode:node];
+            count++;
+            if (timeBudget > 0 && CACurrentMediaTime() - begin >= timeBudget) break;
         }
-    }
-    if (holder.count) {
-        dispatch_queue_t queue = _lru->_releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
-        dispatch_async(queue, ^{
-            [holder count]; // release in queue
-        });
+        [map flushReleaseHolder];
+        segment->_evictionCount += count;
+        segment->_evictionTime += CACurrentMediaTime() - begin;
+        pthread_mutex_unlock(&segment->_lock);
+        [_statistics recordEvictionCount:count];
     }
 }
 
-- (void)_trimToAge:(NSTimeInterval)ageLimit {
+- (void)_trimSegment:(_YYMemoryCacheSegment *)segment toAge:(NSTimeInterval)ageLimit {
+    _YYLinkedMap *map = segment->_map;
     BOOL finish = NO;
     NSTimeInterval now = CACurrentMediaTime();
-    pthread_mutex_lock(&_lock);
+    pthread_mutex_lock(&segment->_lock);
     if (ageLimit <= 0) {
-        [_lru removeAll];
-        finish = YES;
-    } else if (!_lru->_tail || (now - _lru->_tail->_time) <= ageLimit) {
+        [map removeAll];
         finish = YES;
+    } else {
+        _YYLinkedMapNode *oldest = [map oldestNode];
+        if (!oldest || (now - oldest->time) <= ageLimit) {
+            [map flushReleaseHolder];
+            finish = YES;
+        }
     }
-    pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&segment->_lock);
     if (finish) return;
     
-    NSMutableArray *holder = [NSMutableArray new];
+    NSUInteger batchSize = MAX(self.evictionBatchSize, 1);
+    NSTimeInterval timeBudget = self.evictionTimeBudget;
     while (!finish) {
-        if (pthread_mutex_trylock(&_lock) == 0) {
-            if (_lru->_tail && (now - _lru->_tail->_time) > ageLimit) {
-                _YYLinkedMapNode *node = [_lru removeTailNode];
-                if (node) [holder addObject:node];
-            } else {
+        pthread_mutex_lock(&segment->_lock);
+        NSTimeInterval begin = CACurrentMediaTime();
+        NSUInteger count = 0;
+        while (count < batchSize) {
+            _YYLinkedMapNode *node = [map oldestNode];
+            if (!node || (now - node->time) <= ageLimit) {
                 finish = YES;
+                break;
             }
-            pthread_mutex_unlock(&_lock);
-        } else {
-            usleep(10 * 1000); //10 ms
+            [map removeNode:node];
+            segment->_evictionCost += node->cost;
+            [map recycleNode:node];
+            count++;
+            if (timeBudget > 0 && CACurrentMediaTime() - begin >= timeBudget) break;
         }
-    }
-    if (holder.count) {
-        dispatch_queue_t queue = _lru->_releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
-        dispatch_async(queue, ^{
-            [holder count]; // release in queue
-        });
+        [map flushReleaseHolder];
+        segment->_evictionCount += count;
+        segment->_evictionTime += CACurrentMediaTime() - begin;
+        pthread_mutex_unlock(&segment->_lock);
+        [_statistics recordEvictionCount:count];
     }
 }
 
@@ -329,15 +949,32 @@ static inline dispatch_queue_t YYMemoryCacheGetReleaseQueue() {
 #pragma mark - public
 
 - (instancetype)init {
+    return [self initWithPolicy:YYMemoryCachePolicyLRU segmentCount:1];
+}
+
+- (instancetype)initWithPolicy:(YYMemoryCachePolicy)policy {
+    return [self initWithPolicy:policy segmentCount:1];
+}
+
+- (instancetype)initWithPolicy:(YYMemoryCachePolicy)policy segmentCount:(NSUInteger)segmentCount {
     self = super.init;
-    pthread_mutex_init(&_lock, NULL);
-    _lru = [_YYLinkedMap new];
+    if (segmentCount == 0) segmentCount = 1;
+    if (segmentCount > kMaxSegmentCount) segmentCount = kMaxSegmentCount;
+    NSMutableArray *segments = [NSMutableArray arrayWithCapacity:segmentCount];
+    for (NSUInteger i = 0; i < segmentCount; i++) {
+        [segments addObject:[[_YYMemoryCacheSegment alloc] initWithPolicy:policy]];
+    }
+    _segments = segments;
+    _policy = policy;
     _queue = dispatch_queue_create("com.ibireme.cache.memory", DISPATCH_QUEUE_SERIAL);
     
     _countLimit = NSUIntegerMax;
     _costLimit = NSUIntegerMax;
     _ageLimit = DBL_MAX;
     _autoTrimInterval = 5.0;
+    _evictionBatchSize = 64;
+    _evictionTimeBudget = 0.002;
+    _statistics = [YYCacheStatistics new];
     _shouldRemoveAllObjectsOnMemoryWarning = YES;
     _shouldRemoveAllObjectsWhenEnteringBackground = YES;
     
@@ -351,68 +988,120 @@ static inline dispatch_queue_t YYMemoryCacheGetReleaseQueue() {
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidEnterBackgroundNotification object:nil];
-    [_lru removeAll];
-    pthread_mutex_destroy(&_lock);
+}
+
+- (NSUInteger)segmentCount {
+    return _segments.count;
 }
 
 - (NSUInteger)totalCount {
-    pthread_mutex_lock(&_lock);
-    NSUInteger count = _lru->_totalCount;
-    pthread_mutex_unlock(&_lock);
+    NSUInteger count = 0;
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        count += segment->_map->_totalCount;
+        pthread_mutex_unlock(&segment->_lock);
+    }
     return count;
 }
 
 - (NSUInteger)totalCost {
-    pthread_mutex_lock(&_lock);
-    NSUInteger totalCost = _lru->_totalCost;
-    pthread_mutex_unlock(&_lock);
+    NSUInteger totalCost = 0;
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        totalCost += segment->_map->_totalCost;
+        pthread_mutex_unlock(&segment->_lock);
+    }
     return totalCost;
 }
 
+- (NSUInteger)evictionCount {
+    NSUInteger count = 0;
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        count += segment->_evictionCount;
+        pthread_mutex_unlock(&segment->_lock);
+    }
+    return count;
+}
+
+- (NSUInteger)evictionCost {
+    NSUInteger cost = 0;
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        cost += segment->_evictionCost;
+        pthread_mutex_unlock(&segment->_lock);
+    }
+    return cost;
+}
+
+- (NSTimeInterval)evictionTime {
+    NSTimeInterval time = 0;
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        time += segment->_evictionTime;
+        pthread_mutex_unlock(&segment->_lock);
+    }
+    return time;
+}
+
 - (BOOL)releaseOnMainThread {
-    pthread_mutex_lock(&_lock);
-    BOOL releaseOnMainThread = _lru->_releaseOnMainThread;
-    pthread_mutex_unlock(&_lock);
+    _YYMemoryCacheSegment *segment = _segments.firstObject;
+    pthread_mutex_lock(&segment->_lock);
+    BOOL releaseOnMainThread = segment->_map->_releaseOnMainThread;
+    pthread_mutex_unlock(&segment->_lock);
     return releaseOnMainThread;
 }
 
 - (void)setReleaseOnMainThread:(BOOL)releaseOnMainThread {
-    pthread_mutex_lock(&_lock);
-    _lru->_releaseOnMainThread = releaseOnMainThread;
-    pthread_mutex_unlock(&_lock);
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        segment->_map->_releaseOnMainThread = releaseOnMainThread;
+        pthread_mutex_unlock(&segment->_lock);
+    }
 }
 
 - (BOOL)releaseAsynchronously {
-    pthread_mutex_lock(&_lock);
-    BOOL releaseAsynchronously = _lru->_releaseAsynchronously;
-    pthread_mutex_unlock(&_lock);
+    _YYMemoryCacheSegment *segment = _segments.firstObject;
+    pthread_mutex_lock(&segment->_lock);
+    BOOL releaseAsynchronously = segment->_map->_releaseAsynchronously;
+    pthread_mutex_unlock(&segment->_lock);
     return releaseAsynchronously;
 }
 
 - (void)setReleaseAsynchronously:(BOOL)releaseAsynchronously {
-    pthread_mutex_lock(&_lock);
-    _lru->_releaseAsynchronously = releaseAsynchronously;
-    pthread_mutex_unlock(&_lock);
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        segment->_map->_releaseAsynchronously = releaseAsynchronously;
+        pthread_mutex_unlock(&segment->_lock);
+    }
 }
 
 - (BOOL)containsObjectForKey:(id)key {
     if (!key) return NO;
-    pthread_mutex_lock(&_lock);
-    BOOL contains = CFDictionaryContainsKey(_lru->_dic, (__bridge const void *)(key));
-    pthread_mutex_unlock(&_lock);
+    _YYMemoryCacheSegment *segment = [self _segmentForKey:key];
+    pthread_mutex_lock(&segment->_lock);
+    BOOL contains = CFDictionaryContainsKey(segment->_map->_dic, (__bridge CFTypeRef)(key));
+    pthread_mutex_unlock(&segment->_lock);
     return contains;
 }
 
 - (id)objectForKey:(id)key {
     if (!key) return nil;
-    pthread_mutex_lock(&_lock);
-    _YYLinkedMapNode *node = CFDictionaryGetValue(_lru->_dic, (__bridge const void *)(key));
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
+    _YYMemoryCacheSegment *segment = [self _segmentForKey:key];
+    pthread_mutex_lock(&segment->_lock);
+    _YYLinkedMapNode *node = (_YYLinkedMapNode *)CFDictionaryGetValue(segment->_map->_dic, (__bridge CFTypeRef)(key));
+    id value = nil;
     if (node) {
-        node->_time = CACurrentMediaTime();
-        [_lru bringNodeToHead:node];
+        node->time = CACurrentMediaTime();
+        [segment->_map accessNode:node];
+        value = (__bridge id)(node->value); // retain it before unlock
     }
-    pthread_mutex_unlock(&_lock);
-    return node ? node->_value : nil;
+    pthread_mutex_unlock(&segment->_lock);
+    [_statistics recordReadWithHit:value != nil bytes:0];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRead];
+    return value;
 }
 
 - (void)setObject:(id)object forKey:(id)key {
@@ -425,69 +1114,78 @@ static inline dispatch_queue_t YYMemoryCacheGetReleaseQueue() {
         [self removeObjectForKey:key];
         return;
     }
-    pthread_mutex_lock(&_lock);
-    _YYLinkedMapNode *node = CFDictionaryGetValue(_lru->_dic, (__bridge const void *)(key));
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
+    NSUInteger segmentCount = _segments.count;
+    NSUInteger costLimit = _YYMemoryCacheSegmentLimit(_costLimit, segmentCount);
+    NSUInteger countLimit = _YYMemoryCacheSegmentLimit(_countLimit, segmentCount);
+    _YYMemoryCacheSegment *segment = [self _segmentForKey:key];
+    _YYLinkedMap *map = segment->_map;
+    pthread_mutex_lock(&segment->_lock);
+    _YYLinkedMapNode *node = (_YYLinkedMapNode *)CFDictionaryGetValue(map->_dic, (__bridge CFTypeRef)(key));
     NSTimeInterval now = CACurrentMediaTime();
     if (node) {
-        _lru->_totalCost -= node->_cost;
-        _lru->_totalCost += cost;
-        node->_cost = cost;
-        node->_time = now;
-        node->_value = object;
-        [_lru bringNodeToHead:node];
+        map->_totalCost -= node->cost;
+        map->_totalCost += cost;
+        node->cost = cost;
+        node->time = now;
+        CFTypeRef oldValue = node->value;
+        node->value = CFBridgingRetain(object);
+        CFRelease(oldValue);
+        [map accessNode:node];
     } else {
-        node = [_YYLinkedMapNode new];
-        node->_cost = cost;
-        node->_time = now;
-        node->_key = key;
-        node->_value = object;
-        [_lru insertNodeAtHead:node];
-    }
-    if (_lru->_totalCost > _costLimit) {
+        node = [map allocNode];
+        if (!node) {
+            pthread_mutex_unlock(&segment->_lock);
+            return;
+        }
+        node->cost = cost;
+        node->time = now;
+        node->key = CFBridgingRetain(key);
+        node->value = CFBridgingRetain(object);
+        [map insertNode:node];
+    }
+    if (map->_totalCost > costLimit) {
         dispatch_async(_queue, ^{
-            [self trimToCost:_costLimit];
+            [self _trimSegment:segment toCost:costLimit];
         });
     }
-    if (_lru->_totalCount > _countLimit) {
-        _YYLinkedMapNode *node = [_lru removeTailNode];
-        if (_lru->_releaseAsynchronously) {
-            dispatch_queue_t queue = _lru->_releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
-            dispatch_async(queue, ^{
-                [node class]; //hold and release in queue
-            });
-        } else if (_lru->_releaseOnMainThread && !pthread_main_np()) {
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [node class]; //hold and release in queue
-            });
+    if (map->_totalCount > countLimit) {
+        _YYLinkedMapNode *node = [map removeEvictionNode];
+        if (node) {
+            segment->_evictionCount++;
+            segment->_evictionCost += node->cost;
+            [map recycleNode:node];
+            [_statistics recordEvictionCount:1];
         }
     }
-    pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&segment->_lock);
+    [_statistics recordWriteWithBytes:0];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationWrite];
 }
 
 - (void)removeObjectForKey:(id)key {
     if (!key) return;
-    pthread_mutex_lock(&_lock);
-    _YYLinkedMapNode *node = CFDictionaryGetValue(_lru->_dic, (__bridge const void *)(key));
+    BOOL recordsLatency = _statistics.recordsLatency;
+    NSTimeInterval begin = recordsLatency ? CACurrentMediaTime() : 0;
+    _YYMemoryCacheSegment *segment = [self _segmentForKey:key];
+    pthread_mutex_lock(&segment->_lock);
+    _YYLinkedMapNode *node = (_YYLinkedMapNode *)CFDictionaryGetValue(segment->_map->_dic, (__bridge CFTypeRef)(key));
     if (node) {
-        [_lru removeNode:node];
-        if (_lru->_releaseAsynchronously) {
-            dispatch_queue_t queue = _lru->_releaseOnMainThread ? dispatch_get_main_queue() : YYMemoryCacheGetReleaseQueue();
-            dispatch_async(queue, ^{
-                [node class]; //hold and release in queue
-            });
-        } else if (_lru->_releaseOnMainThread && !pthread_main_np()) {
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [node class]; //hold and release in queue
-            });
-        }
+        [segment->_map removeNode:node];
+        [segment->_map recycleNode:node];
     }
-    pthread_mutex_unlock(&_lock);
+    pthread_mutex_unlock(&segment->_lock);
+    [_statistics recordRemoveCount:1];
+    if (recordsLatency) [_statistics recordLatency:CACurrentMediaTime() - begin forOperation:YYCacheOperationRemove];
 }
 
 - (void)removeAllObjects {
-    pthread_mutex_lock(&_lock);
-    [_lru removeAll];
-    pthread_mutex_unlock(&_lock);
+    for (_YYMemoryCacheSegment *segment in _segments) {
+        pthread_mutex_lock(&segment->_lock);
+        [segment->_map removeAll];
+        pthread_mutex_unlock(&segment->_lock);
+    }
 }
 
 - (void)trimToCount:(NSUInteger)count {
@@ -23,7 +23,8 @@ NS_ASSUME_NONNULL_BEGIN
  
  This view request the frame data just in time. When the device has enough free memory, 
  this view may cache some or all future frames in an inner buffer for lower CPU cost.
- Buffer size is dynamically adjusted based on the current state of the device memory.
+ Buffer size is dynamically adjusted based on the current state of the device memory,
+ and the memory budget is shared by all the animated image views (see `sharedMaxBufferSize`).
  
  Sample Code:
  
@@ -75,11 +76,31 @@ NS_ASSUME_NONNULL_BEGIN
  the max buffer size will be dynamically adjusted based on the current state of 
  the device free memory. Otherwise, the buffer size will be limited by this value.
  
+ If the buffer can't hold all the frames, half of the buffer size is used to keep
+ the frames in a compressed (run-length encoded) form, which are expanded just before 
+ display instead of decoding the original frames again.
+ 
  When receive memory warning or app enter background, the buffer will be released 
  immediately, and may grow back at the right time.
  */
 @property (nonatomic) NSUInteger maxBufferSize;
 
+/**
+ The max size (in bytes) of the frame buffers of all the animated image views,
+ default is 0 (dynamically).
+ 
+ @discussion The buffer budget is shared by all the views which are playing 
+ animation, so many views on screen (such as stickers in a chat) don't use more 
+ memory than a single view. The views on screen get a larger share than the views 
+ off screen, and each view's buffer is also limited by its `maxBufferSize`.
+ The decoded frames are shared among the views which display the same image.
+ 
+ If this value is 0, the budget will be dynamically adjusted based on the current
+ state of the device free memory.
+ */
++ (NSUInteger)sharedMaxBufferSize;
++ (void)setSharedMaxBufferSize:(NSUInteger)sharedMaxBufferSize;
+
 @end
 
 
@@ -14,8 +14,190 @@
 #import "UIDevice+YYAdd.h"
 #import "YYImageCoder.h"
 #import "YYKitMacro.h"
+#import <pthread.h>
 
 #define BUFFER_SIZE (10 * 1024 * 1024) // 10MB (minimum memory buffer size)
+#define BUFFER_WEIGHT_VISIBLE 4 // buffer share weight of a playing view on screen
+#define BUFFER_WEIGHT_INVISIBLE 1 // buffer share weight of a playing view off screen
+
+#pragma mark - Compressed Frame
+
+/*
+ A compressed frame keeps a decoded 32-bit bitmap with run-length encoding:
+ [header] [chunk] [chunk] ...
+ Each chunk starts with a 32-bit word, if the high bit is set, the low 31 bits 
+ is the count of a repeated pixel which follows the word, otherwise it's the count
+ of the literal pixels which follow the word. The row padding is not stored.
+ 
+ It's much cheaper to expand than decoding the original frame, and the animated
+ images (such as stickers) usually have large areas of the same color.
+ */
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t bitmapInfo;
+    uint32_t orientation;
+    float scale;
+} YYCompressedFrameHeader;
+
+typedef struct {
+    uint8_t *cur;
+    uint8_t *end;
+    uint8_t *literal; ///< the word of current literal chunk, NULL if not in literal chunk
+    uint32_t literalCount;
+} YYCompressedFrameWriter;
+
+static inline void YYCompressedFrameCloseLiteral(YYCompressedFrameWriter *writer) {
+    if (writer->literal) {
+        memcpy(writer->literal, &writer->literalCount, 4);
+        writer->literal = NULL;
+        writer->literalCount = 0;
+    }
+}
+
+static inline BOOL YYCompressedFrameWriteRun(YYCompressedFrameWriter *writer, uint32_t pixel, uint32_t count) {
+    if (count == 1) { // append to literal chunk
+        if (!writer->literal) {
+            if (writer->end - writer->cur < 8) return NO;
+            writer->literal = writer->cur;
+            writer->cur += 4;
+        } else if (writer->end - writer->cur < 4) {
+            return NO;
+        }
+        memcpy(writer->cur, &pixel, 4);
+        writer->cur += 4;
+        writer->literalCount++;
+        return YES;
+    }
+    if (writer->end - writer->cur < 8) return NO;
+    YYCompressedFrameCloseLiteral(writer);
+    uint32_t word = count | 0x80000000;
+    memcpy(writer->cur, &word, 4);
+    memcpy(writer->cur + 4, &pixel, 4);
+    writer->cur += 8;
+    return YES;
+}
+
+/// Compresses a decoded frame, returns nil if the frame is not 32-bit bitmap
+/// or the compressed size is larger than 3/4 of the bitmap size.
+static NSData *YYCompressedFrameCreate(UIImage *image) {
+    CGImageRef imageRef = image.CGImage;
+    if (!imageRef) return nil;
+    if (CGImageGetBitsPerPixel(imageRef) != 32 || CGImageGetBitsPerComponent(imageRef) != 8) return nil;
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    size_t bytesPerRow = CGImageGetBytesPerRow(imageRef);
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF / height) return nil;
+    
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    if (!data) return nil;
+    if ((size_t)CFDataGetLength(data) < bytesPerRow * (height - 1) + width * 4) {
+        CFRelease(data);
+        return nil;
+    }
+    
+    size_t limit = width * height * 3; // 3/4 of the bitmap size
+    NSMutableData *result = [NSMutableData dataWithLength:sizeof(YYCompressedFrameHeader) + limit];
+    YYCompressedFrameWriter writer = {0};
+    writer.cur = (uint8_t *)result.mutableBytes + sizeof(YYCompressedFrameHeader);
+    writer.end = (uint8_t *)result.mutableBytes + result.length;
+    
+    const uint8_t *bytes = CFDataGetBytePtr(data);
+    uint32_t runPixel = 0, runCount = 0;
+    BOOL suc = YES;
+    for (size_t y = 0; y < height && suc; y++) {
+        const uint8_t *row = bytes + y * bytesPerRow;
+        for (size_t x = 0; x < width; x++) {
+            uint32_t pixel;
+            memcpy(&pixel, row + x * 4, 4);
+            if (runCount && pixel == runPixel) {
+                runCount++;
+                continue;
+            }
+            if (runCount && !YYCompressedFrameWriteRun(&writer, runPixel, runCount)) {
+                suc = NO;
+                break;
+            }
+            runPixel = pixel;
+            runCount = 1;
+        }
+    }
+    if (suc) suc = YYCompressedFrameWriteRun(&writer, runPixel, runCount);
+    YYCompressedFrameCloseLiteral(&writer);
+    CFRelease(data);
+    if (!suc) return nil;
+    
+    YYCompressedFrameHeader header = {0};
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.bitmapInfo = CGImageGetBitmapInfo(imageRef);
+    header.orientation = (uint32_t)image.imageOrientation;
+    header.scale = image.scale;
+    memcpy(result.mutableBytes, &header, sizeof(header));
+    result.length = writer.cur - (uint8_t *)result.mutableBytes;
+    return result.copy;
+}
+
+static void YYCompressedFrameReleaseData(void *info, const void *data, size_t size) {
+    if (info) free(info);
+}
+
+/// Expands a compressed frame to a decoded image.
+static UIImage *YYCompressedFrameCreateImage(NSData *data) {
+    if (data.length < sizeof(YYCompressedFrameHeader)) return nil;
+    YYCompressedFrameHeader header;
+    memcpy(&header, data.bytes, sizeof(header));
+    size_t width = header.width, height = header.height;
+    if (width == 0 || height == 0) return nil;
+    size_t bytesPerRow = (width * 4 + 31) & ~(size_t)31;
+    size_t total = width * height;
+    uint8_t *pixels = malloc(bytesPerRow * height);
+    if (!pixels) return nil;
+    
+    const uint8_t *cur = (const uint8_t *)data.bytes + sizeof(header);
+    const uint8_t *end = (const uint8_t *)data.bytes + data.length;
+    size_t index = 0, x = 0;
+    uint8_t *row = pixels;
+    while (cur + 4 <= end && index < total) {
+        uint32_t word;
+        memcpy(&word, cur, 4);
+        cur += 4;
+        BOOL isRun = (word & 0x80000000) != 0;
+        size_t count = word & 0x7FFFFFFF;
+        if (count > total - index) break;
+        if (isRun && cur + 4 > end) break;
+        if (!isRun && (size_t)(end - cur) < count * 4) break;
+        const uint8_t *src = cur;
+        cur += isRun ? 4 : count * 4;
+        for (size_t i = 0; i < count; i++) {
+            memcpy(row + x * 4, src, 4);
+            if (!isRun) src += 4;
+            if (++x == width) {
+                x = 0;
+                row += bytesPerRow;
+            }
+        }
+        index += count;
+    }
+    if (index != total) {
+        free(pixels);
+        return nil;
+    }
+    
+    CGDataProviderRef provider = CGDataProviderCreateWithData(pixels, pixels, bytesPerRow * height, YYCompressedFrameReleaseData);
+    if (!provider) {
+        free(pixels);
+        return nil;
+    }
+    CGImageRef imageRef = CGImageCreate(width, height, 8, 32, bytesPerRow, YYCGColorSpaceGetDeviceRGB(), header.bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    CFRelease(provider);
+    if (!imageRef) return nil;
+    UIImage *image = [UIImage imageWithCGImage:imageRef scale:header.scale orientation:(UIImageOrientation)header.orientation];
+    CFRelease(imageRef);
+    image.isDecodedForDisplay = YES;
+    return image;
+}
+
 
 #define LOCK(...) dispatch_semaphore_wait(self->_lock, DISPATCH_TIME_FOREVER); \
 __VA_ARGS__; \
@@ -55,6 +237,10 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
     NSMutableDictionary *_buffer; ///< frame buffer
     BOOL _bufferMiss; ///< whether miss frame on last opportunity
     NSUInteger _maxBufferCount; ///< maximum buffer count
+    NSUInteger _bufferGeneration; ///< buffer pool generation when _maxBufferCount is calculated
+    NSMutableDictionary *_compressedBuffer; ///< compressed frame buffer (NSData, or NSNull if not compressible)
+    NSUInteger _compressedSize; ///< total bytes of compressed frames
+    NSUInteger _maxCompressedSize; ///< maximum bytes of compressed frames, 0 if frames are not compressed
     NSInteger _incrBufferCount; ///< current allowed buffer count (will increase by step)
     
     CGRect _curContentsRect;
@@ -64,6 +250,130 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
 - (void)calcMaxBufferCount;
 @end
 
+
+/**
+ A process-wide pool shared by all animated image views.
+ 
+ It divides a global memory budget among the views which are playing animation
+ (the views on screen get a larger share), and shares the decoded frames among 
+ the views which are displaying the same image.
+ */
+@interface _YYAnimatedImageBufferPool : NSObject
++ (instancetype)sharedPool;
+@property (nonatomic) NSUInteger maxBufferSize; ///< global budget in bytes, 0 means dynamically
+@property (nonatomic, readonly) NSUInteger generation; ///< increased when the shares are changed
+- (void)setWeight:(NSUInteger)weight forView:(YYAnimatedImageView *)view; ///< 0 to remove the view
+- (int64_t)bufferSizeForView:(YYAnimatedImageView *)view;
+- (UIImage *)frameForImage:(id)image atIndex:(NSUInteger)index;
+- (void)setFrame:(UIImage *)frame forImage:(id)image atIndex:(NSUInteger)index;
+@end
+
+@implementation _YYAnimatedImageBufferPool {
+    pthread_mutex_t _lock;
+    NSUInteger _maxBufferSize;
+    NSUInteger _generation;
+    NSMutableDictionary *_weights; ///< view pointer (NSValue) -> weight (NSNumber)
+    NSUInteger _totalWeight;
+    NSMapTable *_frames; ///< image (weak) -> NSMapTable<index, frame (weak)>
+}
+
++ (instancetype)sharedPool {
+    static _YYAnimatedImageBufferPool *pool;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pool = [self new];
+    });
+    return pool;
+}
+
+- (instancetype)init {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    _weights = [NSMutableDictionary new];
+    _frames = [NSMapTable weakToStrongObjectsMapTable];
+    return self;
+}
+
+- (NSUInteger)maxBufferSize {
+    pthread_mutex_lock(&_lock);
+    NSUInteger size = _maxBufferSize;
+    pthread_mutex_unlock(&_lock);
+    return size;
+}
+
+- (void)setMaxBufferSize:(NSUInteger)maxBufferSize {
+    pthread_mutex_lock(&_lock);
+    if (_maxBufferSize != maxBufferSize) {
+        _maxBufferSize = maxBufferSize;
+        _generation++;
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSUInteger)generation {
+    pthread_mutex_lock(&_lock);
+    NSUInteger generation = _generation;
+    pthread_mutex_unlock(&_lock);
+    return generation;
+}
+
+- (void)setWeight:(NSUInteger)weight forView:(YYAnimatedImageView *)view {
+    NSValue *key = [NSValue valueWithPointer:(__bridge const void *)view];
+    pthread_mutex_lock(&_lock);
+    NSUInteger oldWeight = ((NSNumber *)_weights[key]).unsignedIntegerValue;
+    if (oldWeight != weight) {
+        if (weight) _weights[key] = @(weight);
+        else [_weights removeObjectForKey:key];
+        _totalWeight = _totalWeight - oldWeight + weight;
+        _generation++;
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (int64_t)bufferSizeForView:(YYAnimatedImageView *)view {
+    NSValue *key = [NSValue valueWithPointer:(__bridge const void *)view];
+    pthread_mutex_lock(&_lock);
+    int64_t max = _maxBufferSize;
+    NSUInteger weight = ((NSNumber *)_weights[key]).unsignedIntegerValue;
+    NSUInteger totalWeight = _totalWeight;
+    pthread_mutex_unlock(&_lock);
+    
+    if (max == 0) { // dynamically adjust budget for current memory.
+        int64_t total = [UIDevice currentDevice].memoryTotal;
+        int64_t free = [UIDevice currentDevice].memoryFree;
+        max = MIN(total * 0.2, free * 0.6);
+        max = MAX(max, BUFFER_SIZE);
+    }
+    if (weight == 0) { // the view is not playing, assume it will play with a minimum share
+        weight = BUFFER_WEIGHT_INVISIBLE;
+        totalWeight += weight;
+    }
+    return (double)max * weight / totalWeight;
+}
+
+- (UIImage *)frameForImage:(id)image atIndex:(NSUInteger)index {
+    if (!image) return nil;
+    pthread_mutex_lock(&_lock);
+    NSMapTable *frames = [_frames objectForKey:image];
+    UIImage *frame = [frames objectForKey:@(index)];
+    pthread_mutex_unlock(&_lock);
+    return frame;
+}
+
+- (void)setFrame:(UIImage *)frame forImage:(id)image atIndex:(NSUInteger)index {
+    if (!image || !frame) return;
+    pthread_mutex_lock(&_lock);
+    NSMapTable *frames = [_frames objectForKey:image];
+    if (!frames) {
+        frames = [NSMapTable strongToWeakObjectsMapTable];
+        [_frames setObject:frames forKey:image];
+    }
+    [frames setObject:frame forKey:@(index)];
+    pthread_mutex_unlock(&_lock);
+}
+
+@end
+
 /// An operation for image fetch
 @interface _YYAnimatedImageViewFetchOperation : NSOperation
 @property (nonatomic, weak) YYAnimatedImageView *view;
@@ -76,14 +386,33 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
     __strong YYAnimatedImageView *view = _view;
     if (!view) return;
     if ([self isCancelled]) return;
+    _YYAnimatedImageBufferPool *pool = [_YYAnimatedImageBufferPool sharedPool];
     view->_incrBufferCount++;
-    if (view->_incrBufferCount == 0) [view calcMaxBufferCount];
+    if (view->_incrBufferCount == 0 || view->_bufferGeneration != pool.generation) {
+        [view calcMaxBufferCount];
+    }
     if (view->_incrBufferCount > (NSInteger)view->_maxBufferCount) {
         view->_incrBufferCount = view->_maxBufferCount;
     }
     NSUInteger idx = _nextIndex;
     NSUInteger max = view->_incrBufferCount < 1 ? 1 : view->_incrBufferCount;
     NSUInteger total = view->_totalFrameCount;
+    
+    // the share may be reduced by other views, drop the frames out of the new range
+    LOCK_VIEW(
+         if (view->_buffer.count > max) {
+             NSArray *keys = view->_buffer.allKeys;
+             for (NSNumber *key in keys) {
+                 if ((key.unsignedIntegerValue + total - idx) % total >= max) {
+                     [view->_buffer removeObjectForKey:key];
+                 }
+             }
+         }
+         if (view->_compressedSize > view->_maxCompressedSize) {
+             [view->_compressedBuffer removeAllObjects];
+             view->_compressedSize = 0;
+         }
+    )//LOCK
     view = nil;
     
     for (int i = 0; i < max; i++, idx++) {
@@ -94,8 +423,29 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
             if (!view) break;
             LOCK_VIEW(BOOL miss = (view->_buffer[@(idx)] == nil));
             if (miss) {
-                UIImage *img = [_curImage animatedImageFrameAtIndex:idx];
-                img = img.imageByDecoded;
+                UIImage *img = [pool frameForImage:_curImage atIndex:idx]; // decoded by other view
+                if (!img) {
+                    LOCK_VIEW(id compressed = view->_compressedBuffer[@(idx)]; BOOL compress = view->_maxCompressedSize > 0);
+                    if ([compressed isKindOfClass:[NSData class]]) {
+                        img = YYCompressedFrameCreateImage(compressed);
+                    }
+                    if (!img) {
+                        img = [_curImage animatedImageFrameAtIndex:idx];
+                        img = img.imageByDecoded;
+                        if (img && compress && !compressed) {
+                            NSData *data = YYCompressedFrameCreate(img);
+                            LOCK_VIEW(
+                                 if (data && view->_compressedSize + data.length <= view->_maxCompressedSize) {
+                                     view->_compressedBuffer[@(idx)] = data;
+                                     view->_compressedSize += data.length;
+                                 } else {
+                                     view->_compressedBuffer[@(idx)] = [NSNull null];
+                                 }
+                            )//LOCK
+                        }
+                    }
+                    [pool setFrame:img forImage:_curImage atIndex:idx];
+                }
                 if ([self isCancelled]) break;
                 LOCK_VIEW(view->_buffer[@(idx)] = img ? img : [NSNull null]);
                 view = nil;
@@ -146,6 +496,7 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
     if (!_link) {
         _lock = dispatch_semaphore_create(1);
         _buffer = [NSMutableDictionary new];
+        _compressedBuffer = [NSMutableDictionary new];
         _requestQueue = [[NSOperationQueue alloc] init];
         _requestQueue.maxConcurrentOperationCount = 1;
         _link = [CADisplayLink displayLinkWithTarget:[YYWeakProxy proxyWithTarget:self] selector:@selector(step:)];
@@ -169,8 +520,17 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
                  [holder class];
              });
          }
+         if (_compressedBuffer.count) {
+             NSMutableDictionary *holder = _compressedBuffer;
+             _compressedBuffer = [NSMutableDictionary new];
+             _compressedSize = 0;
+             dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+                 [holder class];
+             });
+         }
     );
     _link.paused = YES;
+    [self updateBufferPoolWeight];
     _time = 0;
     if (_curIndex != 0) {
         [self willChangeValueForKey:@"currentAnimatedImageIndex"];
@@ -289,22 +649,47 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
     [self didMoved];
 }
 
-// dynamically adjust buffer size for current memory.
+// dynamically adjust buffer size for current memory and the share of buffer pool.
 - (void)calcMaxBufferCount {
     int64_t bytes = (int64_t)_curAnimatedImage.animatedImageBytesPerFrame;
     if (bytes == 0) bytes = 1024;
     
-    int64_t total = [UIDevice currentDevice].memoryTotal;
-    int64_t free = [UIDevice currentDevice].memoryFree;
-    int64_t max = MIN(total * 0.2, free * 0.6);
-    max = MAX(max, BUFFER_SIZE);
+    _YYAnimatedImageBufferPool *pool = [_YYAnimatedImageBufferPool sharedPool];
+    _bufferGeneration = pool.generation;
+    int64_t max = [pool bufferSizeForView:self];
     if (_maxBufferSize) max = max > _maxBufferSize ? _maxBufferSize : max;
     double maxBufferCount = (double)max / (double)bytes;
+    if (maxBufferCount < _totalFrameCount) {
+        // can't buffer all frames, keep compressed frames with half of the budget
+        _maxCompressedSize = max / 2;
+        maxBufferCount /= 2;
+    } else {
+        _maxCompressedSize = 0;
+    }
     maxBufferCount = YY_CLAMP(maxBufferCount, 1, 512);
     _maxBufferCount = maxBufferCount;
 }
 
+// update the share of buffer pool for current playing state.
+- (void)updateBufferPoolWeight {
+    NSUInteger weight = 0;
+    if (_curAnimatedImage && _link && !_link.paused) {
+        BOOL visible = self.window && !self.hidden && self.alpha > 0.01;
+        weight = visible ? BUFFER_WEIGHT_VISIBLE : BUFFER_WEIGHT_INVISIBLE;
+    }
+    [[_YYAnimatedImageBufferPool sharedPool] setWeight:weight forView:self];
+}
+
++ (NSUInteger)sharedMaxBufferSize {
+    return [_YYAnimatedImageBufferPool sharedPool].maxBufferSize;
+}
+
++ (void)setSharedMaxBufferSize:(NSUInteger)sharedMaxBufferSize {
+    [_YYAnimatedImageBufferPool sharedPool].maxBufferSize = sharedMaxBufferSize;
+}
+
 - (void)dealloc {
+    [[_YYAnimatedImageBufferPool sharedPool] setWeight:0 forView:self];
     [_requestQueue cancelAllOperations];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidEnterBackgroundNotification object:nil];
@@ -319,6 +704,7 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
     [super stopAnimating];
     [_requestQueue cancelAllOperations];
     _link.paused = YES;
+    [self updateBufferPoolWeight];
     self.currentIsPlayingAnimation = NO;
 }
 
@@ -335,6 +721,7 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
             _curLoop = 0;
             _loopEnd = NO;
             _link.paused = NO;
+            [self updateBufferPoolWeight];
             self.currentIsPlayingAnimation = YES;
         }
     }
@@ -352,6 +739,8 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
                      [_buffer removeObjectForKey:key];
                  }
              }
+             [_compressedBuffer removeAllObjects];
+             _compressedSize = 0;
         )//LOCK
     }];
 }
@@ -366,6 +755,8 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
                  [_buffer removeObjectForKey:key];
              }
          }
+         [_compressedBuffer removeAllObjects];
+         _compressedSize = 0;
      )//LOCK
 }
 
@@ -472,6 +863,12 @@ typedef NS_ENUM(NSUInteger, YYAnimatedImageType) {
             [self stopAnimating];
         }
     }
+    [self updateBufferPoolWeight];
+}
+
+- (void)setHidden:(BOOL)hidden {
+    [super setHidden:hidden];
+    [self updateBufferPoolWeight];
 }
 
 - (void)didMoveToWindow {
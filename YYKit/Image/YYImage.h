@@ -46,6 +46,21 @@ NS_ASSUME_NONNULL_BEGIN
 + (nullable YYImage *)imageWithData:(NSData *)data;
 + (nullable YYImage *)imageWithData:(NSData *)data scale:(CGFloat)scale;
 
+/**
+ Creates an image with the data, which is decoded directly to a downsampled bitmap.
+ 
+ @discussion Use this method to display a large image in a small view (such as
+ avatar or thumbnail in a feed), the memory and the decode time will be proportional
+ to the display size. See `YYImageDecoder.maxPixelSize` for more information.
+ 
+ @param data         The image data.
+ @param scale        The image scale.
+ @param maxPixelSize The max pixel size (the longer side) of the image,
+    pass 0 to decode at full size.
+ */
++ (nullable YYImage *)imageWithData:(NSData *)data scale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize;
+- (nullable instancetype)initWithData:(NSData *)data scale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize;
+
 /**
  If the image is created from data or file, then the value indicates the data type.
  */
@@ -67,7 +82,9 @@ NS_ASSUME_NONNULL_BEGIN
  Preload all frame image to memory.
  
  @discussion Set this property to `YES` will block the calling thread to decode 
- all animation frame image to memory, set to `NO` will release the preloaded frames.
+ all animation frame image to memory (the frames are decoded concurrently, see
+ `-[YYImageDecoder framesInRange:decodeForDisplay:]`), set to `NO` will release 
+ the preloaded frames.
  If the image is shared by lots of image views (such as emoticon), preload all
  frames will reduce the CPU cost.
  
@@ -61,6 +61,10 @@
     return [[self alloc] initWithData:data scale:scale];
 }
 
++ (YYImage *)imageWithData:(NSData *)data scale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize {
+    return [[self alloc] initWithData:data scale:scale maxPixelSize:maxPixelSize];
+}
+
 - (instancetype)initWithContentsOfFile:(NSString *)path {
     NSData *data = [NSData dataWithContentsOfFile:path];
     return [self initWithData:data scale:path.pathScale];
@@ -71,11 +75,15 @@
 }
 
 - (instancetype)initWithData:(NSData *)data scale:(CGFloat)scale {
+    return [self initWithData:data scale:scale maxPixelSize:0];
+}
+
+- (instancetype)initWithData:(NSData *)data scale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize {
     if (data.length == 0) return nil;
     if (scale <= 0) scale = [UIScreen mainScreen].scale;
     _preloadedLock = dispatch_semaphore_create(1);
     @autoreleasepool {
-        YYImageDecoder *decoder = [YYImageDecoder decoderWithData:data scale:scale];
+        YYImageDecoder *decoder = [YYImageDecoder decoderWithData:data scale:scale maxPixelSize:maxPixelSize];
         YYImageFrame *frame = [decoder frameAtIndex:0 decodeForDisplay:YES];
         UIImage *image = frame.image;
         if (!image) return nil;
@@ -100,8 +108,9 @@
     if (_preloadAllAnimatedImageFrames != preloadAllAnimatedImageFrames) {
         if (preloadAllAnimatedImageFrames && _decoder.frameCount > 0) {
             NSMutableArray *frames = [NSMutableArray new];
-            for (NSUInteger i = 0, max = _decoder.frameCount; i < max; i++) {
-                UIImage *img = [self animatedImageFrameAtIndex:i];
+            NSArray *decodedFrames = [_decoder framesInRange:NSMakeRange(0, _decoder.frameCount) decodeForDisplay:YES];
+            for (id frame in decodedFrames) {
+                UIImage *img = [frame isKindOfClass:[YYImageFrame class]] ? ((YYImageFrame *)frame).image : nil;
                 if (img) {
                     [frames addObject:img];
                 } else {
@@ -123,9 +132,10 @@
 
 - (instancetype)initWithCoder:(NSCoder *)aDecoder {
     NSNumber *scale = [aDecoder decodeObjectForKey:@"YYImageScale"];
+    NSNumber *maxPixelSize = [aDecoder decodeObjectForKey:@"YYImageMaxPixelSize"];
     NSData *data = [aDecoder decodeObjectForKey:@"YYImageData"];
     if (data.length) {
-        self = [self initWithData:data scale:scale.doubleValue];
+        self = [self initWithData:data scale:scale.doubleValue maxPixelSize:maxPixelSize.doubleValue];
     } else {
         self = [super initWithCoder:aDecoder];
     }
@@ -135,6 +145,7 @@
 - (void)encodeWithCoder:(NSCoder *)aCoder {
     if (_decoder.data.length) {
         [aCoder encodeObject:@(self.scale) forKey:@"YYImageScale"];
+        if (_decoder.maxPixelSize > 0) [aCoder encodeObject:@(_decoder.maxPixelSize) forKey:@"YYImageMaxPixelSize"];
         [aCoder encodeObject:_decoder.data forKey:@"YYImageData"];
     } else {
         [super encodeWithCoder:aCoder]; // Apple use UIImagePNGRepresentation() to encode UIImage.
@@ -78,6 +78,45 @@ typedef NS_OPTIONS(NSUInteger, YYImageCacheType) {
  */
 @property BOOL decodeForDisplay;
 
+/**
+ The max pixel size (the longer side) of the image decoded from disk cache.
+ Default is 0, means no limit.
+ 
+ @discussion If the value is greater than 0, the image data read from disk cache
+ will be decoded directly to a downsampled bitmap (see `YYImageDecoder.maxPixelSize`),
+ which saves both memory and decode time when the images are displayed in small
+ views. The image data in disk cache is not changed. The memory cache does not 
+ distinguish the image size, so you should use a separate cache instance for each
+ display size (or remove the memory cache after changing this value).
+ */
+@property CGFloat maxPixelSize;
+
+/**
+ Whether to store the decoded bitmap of still images to `bitmapDiskCache`. Default is NO.
+ 
+ @discussion When an image is read from disk cache, the image data is decoded
+ every time. If the value is YES, the decoded bitmap (premultiplied BGRA, the
+ format which is ready for display) is also stored to `bitmapDiskCache`, and it's
+ mapped into memory directly the next time the image is read, without decoding.
+ 
+ It trades disk space for CPU time: a bitmap is usually several times larger than 
+ the compressed image data, so you may set the limits of `bitmapDiskCache` to 
+ keep only the hot images. Animated images and the images not decoded for 
+ display (see `decodeForDisplay`) are not stored. The bitmap is removed when the
+ image is replaced or removed with this cache, or when it's read and the original 
+ image has been evicted from `diskCache`, changed, or the `maxPixelSize` is changed.
+ */
+@property BOOL storesDecodedBitmap;
+
+/**
+ The disk cache of decoded bitmaps, see `storesDecodedBitmap`.
+ It's located in the "bitmap" sub directory of the cache path, and created
+ on first use. When it's created, its count limit is same as `diskCache`, the
+ cost limit is at most 256MB and the age limit is at most 7 days (the smaller 
+ ones of the `diskCache`'s limits are used), you may change them later.
+ */
+@property (strong, readonly) YYDiskCache *bitmapDiskCache;
+
 
 #pragma mark - Initializer
 ///=============================================================================
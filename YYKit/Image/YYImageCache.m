@@ -38,13 +38,46 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
 }
 
 
+#define YYImageBitmapMagic 0x4D425959 // "YYBM"
+#define YYImageBitmapVersion 2
+#define YYImageBitmapDefaultCostLimit (256 * 1024 * 1024)
+#define YYImageBitmapDefaultAgeLimit (7 * 24 * 60 * 60)
+
+/// The header of a decoded bitmap in `bitmapDiskCache`, followed by the pixels.
+typedef struct {
+    uint32_t magic;        ///< YYImageBitmapMagic
+    uint32_t version;      ///< YYImageBitmapVersion
+    uint32_t width;        ///< bitmap width in pixels
+    uint32_t height;       ///< bitmap height in pixels
+    uint32_t bytesPerRow;  ///< bytes per row of the pixels
+    uint32_t bitmapInfo;   ///< CGBitmapInfo, 8 bits per component, 32 bits per pixel
+    uint32_t orientation;  ///< UIImageOrientation
+    uint32_t flags;        ///< YYImageBitmapFlag
+    float scale;           ///< image scale
+    float maxPixelSize;    ///< the `maxPixelSize` of the cache when it's decoded
+    uint32_t originalSize; ///< the size of the original image data in `diskCache`
+    uint32_t originalTime; ///< the modification time of the original image data
+    uint32_t reserved[4];  ///< pads the header to 64 bytes, so the pixels are aligned
+} YYImageBitmapHeader;
+
+/// The bitmap is the first frame of an animated image (`allowAnimatedImage` is NO).
+#define YYImageBitmapFlagFirstFrame (1 << 0)
+
+static void YYImageBitmapReleaseData(void *info, const void *data, size_t size) {
+    if (info) CFRelease(info);
+}
+
+
 @interface YYImageCache ()
 - (NSUInteger)imageCost:(UIImage *)image;
 - (UIImage *)imageFromData:(NSData *)data;
 @end
 
 
-@implementation YYImageCache
+@implementation YYImageCache {
+    dispatch_semaphore_t _bitmapLock;
+    YYDiskCache *_bitmapDiskCache;
+}
 
 - (NSUInteger)imageCost:(UIImage *)image {
     CGImageRef cgImage = image.CGImage;
@@ -65,15 +98,151 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
     if (scale <= 0) scale = [UIScreen mainScreen].scale;
     UIImage *image;
     if (_allowAnimatedImage) {
-        image = [[YYImage alloc] initWithData:data scale:scale];
+        image = [[YYImage alloc] initWithData:data scale:scale maxPixelSize:self.maxPixelSize];
         if (_decodeForDisplay) image = [image imageByDecoded];
     } else {
-        YYImageDecoder *decoder = [YYImageDecoder decoderWithData:data scale:scale];
+        YYImageDecoder *decoder = [YYImageDecoder decoderWithData:data scale:scale maxPixelSize:self.maxPixelSize];
         image = [decoder frameAtIndex:0 decodeForDisplay:_decodeForDisplay].image;
     }
     return image;
 }
 
+- (YYDiskCache *)_newBitmapDiskCache {
+    NSString *path = [_diskCache.path stringByAppendingPathComponent:@"bitmap"];
+    YYDiskCache *cache = [[YYDiskCache alloc] initWithPath:path inlineThreshold:0]; // always file
+    cache.mappedReadThreshold = 0; // always mapped
+    // the bitmaps are much larger than the image data, and they may outlive the
+    // evicted original images until read, so they have stricter limits
+    cache.countLimit = _diskCache.countLimit;
+    cache.costLimit = MIN(_diskCache.costLimit, YYImageBitmapDefaultCostLimit);
+    cache.ageLimit = MIN(_diskCache.ageLimit, YYImageBitmapDefaultAgeLimit);
+    cache.customArchiveBlock = ^(id object) { return (NSData *)object; };
+    cache.customUnarchiveBlock = ^(NSData *data) { return (id)data; };
+    return cache;
+}
+
+/// Returns the bitmap disk cache, or nil if it's never created and `create` is NO.
+- (YYDiskCache *)_bitmapDiskCacheCreateIfNeeded:(BOOL)create {
+    dispatch_semaphore_wait(_bitmapLock, DISPATCH_TIME_FOREVER);
+    if (!_bitmapDiskCache && create) _bitmapDiskCache = [self _newBitmapDiskCache];
+    YYDiskCache *cache = _bitmapDiskCache;
+    dispatch_semaphore_signal(_bitmapLock);
+    return cache;
+}
+
+/// Whether the bitmap can be used, the invalid bitmaps are removed by caller.
+- (BOOL)_isValidBitmapData:(NSData *)data forKey:(NSString *)key {
+    if (data.length < sizeof(YYImageBitmapHeader)) return NO;
+    YYImageBitmapHeader header;
+    memcpy(&header, data.bytes, sizeof(header));
+    if (header.magic != YYImageBitmapMagic || header.version != YYImageBitmapVersion) return NO;
+    if (header.maxPixelSize != (float)self.maxPixelSize) return NO;
+    if (header.width == 0 || header.height == 0 || header.bytesPerRow < header.width * 4) return NO;
+    size_t length = (size_t)header.bytesPerRow * header.height;
+    if (length > data.length - sizeof(header)) return NO;
+    
+    // the original image should not be removed or replaced after it's decoded
+    int64_t size = 0, time = 0;
+    if (![_diskCache getInfoForKey:key size:&size modificationTime:&time]) return NO;
+    return header.originalSize == (uint32_t)size && header.originalTime == (uint32_t)time;
+}
+
+- (UIImage *)_imageFromBitmapForKey:(NSString *)key {
+    YYDiskCache *cache = [self _bitmapDiskCacheCreateIfNeeded:NO];
+    if (!cache) return nil;
+    NSData *data = (id)[cache objectForKey:key];
+    if (!data) return nil;
+    if (![self _isValidBitmapData:data forKey:key]) {
+        [cache removeObjectForKey:key];
+        return nil;
+    }
+    
+    YYImageBitmapHeader header;
+    memcpy(&header, data.bytes, sizeof(header));
+    if ((header.flags & YYImageBitmapFlagFirstFrame) && _allowAnimatedImage) return nil;
+    size_t length = (size_t)header.bytesPerRow * header.height;
+    
+    // the provider retains the (mapped) data, so the pixels are not copied
+    const uint8_t *pixels = (const uint8_t *)data.bytes + sizeof(header);
+    CGDataProviderRef provider = CGDataProviderCreateWithData((__bridge_retained void *)data, pixels, length, YYImageBitmapReleaseData);
+    if (!provider) return nil;
+    CGImageRef imageRef = CGImageCreate(header.width, header.height, 8, 32, header.bytesPerRow, YYCGColorSpaceGetDeviceRGB(), header.bitmapInfo, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    if (!imageRef) return nil;
+    CGFloat scale = header.scale > 0 ? header.scale : [UIScreen mainScreen].scale;
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:(UIImageOrientation)header.orientation];
+    CGImageRelease(imageRef);
+    image.isDecodedForDisplay = YES;
+    return image;
+}
+
+- (void)_storeBitmapOfImage:(UIImage *)image forKey:(NSString *)key originalSize:(int64_t)originalSize originalTime:(int64_t)originalTime {
+    if (!image.isDecodedForDisplay) return;
+    uint32_t flags = 0;
+    if ([image isKindOfClass:[YYImage class]]) {
+        if (((YYImage *)image).animatedImageFrameCount > 1) return;
+    } else if (!_allowAnimatedImage) {
+        flags |= YYImageBitmapFlagFirstFrame; // may be the first frame of an animated image
+    }
+    
+    CGImageRef imageRef = image.CGImage;
+    if (!imageRef) return;
+    CGBitmapInfo bitmapInfo = CGImageGetBitmapInfo(imageRef);
+    CGImageAlphaInfo alphaInfo = bitmapInfo & kCGBitmapAlphaInfoMask;
+    if (CGImageGetBitsPerComponent(imageRef) != 8 || CGImageGetBitsPerPixel(imageRef) != 32) return;
+    if ((bitmapInfo & kCGBitmapByteOrderMask) != kCGBitmapByteOrder32Host) return;
+    if (alphaInfo != kCGImageAlphaPremultipliedFirst && alphaInfo != kCGImageAlphaNoneSkipFirst) return;
+    
+    YYImageBitmapHeader header = {0};
+    header.magic = YYImageBitmapMagic;
+    header.version = YYImageBitmapVersion;
+    header.width = (uint32_t)CGImageGetWidth(imageRef);
+    header.height = (uint32_t)CGImageGetHeight(imageRef);
+    header.bytesPerRow = (uint32_t)CGImageGetBytesPerRow(imageRef);
+    header.bitmapInfo = bitmapInfo;
+    header.orientation = (uint32_t)image.imageOrientation;
+    header.flags = flags;
+    header.scale = image.scale;
+    header.maxPixelSize = self.maxPixelSize;
+    header.originalSize = (uint32_t)originalSize;
+    header.originalTime = (uint32_t)originalTime;
+    
+    __weak typeof(self) _self = self;
+    dispatch_async(YYImageCacheIOQueue(), ^{
+        __strong typeof(_self) self = _self;
+        if (!self) return;
+        CFDataRef pixels = CGDataProviderCopyData(CGImageGetDataProvider(image.CGImage));
+        if (!pixels) return;
+        size_t length = (size_t)header.bytesPerRow * header.height;
+        if ((size_t)CFDataGetLength(pixels) >= length) {
+            NSMutableData *data = [NSMutableData dataWithLength:sizeof(header) + length];
+            memcpy(data.mutableBytes, &header, sizeof(header));
+            memcpy((uint8_t *)data.mutableBytes + sizeof(header), CFDataGetBytePtr(pixels), length);
+            [[self _bitmapDiskCacheCreateIfNeeded:YES] setObject:data forKey:key];
+        }
+        CFRelease(pixels);
+    });
+}
+
+- (UIImage *)_imageFromDiskForKey:(NSString *)key {
+    UIImage *image = [self _imageFromBitmapForKey:key];
+    if (image) return image;
+    BOOL storesBitmap = _storesDecodedBitmap;
+    int64_t size = 0, time = 0;
+    if (storesBitmap) storesBitmap = [_diskCache getInfoForKey:key size:&size modificationTime:&time];
+    NSData *data = (id)[_diskCache objectForKey:key];
+    image = [self imageFromData:data];
+    // the size check skips the data replaced after the info is read
+    if (image && storesBitmap && data.length == size) {
+        [self _storeBitmapOfImage:image forKey:key originalSize:size originalTime:time];
+    }
+    return image;
+}
+
+- (void)_removeBitmapForKey:(NSString *)key {
+    [[self _bitmapDiskCacheCreateIfNeeded:NO] removeObjectForKey:key];
+}
+
 #pragma mark Public
 
 + (instancetype)sharedCache {
@@ -112,9 +281,20 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
     _diskCache = diskCache;
     _allowAnimatedImage = YES;
     _decodeForDisplay = YES;
+    _bitmapLock = dispatch_semaphore_create(1);
+    
+    // open the existing bitmap cache, so the stale bitmaps can be removed
+    NSString *bitmapPath = [path stringByAppendingPathComponent:@"bitmap"];
+    if ([[NSFileManager defaultManager] fileExistsAtPath:bitmapPath]) {
+        _bitmapDiskCache = [self _newBitmapDiskCache];
+    }
     return self;
 }
 
+- (YYDiskCache *)bitmapDiskCache {
+    return [self _bitmapDiskCacheCreateIfNeeded:YES];
+}
+
 - (void)setImage:(UIImage *)image forKey:(NSString *)key {
     [self setImage:image imageData:nil forKey:key withType:YYImageCacheTypeAll];
 }
@@ -144,6 +324,7 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
         }
     }
     if (type & YYImageCacheTypeDisk) { // add to disk cache
+        [self _removeBitmapForKey:key];
         if (imageData) {
             if (image) {
                 [YYDiskCache setExtendedData:[NSKeyedArchiver archivedDataWithRootObject:@(image.scale)] toObject:imageData];
@@ -167,7 +348,10 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
 
 - (void)removeImageForKey:(NSString *)key withType:(YYImageCacheType)type {
     if (type & YYImageCacheTypeMemory) [_memoryCache removeObjectForKey:key];
-    if (type & YYImageCacheTypeDisk) [_diskCache removeObjectForKey:key];
+    if (type & YYImageCacheTypeDisk) {
+        [_diskCache removeObjectForKey:key];
+        [self _removeBitmapForKey:key];
+    }
 }
 
 - (BOOL)containsImageForKey:(NSString *)key {
@@ -195,8 +379,7 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
         if (image) return image;
     }
     if (type & YYImageCacheTypeDisk) {
-        NSData *data = (id)[_diskCache objectForKey:key];
-        UIImage *image = [self imageFromData:data];
+        UIImage *image = [self _imageFromDiskForKey:key];
         if (image && (type & YYImageCacheTypeMemory)) {
             [_memoryCache setObject:image forKey:key withCost:[self imageCost:image]];
         }
@@ -221,8 +404,7 @@ static inline dispatch_queue_t YYImageCacheDecodeQueue() {
         }
         
         if (type & YYImageCacheTypeDisk) {
-            NSData *data = (id)[_diskCache objectForKey:key];
-            image = [self imageFromData:data];
+            image = [self _imageFromDiskForKey:key];
             if (image) {
                 [_memoryCache setObject:image forKey:key];
                 dispatch_async(dispatch_get_main_queue(), ^{
@@ -101,6 +101,10 @@ typedef NS_ENUM(NSUInteger, YYImageBlendOperation) {
  to decode complete image data, or to decode incremental image data during image 
  download. This class is thread-safe.
  
+ APNG and GIF are decoded with the built-in decoders (the system ImageIO is only
+ used as a fallback for broken GIF files), which index the frames once and decode 
+ each frame on demand, so the frames can be accessed randomly.
+ 
  Example:
  
     // Decode single image:
@@ -135,13 +139,36 @@ typedef NS_ENUM(NSUInteger, YYImageBlendOperation) {
 @property (nonatomic, readonly) NSUInteger height;         ///< Image canvas height.
 @property (nonatomic, readonly, getter=isFinalized) BOOL finalized;
 
+/**
+ The max pixel size (the longer side) of the decoded frame image, 0 means no limit.
+ 
+ @discussion If the image canvas is larger than this value, the frames will be
+ decoded directly to a downsampled bitmap with the codec's scaled decoding
+ (ImageIO thumbnail, WebP scaling, per-frame scaling for APNG), so both the memory
+ and the decode time are proportional to the display size rather than the image
+ size. The `width` and `height` are still the original canvas size, while the
+ frames returned by `frameAtIndex:decodeForDisplay:` are in downsampled pixels.
+ */
+@property (nonatomic, readonly) CGFloat maxPixelSize;
+
 /**
  Creates an image decoder.
  
  @param scale  Image's scale.
  @return An image decoder.
  */
-- (instancetype)initWithScale:(CGFloat)scale NS_DESIGNATED_INITIALIZER;
+- (instancetype)initWithScale:(CGFloat)scale;
+
+/**
+ Creates an image decoder which downsamples the frames to a max pixel size.
+ 
+ @param scale        Image's scale.
+ @param maxPixelSize The max pixel size (the longer side) of the decoded frame,
+    pass 0 to decode at full size. For example, pass `60 * [UIScreen mainScreen].scale`
+    for a 60x60 point avatar view.
+ @return An image decoder.
+ */
+- (instancetype)initWithScale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize NS_DESIGNATED_INITIALIZER;
 
 /**
  Updates the incremental image with new data.
@@ -170,6 +197,17 @@ typedef NS_ENUM(NSUInteger, YYImageBlendOperation) {
  */
 + (nullable instancetype)decoderWithData:(NSData *)data scale:(CGFloat)scale;
 
+/**
+ Convenience method to create a decoder with specified data, which downsamples
+ the frames to a max pixel size.
+ @param data         Image data.
+ @param scale        Image's scale.
+ @param maxPixelSize The max pixel size (the longer side) of the decoded frame,
+    pass 0 to decode at full size.
+ @return A new decoder, or nil if an error occurs.
+ */
++ (nullable instancetype)decoderWithData:(NSData *)data scale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize;
+
 /**
  Decodes and returns a frame from a specified index.
  @param index  Frame image index (zero-based).
@@ -179,6 +217,26 @@ typedef NS_ENUM(NSUInteger, YYImageBlendOperation) {
  */
 - (nullable YYImageFrame *)frameAtIndex:(NSUInteger)index decodeForDisplay:(BOOL)decodeForDisplay;
 
+/**
+ Decodes and returns the frames in a specified range, using multiple threads.
+ 
+ @discussion The frames which don't need blend are decoded concurrently. For the
+ images which need blend (APNG/WebP with dispose and blend operations), the frame
+ images are decoded concurrently, and then the frames are split into segments 
+ at the key frames (which don't depend on any previous frame, see `blendFromIndex`), 
+ each segment is blended on its own canvas concurrently.
+ 
+ This method blocks the calling thread until all the frames are decoded, and it
+ costs more memory than decoding frames one by one. If the data is not finalized,
+ the frames are decoded sequentially.
+ 
+ @param range The frame index range, it will be clipped to `frameCount`.
+ @param decodeForDisplay Whether decode the image to memory bitmap for display.
+ @return An array of `YYImageFrame`, with `NSNull` for the frames which failed to
+    decode, or nil if the range is empty.
+ */
+- (nullable NSArray *)framesInRange:(NSRange)range decodeForDisplay:(BOOL)decodeForDisplay;
+
 /**
  Returns the frame duration from a specified index.
  @param index  Frame image (zero-based).
@@ -238,6 +296,25 @@ typedef NS_ENUM(NSUInteger, YYImageBlendOperation) {
 @property (nonatomic) BOOL lossless;              ///< Lossless, only available for WebP.
 @property (nonatomic) CGFloat quality;            ///< Compress quality, 0.0~1.0, only available for JPG/JP2/WebP.
 
+/**
+ Whether to crop each frame of animation to the area changed from the previous frame,
+ only available for APNG/WebP. Default is YES.
+ 
+ @discussion The encoder chooses the dispose method and blend operation of each frame
+ to minimize the changed area, which reduces the file size and decoding cost of most
+ animations. Set it to NO to encode the full canvas of each frame.
+ */
+@property (nonatomic) BOOL optimizesFrames;
+
+/**
+ The block invoked when a frame of animation is encoded, only available for APNG/WebP.
+ 
+ @discussion The frames are encoded concurrently, this block is invoked serially on 
+ background threads during `encode` or `encodeToFile:`. Set `*stop` to YES to cancel
+ the encoding, then the encoder returns nil (or NO).
+ */
+@property (nullable, nonatomic, copy) void (^progressBlock)(NSUInteger encodedCount, NSUInteger totalCount, BOOL *stop);
+
 - (instancetype)init UNAVAILABLE_ATTRIBUTE;
 + (instancetype)new UNAVAILABLE_ATTRIBUTE;
 
@@ -269,6 +346,29 @@ typedef NS_ENUM(NSUInteger, YYImageBlendOperation) {
  */
 - (void)addImageWithFile:(NSString *)path duration:(NSTimeInterval)duration;
 
+/**
+ Begins streaming mode, only available for APNG/WebP.
+ 
+ @discussion In streaming mode, each image added with `addImage:duration:`, 
+ `addImageWithData:duration:` or `addImageWithFile:duration:` is encoded and written
+ to the file immediately, instead of being held by the encoder until `encode`. 
+ The memory cost is about the cost of one frame, so it's suitable for long animations.
+ 
+ The canvas size is the first image's size, and the images are drawn at the top-left
+ of the canvas. Call `finishStream` after all the images are added.
+ 
+ @param path The file path (overwrite if exist).
+ @return Whether succeed. Returns NO if the type is not APNG/WebP, or an image has 
+    been added before.
+ */
+- (BOOL)beginStreamToFile:(NSString *)path;
+
+/**
+ Finishes streaming mode, writes the rest data to the file and closes it.
+ @return Whether succeed. The file is removed if an error occurs.
+ */
+- (BOOL)finishStream;
+
 /**
  Encodes the image and returns the image data.
  @return The image data, or nil if an error occurs.
@@ -476,6 +576,28 @@ CG_EXTERN CGImageRef _Nullable YYCGImageCreateWithWebPData(CFDataRef webpData,
                                                            BOOL bypassFiltering,
                                                            BOOL noFancyUpsampling);
 
+/**
+ Decode a downsampled image from WebP data, returns NULL if an error occurs.
+ 
+ @discussion It uses the WebP decoder's built-in scaling, so the full size bitmap
+ is never allocated.
+ 
+ @param webpData          The WebP data.
+ @param maxPixelSize      The max pixel size (the longer side) of the result image,
+                            0 means full size.
+ @param decodeForDisplay  See `YYCGImageCreateWithWebPData()`.
+ @param useThreads        See `YYCGImageCreateWithWebPData()`.
+ @param bypassFiltering   See `YYCGImageCreateWithWebPData()`.
+ @param noFancyUpsampling See `YYCGImageCreateWithWebPData()`.
+ @return The decoded image, or NULL if an error occurs.
+ */
+CG_EXTERN CGImageRef _Nullable YYCGImageCreateThumbnailWithWebPData(CFDataRef webpData,
+                                                                    CGFloat maxPixelSize,
+                                                                    BOOL decodeForDisplay,
+                                                                    BOOL useThreads,
+                                                                    BOOL bypassFiltering,
+                                                                    BOOL noFancyUpsampling);
+
 typedef NS_ENUM(NSUInteger, YYImagePreset) {
     YYImagePresetDefault = 0,  ///< default preset.
     YYImagePresetPicture,      ///< digital picture, like portrait, inner shot
@@ -20,6 +20,7 @@
 #import <pthread.h>
 #import <zlib.h>
 #import "YYImage.h"
+#import "YYImageGIF.h"
 #import "YYKitMacro.h"
 
 #ifndef YYIMAGE_WEBP_ENABLED
@@ -635,6 +636,19 @@ static inline size_t YYImageByteAlign(size_t size, size_t alignment) {
     return ((size + (alignment - 1)) / alignment) * alignment;
 }
 
+/// Returns the ratio (0, 1] to downsample the size to fit the max pixel size.
+static inline CGFloat YYImageDownsampleRatio(size_t width, size_t height, CGFloat maxPixelSize) {
+    size_t maxSide = MAX(width, height);
+    if (maxPixelSize <= 0 || maxSide == 0 || maxSide <= maxPixelSize) return 1;
+    return maxPixelSize / maxSide;
+}
+
+/// Returns the downsampled length, at least 1 pixel.
+static inline size_t YYImageDownsampleLength(size_t length, CGFloat ratio) {
+    if (ratio >= 1 || length == 0) return length;
+    return MAX((size_t)1, (size_t)round(length * ratio));
+}
+
 /// Convert degree to radians
 static inline CGFloat YYImageDegreesToRadians(CGFloat degrees) {
     return degrees * M_PI / 180;
@@ -1315,6 +1329,15 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
                                        BOOL useThreads,
                                        BOOL bypassFiltering,
                                        BOOL noFancyUpsampling) {
+    return YYCGImageCreateThumbnailWithWebPData(webpData, 0, decodeForDisplay, useThreads, bypassFiltering, noFancyUpsampling);
+}
+
+CGImageRef YYCGImageCreateThumbnailWithWebPData(CFDataRef webpData,
+                                                CGFloat maxPixelSize,
+                                                BOOL decodeForDisplay,
+                                                BOOL useThreads,
+                                                BOOL bypassFiltering,
+                                                BOOL noFancyUpsampling) {
     /*
      Call WebPDecode() on a multi-frame webp data will get an error (VP8_STATUS_UNSUPPORTED_FEATURE).
      Use WebPDemuxer to unpack it first.
@@ -1323,6 +1346,8 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     WebPDemuxer *demuxer = NULL;
     
     int frameCount = 0, canvasWidth = 0, canvasHeight = 0;
+    int offsetX = 0, offsetY = 0;
+    CGFloat ratio = 1;
     WebPIterator iter = {0};
     BOOL iterInited = NO;
     const uint8_t *payload = NULL;
@@ -1372,6 +1397,19 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     }
     if (payload == NULL || payloadSize == 0) goto fail;
     
+    ratio = YYImageDownsampleRatio(canvasWidth, canvasHeight, maxPixelSize);
+    if (ratio < 1) {
+        config.options.use_scaling = 1;
+        config.options.scaled_width = (int)YYImageDownsampleLength(config.input.width, ratio);
+        config.options.scaled_height = (int)YYImageDownsampleLength(config.input.height, ratio);
+        canvasWidth = (int)YYImageDownsampleLength(canvasWidth, ratio);
+        canvasHeight = (int)YYImageDownsampleLength(canvasHeight, ratio);
+        if (config.options.scaled_width > canvasWidth) config.options.scaled_width = canvasWidth;
+        if (config.options.scaled_height > canvasHeight) config.options.scaled_height = canvasHeight;
+    }
+    offsetX = (int)round(iter.x_offset * ratio);
+    offsetY = (int)round(iter.y_offset * ratio);
+    
     hasAlpha = config.input.has_alpha;
     bitsPerComponent = 8;
     bitsPerPixel = 32;
@@ -1401,12 +1439,12 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     VP8StatusCode result = WebPDecode(payload, payloadSize, &config);
     if ((result != VP8_STATUS_OK) && (result != VP8_STATUS_NOT_ENOUGH_DATA)) goto fail;
     
-    if (iter.x_offset != 0 || iter.y_offset != 0) {
+    if (offsetX != 0 || offsetY != 0) {
         void *tmp = calloc(1, destLength);
         if (tmp) {
             vImage_Buffer src = {destBytes, canvasHeight, canvasWidth, bytesPerRow};
             vImage_Buffer dest = {tmp, canvasHeight, canvasWidth, bytesPerRow};
-            vImage_CGAffineTransform transform = {1, 0, 0, 1, iter.x_offset, -iter.y_offset};
+            vImage_CGAffineTransform transform = {1, 0, 0, 1, offsetX, -offsetY};
             uint8_t backColor[4] = {0};
             vImageAffineWarpCG_ARGB8888(&src, &dest, NULL, &transform, backColor, kvImageBackgroundColorFill);
             memcpy(destBytes, tmp, destLength);
@@ -1459,6 +1497,16 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     return NULL;
 }
 
+CGImageRef YYCGImageCreateThumbnailWithWebPData(CFDataRef webpData,
+                                                CGFloat maxPixelSize,
+                                                BOOL decodeForDisplay,
+                                                BOOL useThreads,
+                                                BOOL bypassFiltering,
+                                                BOOL noFancyUpsampling) {
+    NSLog(@"WebP decoder is disabled");
+    return NULL;
+}
+
 #endif
 
 
@@ -1510,8 +1558,11 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     BOOL _sourceTypeDetected;
     CGImageSourceRef _source;
     yy_png_info *_apngSource;
+    yy_gif_info *_gifSource;
 #if YYIMAGE_WEBP_ENABLED
     WebPDemuxer *_webpSource;
+    WebPIDecoder *_webpIncrementalSource; ///< for single-frame webp before finalized
+    NSUInteger _webpIncrementalLength;    ///< data length appended to incremental decoder
 #endif
     
     UIImageOrientation _orientation;
@@ -1520,21 +1571,31 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     BOOL _needBlend;
     NSUInteger _blendFrameIndex;
     CGContextRef _blendCanvas;
+    
+    CGFloat _downsampleRatio; ///< (0, 1], 1 means full size
+    size_t _canvasWidth;      ///< downsampled canvas width
+    size_t _canvasHeight;     ///< downsampled canvas height
 }
 
 - (void)dealloc {
     if (_source) CFRelease(_source);
     if (_apngSource) yy_png_info_release(_apngSource);
+    if (_gifSource) yy_gif_info_release(_gifSource);
 #if YYIMAGE_WEBP_ENABLED
     if (_webpSource) WebPDemuxDelete(_webpSource);
+    if (_webpIncrementalSource) WebPIDelete(_webpIncrementalSource);
 #endif
     if (_blendCanvas) CFRelease(_blendCanvas);
     pthread_mutex_destroy(&_lock);
 }
 
 + (instancetype)decoderWithData:(NSData *)data scale:(CGFloat)scale {
+    return [self decoderWithData:data scale:scale maxPixelSize:0];
+}
+
++ (instancetype)decoderWithData:(NSData *)data scale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize {
     if (!data) return nil;
-    YYImageDecoder *decoder = [[YYImageDecoder alloc] initWithScale:scale];
+    YYImageDecoder *decoder = [[YYImageDecoder alloc] initWithScale:scale maxPixelSize:maxPixelSize];
     [decoder updateData:data final:YES];
     if (decoder.frameCount == 0) return nil;
     return decoder;
@@ -1545,9 +1606,16 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 }
 
 - (instancetype)initWithScale:(CGFloat)scale {
+    return [self initWithScale:scale maxPixelSize:0];
+}
+
+- (instancetype)initWithScale:(CGFloat)scale maxPixelSize:(CGFloat)maxPixelSize {
     self = [super init];
     if (scale <= 0) scale = 1;
+    if (maxPixelSize < 0) maxPixelSize = 0;
     _scale = scale;
+    _maxPixelSize = maxPixelSize;
+    _downsampleRatio = 1;
     _framesLock = dispatch_semaphore_create(1);
     pthread_mutex_init_recursive(&_lock, true);
     return self;
@@ -1569,6 +1637,14 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     return result;
 }
 
+- (NSArray *)framesInRange:(NSRange)range decodeForDisplay:(BOOL)decodeForDisplay {
+    NSArray *result = nil;
+    pthread_mutex_lock(&_lock);
+    result = [self _framesInRange:range decodeForDisplay:decodeForDisplay];
+    pthread_mutex_unlock(&_lock);
+    return result;
+}
+
 - (NSTimeInterval)frameDurationAtIndex:(NSUInteger)index {
     NSTimeInterval result = 0;
     dispatch_semaphore_wait(_framesLock, DISPATCH_TIME_FOREVER);
@@ -1622,38 +1698,15 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 
 - (YYImageFrame *)_frameAtIndex:(NSUInteger)index decodeForDisplay:(BOOL)decodeForDisplay {
     if (index >= _frames.count) return 0;
-    _YYImageDecoderFrame *frame = [(_YYImageDecoderFrame *)_frames[index] copy];
-    BOOL decoded = NO;
-    BOOL extendToCanvas = NO;
-    if (_type != YYImageTypeICO && decodeForDisplay) { // ICO contains multi-size frame and should not extend to canvas.
-        extendToCanvas = YES;
-    }
-    
-    if (!_needBlend) {
-        CGImageRef imageRef = [self _newUnblendedImageAtIndex:index extendToCanvas:extendToCanvas decoded:&decoded];
-        if (!imageRef) return nil;
-        if (decodeForDisplay && !decoded) {
-            CGImageRef imageRefDecoded = YYCGImageCreateDecodedCopy(imageRef, YES);
-            if (imageRefDecoded) {
-                CFRelease(imageRef);
-                imageRef = imageRefDecoded;
-                decoded = YES;
-            }
-        }
-        UIImage *image = [UIImage imageWithCGImage:imageRef scale:_scale orientation:_orientation];
-        CFRelease(imageRef);
-        if (!image) return nil;
-        image.isDecodedForDisplay = decoded;
-        frame.image = image;
-        return frame;
-    }
+    if (!_needBlend) return [self _unblendedFrameAtIndex:index decodeForDisplay:decodeForDisplay];
+    _YYImageDecoderFrame *frame = _frames[index];
     
     // blend
     if (![self _createBlendContextIfNeeded]) return nil;
     CGImageRef imageRef = NULL;
     
     if (_blendFrameIndex + 1 == frame.index) {
-        imageRef = [self _newBlendedImageWithFrame:frame];
+        imageRef = [self _newBlendedImageWithFrame:frame canvas:_blendCanvas preloaded:NULL];
         _blendFrameIndex = index;
     } else { // should draw canvas from previous frame
         _blendFrameIndex = NSNotFound;
@@ -1673,33 +1726,180 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
         } else { // canvas is not ready
             for (uint32_t i = (uint32_t)frame.blendFromIndex; i <= (uint32_t)frame.index; i++) {
                 if (i == frame.index) {
-                    if (!imageRef) imageRef = [self _newBlendedImageWithFrame:frame];
+                    if (!imageRef) imageRef = [self _newBlendedImageWithFrame:frame canvas:_blendCanvas preloaded:NULL];
                 } else {
-                    [self _blendImageWithFrame:_frames[i]];
+                    [self _blendImageWithFrame:_frames[i] canvas:_blendCanvas preloaded:NULL];
                 }
             }
             _blendFrameIndex = index;
         }
     }
     
+    YYImageFrame *result = [self _blendedFrameWithFrame:frame image:imageRef decodeForDisplay:decodeForDisplay];
+    if (imageRef) CFRelease(imageRef);
+    return result;
+}
+
+/// Decodes a frame of the image which does not need blend. It can be called concurrently.
+- (YYImageFrame *)_unblendedFrameAtIndex:(NSUInteger)index decodeForDisplay:(BOOL)decodeForDisplay {
+    _YYImageDecoderFrame *frame = [(_YYImageDecoderFrame *)_frames[index] copy];
+    BOOL decoded = NO;
+    BOOL extendToCanvas = NO;
+    if (_type != YYImageTypeICO && decodeForDisplay) { // ICO contains multi-size frame and should not extend to canvas.
+        extendToCanvas = YES;
+    }
+    
+    CGImageRef imageRef = [self _newUnblendedImageAtIndex:index extendToCanvas:extendToCanvas decoded:&decoded];
     if (!imageRef) return nil;
+    if (decodeForDisplay && !decoded) {
+        CGImageRef imageRefDecoded = YYCGImageCreateDecodedCopy(imageRef, YES);
+        if (imageRefDecoded) {
+            CFRelease(imageRef);
+            imageRef = imageRefDecoded;
+            decoded = YES;
+        }
+    }
     UIImage *image = [UIImage imageWithCGImage:imageRef scale:_scale orientation:_orientation];
     CFRelease(imageRef);
     if (!image) return nil;
+    image.isDecodedForDisplay = decoded;
+    frame.image = image;
+    [self _downsampleFrame:frame];
+    return frame;
+}
+
+/// Creates the result frame with a blended canvas image.
+- (YYImageFrame *)_blendedFrameWithFrame:(_YYImageDecoderFrame *)decoderFrame image:(CGImageRef)imageRef decodeForDisplay:(BOOL)decodeForDisplay {
+    if (!imageRef) return nil;
+    UIImage *image = [UIImage imageWithCGImage:imageRef scale:_scale orientation:_orientation];
+    if (!image) return nil;
     
+    _YYImageDecoderFrame *frame = [decoderFrame copy];
     image.isDecodedForDisplay = YES;
     frame.image = image;
-    if (extendToCanvas) {
-        frame.width = _width;
-        frame.height = _height;
+    if (_type != YYImageTypeICO && decodeForDisplay) { // extend to canvas
+        frame.width = _canvasWidth;
+        frame.height = _canvasHeight;
         frame.offsetX = 0;
         frame.offsetY = 0;
         frame.dispose = YYImageDisposeNone;
         frame.blend = YYImageBlendNone;
+    } else {
+        [self _downsampleFrame:frame];
     }
     return frame;
 }
 
+- (NSArray *)_framesInRange:(NSRange)range decodeForDisplay:(BOOL)decodeForDisplay {
+    NSUInteger frameCount = _frames.count;
+    if (range.location >= frameCount) return nil;
+    if (range.length > frameCount - range.location) range.length = frameCount - range.location;
+    if (range.length == 0) return nil;
+    
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity:range.length];
+    
+    if (!_finalized || range.length == 1) { // incremental source can only decode the first frame
+        for (NSUInteger i = location; i < end; i++) {
+            @autoreleasepool {
+                YYImageFrame *frame = [self _frameAtIndex:i decodeForDisplay:decodeForDisplay];
+                [result addObject:frame ? frame : [NSNull null]];
+            }
+        }
+        return result;
+    }
+    
+    // The sources (ImageIO, APNG chunks, WebP demuxer) are read-only here, the
+    // frames are decoded concurrently while the lock is held by current thread.
+    void **frames = calloc(range.length, sizeof(void *)); // retained YYImageFrame
+    if (!frames) return nil;
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    
+    if (!_needBlend) {
+        dispatch_apply(range.length, queue, ^(size_t i) {
+            @autoreleasepool {
+                YYImageFrame *frame = [self _unblendedFrameAtIndex:location + i decodeForDisplay:decodeForDisplay];
+                if (frame) frames[i] = (__bridge_retained void *)frame;
+            }
+        });
+    } else {
+        // A frame `s` starts an independent segment if no frame in [s, end) blends from
+        // a frame before `s`: the segment can be blended on its own clear canvas.
+        NSUInteger *starts = malloc((end + 1) * sizeof(NSUInteger));
+        CGImageRef *preloaded = calloc(end, sizeof(CGImageRef));
+        if (!starts || !preloaded) {
+            if (starts) free(starts);
+            if (preloaded) free(preloaded);
+            free(frames);
+            return nil;
+        }
+        NSUInteger startCount = 0;
+        NSUInteger minBlendIndex = end;
+        for (NSUInteger s = end; s > 0; s--) {
+            NSUInteger blendFromIndex = ((_YYImageDecoderFrame *)_frames[s - 1]).blendFromIndex;
+            minBlendIndex = MIN(minBlendIndex, blendFromIndex);
+            if (minBlendIndex == s - 1) {
+                starts[startCount++] = s - 1;
+                if (s - 1 <= location) break; // the first segment which contains `location`
+            }
+        }
+        if (startCount == 0 || starts[startCount - 1] > location) starts[startCount++] = 0;
+        
+        // reverse to ascending order
+        for (NSUInteger i = 0; i < startCount / 2; i++) {
+            NSUInteger tmp = starts[i];
+            starts[i] = starts[startCount - 1 - i];
+            starts[startCount - 1 - i] = tmp;
+        }
+        starts[startCount] = end;
+        
+        // decode the frame images (the expensive part) concurrently
+        NSUInteger first = starts[0];
+        dispatch_apply(end - first, queue, ^(size_t i) {
+            @autoreleasepool {
+                preloaded[first + i] = [self _newUnblendedImageAtIndex:first + i extendToCanvas:NO decoded:NULL];
+            }
+        });
+        
+        // blend the segments concurrently
+        dispatch_apply(startCount, queue, ^(size_t s) {
+            CGContextRef canvas = [self _newBlendCanvas];
+            if (!canvas) return;
+            for (NSUInteger i = starts[s]; i < starts[s + 1]; i++) {
+                @autoreleasepool {
+                    _YYImageDecoderFrame *frame = _frames[i];
+                    if (i < location) {
+                        [self _blendImageWithFrame:frame canvas:canvas preloaded:preloaded];
+                        continue;
+                    }
+                    CGImageRef imageRef = [self _newBlendedImageWithFrame:frame canvas:canvas preloaded:preloaded];
+                    YYImageFrame *result = [self _blendedFrameWithFrame:frame image:imageRef decodeForDisplay:decodeForDisplay];
+                    if (imageRef) CFRelease(imageRef);
+                    if (result) frames[i - location] = (__bridge_retained void *)result;
+                }
+            }
+            CFRelease(canvas);
+        });
+        
+        for (NSUInteger i = first; i < end; i++) {
+            if (preloaded[i]) CFRelease(preloaded[i]);
+        }
+        free(preloaded);
+        free(starts);
+    }
+    
+    for (NSUInteger i = 0; i < range.length; i++) {
+        if (frames[i]) {
+            [result addObject:(__bridge_transfer YYImageFrame *)frames[i]];
+        } else {
+            [result addObject:[NSNull null]];
+        }
+    }
+    free(frames);
+    return result;
+}
+
 - (NSDictionary *)_framePropertiesAtIndex:(NSUInteger)index {
     if (index >= _frames.count) return nil;
     if (!_source) return nil;
@@ -1727,14 +1927,59 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
             [self _updateSourceAPNG];
         } break;
             
+        case YYImageTypeGIF: {
+            [self _updateSourceGIF];
+        } break;
+            
         default: {
             [self _updateSourceImageIO];
         } break;
     }
+    _downsampleRatio = YYImageDownsampleRatio(_width, _height, _maxPixelSize);
+    _canvasWidth = YYImageDownsampleLength(_width, _downsampleRatio);
+    _canvasHeight = YYImageDownsampleLength(_height, _downsampleRatio);
+}
+
+/// Converts the frame's size and offset from the source canvas to the downsampled canvas.
+- (void)_downsampleFrame:(YYImageFrame *)frame {
+    if (_downsampleRatio >= 1) return;
+    frame.width = YYImageDownsampleLength(frame.width, _downsampleRatio);
+    frame.height = YYImageDownsampleLength(frame.height, _downsampleRatio);
+    frame.offsetX = round(frame.offsetX * _downsampleRatio);
+    frame.offsetY = round(frame.offsetY * _downsampleRatio);
+}
+
+/// Creates a frame image from an ImageIO source, downsampled with thumbnail API if needed.
+- (CGImageRef)_newImageFromSource:(CGImageSourceRef)source
+                          atIndex:(NSUInteger)index
+                       frameWidth:(size_t)frameWidth
+                      frameHeight:(size_t)frameHeight CF_RETURNS_RETAINED {
+    CGImageRef imageRef = NULL;
+    if (_downsampleRatio < 1) {
+        size_t maxSide = MAX(YYImageDownsampleLength(frameWidth, _downsampleRatio),
+                             YYImageDownsampleLength(frameHeight, _downsampleRatio));
+        NSDictionary *options = @{(id)kCGImageSourceCreateThumbnailFromImageAlways : @(YES),
+                                  (id)kCGImageSourceCreateThumbnailWithTransform : @(NO),
+                                  (id)kCGImageSourceThumbnailMaxPixelSize : @(maxSide),
+                                  (id)kCGImageSourceShouldCache : @(YES)};
+        imageRef = CGImageSourceCreateThumbnailAtIndex(source, index, (CFDictionaryRef)options);
+    }
+    if (!imageRef) { // full size, or the thumbnail is not available (e.g. incomplete data)
+        imageRef = CGImageSourceCreateImageAtIndex(source, index, (CFDictionaryRef)@{(id)kCGImageSourceShouldCache:@(YES)});
+    }
+    return imageRef;
 }
 
 - (void)_updateSourceWebP {
 #if YYIMAGE_WEBP_ENABLED
+    if (!_finalized) {
+        [self _updateSourceWebPIncremental];
+        return;
+    }
+    if (_webpIncrementalSource) {
+        WebPIDelete(_webpIncrementalSource);
+        _webpIncrementalSource = NULL;
+    }
     _width = 0;
     _height = 0;
     _loopCount = 0;
@@ -1746,9 +1991,8 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     
     /*
      https://developers.google.com/speed/webp/docs/api
-     The documentation said we can use WebPIDecoder to decode webp progressively, 
-     but currently it can only returns an empty image (not same as progressive jpegs),
-     so we don't use progressive decoding.
+     The incomplete single-frame webp is decoded with WebPIDecoder (see
+     `_updateSourceWebPIncremental`), here we decode the complete data.
      
      When using WebPDecode() to decode multi-frame webp, we will get the error
      "VP8_STATUS_UNSUPPORTED_FEATURE", so we first use WebPDemuxer to unpack it.
@@ -1839,6 +2083,50 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 #endif
 }
 
+- (void)_updateSourceWebPIncremental {
+#if YYIMAGE_WEBP_ENABLED
+    /*
+     WebPIDecoder keeps the decoding state, so we only append the new bytes
+     to it, the cost of each update is proportional to the new data.
+     The animated webp is ignored until the data is finalized.
+     */
+    if (!_webpIncrementalSource) {
+        WebPBitstreamFeatures features;
+        if (WebPGetFeatures(_data.bytes, _data.length, &features) != VP8_STATUS_OK) return; // not enough data
+        if (features.has_animation || features.width < 1 || features.height < 1) return;
+        _webpIncrementalSource = WebPINewRGB(MODE_bgrA, NULL, 0, 0);
+        if (!_webpIncrementalSource) return;
+        _webpIncrementalLength = 0;
+        _width = features.width;
+        _height = features.height;
+        _loopCount = 0;
+        
+        _YYImageDecoderFrame *frame = [_YYImageDecoderFrame new];
+        frame.width = _width;
+        frame.height = _height;
+        frame.hasAlpha = features.has_alpha;
+        frame.isFullSize = YES;
+        dispatch_semaphore_wait(_framesLock, DISPATCH_TIME_FOREVER);
+        _frames = @[frame];
+        dispatch_semaphore_signal(_framesLock);
+    }
+    if (_data.length > _webpIncrementalLength) {
+        VP8StatusCode status = WebPIAppend(_webpIncrementalSource, (const uint8_t *)_data.bytes + _webpIncrementalLength, _data.length - _webpIncrementalLength);
+        _webpIncrementalLength = _data.length;
+        if (status != VP8_STATUS_OK && status != VP8_STATUS_SUSPENDED) {
+            WebPIDelete(_webpIncrementalSource);
+            _webpIncrementalSource = NULL;
+            _frameCount = 0;
+            dispatch_semaphore_wait(_framesLock, DISPATCH_TIME_FOREVER);
+            _frames = nil;
+            dispatch_semaphore_signal(_framesLock);
+            return;
+        }
+    }
+    _frameCount = 1;
+#endif
+}
+
 - (void)_updateSourceAPNG {
     /*
      APNG extends PNG format to support animation, it was supported by ImageIO
@@ -1936,6 +2224,102 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     dispatch_semaphore_signal(_framesLock);
 }
 
+- (void)_updateSourceGIF {
+    /*
+     ImageIO decodes a GIF frame after all the previous frames are decoded, and 
+     holds the whole canvas for each frame.
+     
+     We use a custom GIF decoder which indexes the frames once (incrementally during
+     download), and decodes only the frame's own rect, so the frames can be accessed 
+     randomly and decoded concurrently, they are blended with the decoder's canvas
+     (same as APNG). If the data is invalid for the custom decoder, ImageIO is used
+     instead, as it's more tolerant of broken files.
+     */
+    
+    if (_source) { // fallback to ImageIO
+        [self _updateSourceImageIO];
+        return;
+    }
+    
+    BOOL valid = YES;
+    if (!_gifSource) {
+        _gifSource = yy_gif_info_create(_data.bytes, (uint32_t)_data.length);
+        valid = _gifSource != NULL;
+    } else {
+        valid = yy_gif_info_update(_gifSource, _data.bytes, (uint32_t)_data.length);
+    }
+    if (!valid || _gifSource->invalid) {
+        yy_gif_info_release(_gifSource);
+        _gifSource = NULL;
+        [self _updateSourceImageIO];
+        return;
+    }
+    
+    yy_gif_info *gif = _gifSource;
+    if (!gif->header_parsed || gif->frame_num == 0) return; // wait for more data
+    
+    uint32_t canvasWidth = gif->width;
+    uint32_t canvasHeight = gif->height;
+    uint32_t frameCount = _finalized ? gif->frame_num : 1; // ignore multi-frame before finalized
+    NSMutableArray *frames = [NSMutableArray new];
+    BOOL needBlend = NO;
+    uint32_t lastBlendIndex = 0;
+    for (uint32_t i = 0; i < frameCount; i++) {
+        _YYImageDecoderFrame *frame = [_YYImageDecoderFrame new];
+        [frames addObject:frame];
+        
+        yy_gif_frame_info *fi = gif->frames + i;
+        frame.index = i;
+        frame.duration = fi->delay / 100.0;
+        frame.hasAlpha = YES;
+        frame.width = fi->width;
+        frame.height = fi->height;
+        frame.offsetX = fi->x;
+        frame.offsetY = canvasHeight - fi->y - fi->height;
+        
+        BOOL sizeEqualsToCanvas = (frame.width == canvasWidth && frame.height == canvasHeight);
+        BOOL offsetIsZero = (fi->x == 0 && fi->y == 0);
+        frame.isFullSize = (sizeEqualsToCanvas && offsetIsZero);
+        
+        switch (fi->dispose) {
+            case YY_GIF_DISPOSE_BACKGROUND: {
+                frame.dispose = YYImageDisposeBackground;
+            } break;
+            case YY_GIF_DISPOSE_PREVIOUS: {
+                frame.dispose = YYImageDisposePrevious;
+            } break;
+            default: {
+                frame.dispose = YYImageDisposeNone;
+            } break;
+        }
+        // an opaque frame replaces its rect, same as 'blend none'
+        frame.blend = fi->has_transparency ? YYImageBlendOver : YYImageBlendNone;
+        
+        if (frame.blend == YYImageBlendNone && frame.isFullSize) {
+            frame.blendFromIndex  = i;
+            if (frame.dispose != YYImageDisposePrevious) lastBlendIndex = i;
+        } else {
+            if (frame.dispose == YYImageDisposeBackground && frame.isFullSize) {
+                frame.blendFromIndex = lastBlendIndex;
+                lastBlendIndex = i + 1;
+            } else {
+                frame.blendFromIndex = lastBlendIndex;
+            }
+        }
+        if (frame.index != frame.blendFromIndex) needBlend = YES;
+    }
+    
+    _width = canvasWidth;
+    _height = canvasHeight;
+    _orientation = UIImageOrientationUp;
+    _frameCount = frames.count;
+    _loopCount = gif->loop_num;
+    _needBlend = needBlend;
+    dispatch_semaphore_wait(_framesLock, DISPATCH_TIME_FOREVER);
+    _frames = frames;
+    dispatch_semaphore_signal(_framesLock);
+}
+
 - (void)_updateSourceImageIO {
     _width = 0;
     _height = 0;
@@ -2044,11 +2428,16 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     _YYImageDecoderFrame *frame = _frames[index];
     
     if (_source) {
-        CGImageRef imageRef = CGImageSourceCreateImageAtIndex(_source, index, (CFDictionaryRef)@{(id)kCGImageSourceShouldCache:@(YES)});
+        CGImageRef imageRef = [self _newImageFromSource:_source atIndex:index frameWidth:frame.width frameHeight:frame.height];
         if (imageRef && extendToCanvas) {
             size_t width = CGImageGetWidth(imageRef);
             size_t height = CGImageGetHeight(imageRef);
-            if (width == _width && height == _height) {
+            if (_downsampleRatio < 1) { // draw the fallback full size image to the downsampled canvas
+                width = YYImageDownsampleLength(frame.width, _downsampleRatio);
+                height = YYImageDownsampleLength(frame.height, _downsampleRatio);
+            }
+            if (width == CGImageGetWidth(imageRef) && height == CGImageGetHeight(imageRef) &&
+                width == _canvasWidth && height == _canvasHeight) {
                 CGImageRef imageRefExtended = YYCGImageCreateDecodedCopy(imageRef, YES);
                 if (imageRefExtended) {
                     CFRelease(imageRef);
@@ -2056,9 +2445,9 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
                     if (decoded) *decoded = YES;
                 }
             } else {
-                CGContextRef context = CGBitmapContextCreate(NULL, _width, _height, 8, 0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+                CGContextRef context = CGBitmapContextCreate(NULL, _canvasWidth, _canvasHeight, 8, 0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
                 if (context) {
-                    CGContextDrawImage(context, CGRectMake(0, _height - height, width, height), imageRef);
+                    CGContextDrawImage(context, CGRectMake(0, (CGFloat)_canvasHeight - height, width, height), imageRef);
                     CGImageRef imageRefExtended = CGBitmapContextCreateImage(context);
                     CFRelease(context);
                     if (imageRefExtended) {
@@ -2095,12 +2484,13 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
             return NULL;
         }
         
-        CGImageRef imageRef = CGImageSourceCreateImageAtIndex(source, 0, (CFDictionaryRef)@{(id)kCGImageSourceShouldCache:@(YES)});
+        CGImageRef imageRef = [self _newImageFromSource:source atIndex:0 frameWidth:frame.width frameHeight:frame.height];
         CFRelease(source);
         if (!imageRef) return NULL;
         if (extendToCanvas) {
-            CGContextRef context = CGBitmapContextCreate(NULL, _width, _height, 8, 0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst); //bgrA
+            CGContextRef context = CGBitmapContextCreate(NULL, _canvasWidth, _canvasHeight, 8, 0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst); //bgrA
             if (context) {
+                CGContextScaleCTM(context, (CGFloat)_canvasWidth / _width, (CGFloat)_canvasHeight / _height);
                 CGContextDrawImage(context, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), imageRef);
                 CFRelease(imageRef);
                 imageRef = CGBitmapContextCreateImage(context);
@@ -2111,7 +2501,86 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
         return imageRef;
     }
     
+    if (_gifSource) {
+        size_t bytesPerRow = 0;
+        uint8_t *bitmap = yy_gif_copy_frame_bitmap_at_index(_data.bytes, _gifSource, (uint32_t)index, &bytesPerRow);
+        if (!bitmap) return NULL;
+        CGDataProviderRef provider = CGDataProviderCreateWithData(bitmap, bitmap, bytesPerRow * frame.height, YYCGDataProviderReleaseDataCallback);
+        if (!provider) {
+            free(bitmap);
+            return NULL;
+        }
+        bitmap = NULL; // hold by provider
+        
+        CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst; //bgrA
+        CGImageRef imageRef = CGImageCreate(frame.width, frame.height, 8, 32, bytesPerRow, YYCGColorSpaceGetDeviceRGB(), bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+        CFRelease(provider);
+        if (!imageRef) return NULL;
+        
+        CGContextRef context = NULL;
+        if (extendToCanvas) {
+            context = CGBitmapContextCreate(NULL, _canvasWidth, _canvasHeight, 8, 0, YYCGColorSpaceGetDeviceRGB(), bitmapInfo);
+            if (context) {
+                CGContextScaleCTM(context, (CGFloat)_canvasWidth / _width, (CGFloat)_canvasHeight / _height);
+                CGContextDrawImage(context, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), imageRef);
+            }
+        } else if (_downsampleRatio < 1) {
+            size_t width = YYImageDownsampleLength(frame.width, _downsampleRatio);
+            size_t height = YYImageDownsampleLength(frame.height, _downsampleRatio);
+            context = CGBitmapContextCreate(NULL, width, height, 8, 0, YYCGColorSpaceGetDeviceRGB(), bitmapInfo);
+            if (context) {
+                CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
+            }
+        }
+        if (context) {
+            CGImageRef imageRefDrawn = CGBitmapContextCreateImage(context);
+            CFRelease(context);
+            if (imageRefDrawn) {
+                CFRelease(imageRef);
+                imageRef = imageRefDrawn;
+            }
+        }
+        if (decoded) *decoded = YES;
+        return imageRef;
+    }
+    
 #if YYIMAGE_WEBP_ENABLED
+    if (_webpIncrementalSource) {
+        int lastY = 0, width = 0, height = 0, stride = 0;
+        const uint8_t *rows = WebPIDecGetRGB(_webpIncrementalSource, &lastY, &width, &height, &stride);
+        if (!rows || lastY < 1 || width < 1 || height < 1) return NULL;
+        
+        // copy the decoded rows, the decoder's buffer is still being written
+        size_t bytesPerRow = YYImageByteAlign(width * 4, 32);
+        size_t length = bytesPerRow * height;
+        uint8_t *pixels = calloc(1, length);
+        if (!pixels) return NULL;
+        for (int y = 0; y < lastY; y++) {
+            memcpy(pixels + y * bytesPerRow, rows + y * stride, width * 4);
+        }
+        CGDataProviderRef provider = CGDataProviderCreateWithData(pixels, pixels, length, YYCGDataProviderReleaseDataCallback);
+        if (!provider) {
+            free(pixels);
+            return NULL;
+        }
+        pixels = NULL; // hold by provider
+        
+        CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst; //bgrA
+        CGImageRef image = CGImageCreate(width, height, 8, 32, bytesPerRow, YYCGColorSpaceGetDeviceRGB(), bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+        CFRelease(provider);
+        if (image && _downsampleRatio < 1) {
+            CGContextRef context = CGBitmapContextCreate(NULL, _canvasWidth, _canvasHeight, 8, 0, YYCGColorSpaceGetDeviceRGB(), bitmapInfo);
+            if (context) {
+                CGContextDrawImage(context, CGRectMake(0, 0, _canvasWidth, _canvasHeight), image);
+                CFRelease(image);
+                image = CGBitmapContextCreateImage(context);
+                CFRelease(context);
+            }
+        }
+        if (decoded) *decoded = YES;
+        return image;
+    }
+    
     if (_webpSource) {
         WebPIterator iter;
         if (!WebPDemuxGetFrame(_webpSource, (int)(index + 1), &iter)) return NULL; // demux webp frame data
@@ -2121,9 +2590,18 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
         int frameHeight = iter.height;
         if (frameWidth < 1 || frameHeight < 1) return NULL;
         
-        int width = extendToCanvas ? (int)_width : frameWidth;
-        int height = extendToCanvas ? (int)_height : frameHeight;
-        if (width > _width || height > _height) return NULL;
+        int offsetX = iter.x_offset;
+        int offsetY = iter.y_offset;
+        if (_downsampleRatio < 1) {
+            frameWidth = (int)MIN(YYImageDownsampleLength(frameWidth, _downsampleRatio), _canvasWidth);
+            frameHeight = (int)MIN(YYImageDownsampleLength(frameHeight, _downsampleRatio), _canvasHeight);
+            offsetX = (int)round(offsetX * _downsampleRatio);
+            offsetY = (int)round(offsetY * _downsampleRatio);
+        }
+        
+        int width = extendToCanvas ? (int)_canvasWidth : frameWidth;
+        int height = extendToCanvas ? (int)_canvasHeight : frameHeight;
+        if (width > _canvasWidth || height > _canvasHeight) return NULL;
         
         const uint8_t *payload = iter.fragment.bytes;
         size_t payloadSize = iter.fragment.size;
@@ -2150,6 +2628,11 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
             return NULL;
         }
         
+        if (_downsampleRatio < 1) {
+            config.options.use_scaling = 1;
+            config.options.scaled_width = frameWidth;
+            config.options.scaled_height = frameHeight;
+        }
         config.output.colorspace = MODE_bgrA;
         config.output.is_external_memory = 1;
         config.output.u.RGBA.rgba = pixels;
@@ -2163,12 +2646,12 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
         }
         WebPDemuxReleaseIterator(&iter);
         
-        if (extendToCanvas && (iter.x_offset != 0 || iter.y_offset != 0)) {
+        if (extendToCanvas && (offsetX != 0 || offsetY != 0)) {
             void *tmp = calloc(1, length);
             if (tmp) {
                 vImage_Buffer src = {pixels, height, width, bytesPerRow};
                 vImage_Buffer dest = {tmp, height, width, bytesPerRow};
-                vImage_CGAffineTransform transform = {1, 0, 0, 1, iter.x_offset, -iter.y_offset};
+                vImage_CGAffineTransform transform = {1, 0, 0, 1, offsetX, -offsetY};
                 uint8_t backColor[4] = {0};
                 vImage_Error error = vImageAffineWarpCG_ARGB8888(&src, &dest, NULL, &transform, backColor, kvImageBackgroundColorFill);
                 if (error == kvImageNoError) {
@@ -2195,104 +2678,119 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     return NULL;
 }
 
+- (CGContextRef)_newBlendCanvas CF_RETURNS_RETAINED {
+    CGContextRef canvas = CGBitmapContextCreate(NULL, _canvasWidth, _canvasHeight, 8, 0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+    if (canvas && _downsampleRatio < 1) {
+        // frames are blended in source canvas coordinates, with downsampled frame images
+        CGContextScaleCTM(canvas, (CGFloat)_canvasWidth / _width, (CGFloat)_canvasHeight / _height);
+    }
+    return canvas;
+}
+
 - (BOOL)_createBlendContextIfNeeded {
     if (!_blendCanvas) {
         _blendFrameIndex = NSNotFound;
-        _blendCanvas = CGBitmapContextCreate(NULL, _width, _height, 8, 0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+        _blendCanvas = [self _newBlendCanvas];
     }
     BOOL suc = _blendCanvas != NULL;
     return suc;
 }
 
-- (void)_blendImageWithFrame:(_YYImageDecoderFrame *)frame {
+/// Returns the preloaded frame image (if exists), or decodes it.
+- (CGImageRef)_newUnblendedImageAtIndex:(NSUInteger)index preloaded:(CGImageRef *)preloaded CF_RETURNS_RETAINED {
+    if (preloaded && preloaded[index]) return CGImageRetain(preloaded[index]);
+    return [self _newUnblendedImageAtIndex:index extendToCanvas:NO decoded:NULL];
+}
+
+- (void)_blendImageWithFrame:(_YYImageDecoderFrame *)frame canvas:(CGContextRef)canvas preloaded:(CGImageRef *)preloaded {
     if (frame.dispose == YYImageDisposePrevious) {
         // nothing
     } else if (frame.dispose == YYImageDisposeBackground) {
-        CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+        CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
     } else { // no dispose
         if (frame.blend == YYImageBlendOver) {
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
         } else {
-            CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
         }
     }
 }
 
-- (CGImageRef)_newBlendedImageWithFrame:(_YYImageDecoderFrame *)frame CF_RETURNS_RETAINED{
+- (CGImageRef)_newBlendedImageWithFrame:(_YYImageDecoderFrame *)frame canvas:(CGContextRef)canvas preloaded:(CGImageRef *)preloaded CF_RETURNS_RETAINED{
     CGImageRef imageRef = NULL;
     if (frame.dispose == YYImageDisposePrevious) {
         if (frame.blend == YYImageBlendOver) {
-            CGImageRef previousImage = CGBitmapContextCreateImage(_blendCanvas);
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef previousImage = CGBitmapContextCreateImage(canvas);
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
-            imageRef = CGBitmapContextCreateImage(_blendCanvas);
-            CGContextClearRect(_blendCanvas, CGRectMake(0, 0, _width, _height));
+            imageRef = CGBitmapContextCreateImage(canvas);
+            CGContextClearRect(canvas, CGRectMake(0, 0, _width, _height));
             if (previousImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(0, 0, _width, _height), previousImage);
+                CGContextDrawImage(canvas, CGRectMake(0, 0, _width, _height), previousImage);
                 CFRelease(previousImage);
             }
         } else {
-            CGImageRef previousImage = CGBitmapContextCreateImage(_blendCanvas);
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef previousImage = CGBitmapContextCreateImage(canvas);
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
-            imageRef = CGBitmapContextCreateImage(_blendCanvas);
-            CGContextClearRect(_blendCanvas, CGRectMake(0, 0, _width, _height));
+            imageRef = CGBitmapContextCreateImage(canvas);
+            CGContextClearRect(canvas, CGRectMake(0, 0, _width, _height));
             if (previousImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(0, 0, _width, _height), previousImage);
+                CGContextDrawImage(canvas, CGRectMake(0, 0, _width, _height), previousImage);
                 CFRelease(previousImage);
             }
         }
     } else if (frame.dispose == YYImageDisposeBackground) {
         if (frame.blend == YYImageBlendOver) {
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
-            imageRef = CGBitmapContextCreateImage(_blendCanvas);
-            CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+            imageRef = CGBitmapContextCreateImage(canvas);
+            CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
         } else {
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
-            imageRef = CGBitmapContextCreateImage(_blendCanvas);
-            CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+            imageRef = CGBitmapContextCreateImage(canvas);
+            CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
         }
     } else { // no dispose
         if (frame.blend == YYImageBlendOver) {
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
-            imageRef = CGBitmapContextCreateImage(_blendCanvas);
+            imageRef = CGBitmapContextCreateImage(canvas);
         } else {
-            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index extendToCanvas:NO decoded:NULL];
+            CGImageRef unblendImage = [self _newUnblendedImageAtIndex:frame.index preloaded:preloaded];
             if (unblendImage) {
-                CGContextClearRect(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
-                CGContextDrawImage(_blendCanvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
+                CGContextClearRect(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height));
+                CGContextDrawImage(canvas, CGRectMake(frame.offsetX, frame.offsetY, frame.width, frame.height), unblendImage);
                 CFRelease(unblendImage);
             }
-            imageRef = CGBitmapContextCreateImage(_blendCanvas);
+            imageRef = CGBitmapContextCreateImage(canvas);
         }
     }
     return imageRef;
@@ -2304,9 +2802,155 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 ////////////////////////////////////////////////////////////////////////////////
 #pragma mark - Encoder
 
+static inline uint32_t YYImageReadLittleEndian(const uint8_t *data, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) value = (value << 8) | data[i];
+    return value;
+}
+
+static inline void YYImageWriteLittleEndian(uint8_t *data, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) data[i] = (value >> (8 * i)) & 0xFF;
+}
+
+/// A rect in canvas (top-left based), in pixels.
+typedef struct {
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+} YYImagePixelRect;
+
+/**
+ Finds the smallest area of the canvas to be updated for a frame of animation, and 
+ chooses the previous frame's dispose method and the frame's blend operation.
+ 
+ @discussion The previous frame is disposed to background only if it reduces the area.
+ The frame can be blended over the canvas only if all the changed pixels are opaque,
+ the unchanged pixels in the area should be cleared then (see YYImageCanvasCopyRect()),
+ which compresses better.
+ 
+ @param canvas         The frame's canvas, 32 bits per pixel, `width * 4` bytes per row.
+ @param previous       The previous frame's canvas. The previous rect is cleared if the 
+                       previous frame should be disposed to background, so it becomes 
+                       the canvas which the frame is drawn on.
+ @param width          Canvas width.
+ @param height         Canvas height.
+ @param previousRect   The previous frame's rect.
+ @param evenOffset     Whether the origin of the result rect should be even (WebP).
+ @param disposeBackground Output, whether the previous frame should be disposed to background.
+ @param blendOver      Output, whether the frame should be blended over the canvas.
+ @return The frame's rect, it's 1x1 at origin if the frame is same as the previous one.
+ */
+static YYImagePixelRect YYImageCanvasDiff(const uint32_t *canvas, uint32_t *previous,
+                                          size_t width, size_t height,
+                                          YYImagePixelRect previousRect, bool evenOffset,
+                                          bool *disposeBackground, bool *blendOver) {
+    // bounds (inclusive) of changed pixels: [0] keep previous frame, [1] dispose previous frame to background
+    size_t minX[2] = {SIZE_MAX, SIZE_MAX}, minY[2] = {SIZE_MAX, SIZE_MAX}, maxX[2] = {0, 0}, maxY[2] = {0, 0};
+    for (size_t y = 0; y < height; y++) {
+        const uint32_t *cur = canvas + y * width;
+        const uint32_t *pre = previous + y * width;
+        bool rowInRect = y >= previousRect.y && y < previousRect.y + previousRect.height;
+        for (size_t x = 0; x < width; x++) {
+            uint32_t disposed = (rowInRect && x >= previousRect.x && x < previousRect.x + previousRect.width) ? 0 : pre[x];
+            if (cur[x] != pre[x]) {
+                if (minX[0] > x) minX[0] = x;
+                if (maxX[0] < x) maxX[0] = x;
+                if (minY[0] == SIZE_MAX) minY[0] = y;
+                maxY[0] = y;
+            }
+            if (cur[x] != disposed) {
+                if (minX[1] > x) minX[1] = x;
+                if (maxX[1] < x) maxX[1] = x;
+                if (minY[1] == SIZE_MAX) minY[1] = y;
+                maxY[1] = y;
+            }
+        }
+    }
+    
+    size_t area[2];
+    for (int i = 0; i < 2; i++) {
+        area[i] = minY[i] == SIZE_MAX ? 0 : (maxX[i] - minX[i] + 1) * (maxY[i] - minY[i] + 1);
+    }
+    int mode = area[1] < area[0] ? 1 : 0;
+    *disposeBackground = mode == 1;
+    if (mode == 1) {
+        for (size_t y = previousRect.y; y < previousRect.y + previousRect.height; y++) {
+            memset(previous + y * width + previousRect.x, 0, previousRect.width * 4);
+        }
+    }
+    
+    if (minY[mode] == SIZE_MAX) { // nothing changed
+        *blendOver = true;
+        return (YYImagePixelRect){0, 0, 1, 1};
+    }
+    
+    YYImagePixelRect rect;
+    rect.x = evenOffset ? (minX[mode] & ~(size_t)1) : minX[mode];
+    rect.y = evenOffset ? (minY[mode] & ~(size_t)1) : minY[mode];
+    rect.width = maxX[mode] - rect.x + 1;
+    rect.height = maxY[mode] - rect.y + 1;
+    
+    bool over = true;
+    for (size_t y = rect.y; y < rect.y + rect.height && over; y++) {
+        const uint32_t *cur = canvas + y * width;
+        const uint32_t *pre = previous + y * width;
+        for (size_t x = rect.x; x < rect.x + rect.width; x++) {
+            if (cur[x] != pre[x] && (cur[x] >> 24) != 0xFF) { // partially transparent
+                over = false;
+                break;
+            }
+        }
+    }
+    *blendOver = over;
+    return rect;
+}
+
+/**
+ Copies the pixels in rect of a canvas to a new bitmap (`rect.width * 4` bytes per row).
+ 
+ @param canvas     The canvas, 32 bits per pixel, `width * 4` bytes per row.
+ @param base       The canvas which the frame is drawn on, pass NULL to copy all the pixels.
+ @param width      Canvas width.
+ @param rect       The rect to copy.
+ @return The bitmap with the pixels same as `base` cleared, call free() to release it.
+ Returns NULL if an error occurs.
+ */
+static uint32_t *YYImageCanvasCopyRect(const uint32_t *canvas, const uint32_t *base,
+                                       size_t width, YYImagePixelRect rect) {
+    uint32_t *pixels = malloc(rect.width * rect.height * 4);
+    if (!pixels) return NULL;
+    for (size_t y = 0; y < rect.height; y++) {
+        const uint32_t *src = canvas + (rect.y + y) * width + rect.x;
+        uint32_t *dst = pixels + y * rect.width;
+        if (base) {
+            const uint32_t *pre = base + (rect.y + y) * width + rect.x;
+            for (size_t x = 0; x < rect.width; x++) {
+                dst[x] = src[x] == pre[x] ? 0 : src[x];
+            }
+        } else {
+            memcpy(dst, src, rect.width * 4);
+        }
+    }
+    return pixels;
+}
+
+
 @implementation YYImageEncoder {
     NSMutableArray *_images;
     NSMutableArray *_durations;
+    
+    FILE *_stream;                     ///< the output file in streaming mode
+    NSString *_streamPath;
+    BOOL _streamFailed;
+    CGContextRef _streamCanvas;        ///< canvas of the last added frame
+    uint32_t *_streamPrevious;         ///< canvas of the previous frame
+    YYImageFrame *_streamPendingFrame; ///< the last added frame, waiting for its dispose method
+    NSData *_streamPendingData;        ///< encoded data of the pending frame
+    uint32_t _streamFrameCount;        ///< count of the frames written to file
+    uint32_t _streamSequence;          ///< APNG sequence number
+    off_t _streamControlOffset;        ///< APNG `acTL` chunk offset
+    BOOL _streamHasAlpha;              ///< whether a WebP frame has alpha
 }
 
 - (instancetype)init {
@@ -2332,6 +2976,7 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     _type = type;
     _images = [NSMutableArray new];
     _durations = [NSMutableArray new];
+    _optimizesFrames = YES;
 
     switch (type) {
         case YYImageTypeJPEG:
@@ -2357,6 +3002,12 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     return self;
 }
 
+- (void)dealloc {
+    if (_stream) fclose(_stream);
+    if (_streamCanvas) CFRelease(_streamCanvas);
+    if (_streamPrevious) free(_streamPrevious);
+}
+
 - (void)setQuality:(CGFloat)quality {
     _quality = quality < 0 ? 0 : quality > 1 ? 1 : quality;
 }
@@ -2364,6 +3015,10 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 - (void)addImage:(UIImage *)image duration:(NSTimeInterval)duration {
     if (!image.CGImage) return;
     duration = duration < 0 ? 0 : duration;
+    if (_stream) {
+        [self _streamAddImage:image duration:duration];
+        return;
+    }
     [_images addObject:image];
     [_durations addObject:@(duration)];
 }
@@ -2371,6 +3026,10 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 - (void)addImageWithData:(NSData *)data duration:(NSTimeInterval)duration {
     if (data.length == 0) return;
     duration = duration < 0 ? 0 : duration;
+    if (_stream) {
+        [self _streamAddImage:data duration:duration];
+        return;
+    }
     [_images addObject:data];
     [_durations addObject:@(duration)];
 }
@@ -2380,6 +3039,10 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     duration = duration < 0 ? 0 : duration;
     NSURL *url = [NSURL URLWithString:path];
     if (!url) return;
+    if (_stream) {
+        [self _streamAddImage:url duration:duration];
+        return;
+    }
     [_images addObject:url];
     [_durations addObject:@(duration)];
 }
@@ -2465,8 +3128,12 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 }
 
 - (CGImageRef)_newCGImageFromIndex:(NSUInteger)index decoded:(BOOL)decoded CF_RETURNS_RETAINED {
+    return [self _newCGImageFromSource:_images[index] decoded:decoded];
+}
+
+/// Creates a CGImage from an added image (UIImage, NSData or NSURL).
+- (CGImageRef)_newCGImageFromSource:(id)imageSrc decoded:(BOOL)decoded CF_RETURNS_RETAINED {
     UIImage *image = nil;
-    id imageSrc= _images[index];
     if ([imageSrc isKindOfClass:[UIImage class]]) {
         image = imageSrc;
     } else if ([imageSrc isKindOfClass:[NSURL class]]) {
@@ -2515,47 +3182,286 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     return suc;
 }
 
+/**
+ Draws an image to the canvas and crops it to the area changed from the previous
+ canvas, see YYImageCanvasDiff(). The frame's offsets are left-bottom based, same
+ as the decoder's.
+ 
+ @param imageRef      The image, drawn at the top-left of the canvas.
+ @param context       The canvas (`width * 4` bytes per row, bgrA).
+ @param previous      The previous canvas, it's updated to the current canvas.
+ @param previousFrame The previous frame, its dispose method is updated. Pass nil to
+                      return the full canvas.
+ @param evenOffset    Whether the frame's offsets (top-left based) should be even.
+ @return The frame with the cropped image, or nil if an error occurs.
+ */
+- (YYImageFrame *)_optimizedFrameWithImage:(CGImageRef)imageRef
+                                    canvas:(CGContextRef)context
+                                  previous:(uint32_t *)previous
+                             previousFrame:(YYImageFrame *)previousFrame
+                                evenOffset:(BOOL)evenOffset {
+    size_t width = CGBitmapContextGetWidth(context), height = CGBitmapContextGetHeight(context);
+    uint32_t *canvas = CGBitmapContextGetData(context);
+    size_t imageWidth = CGImageGetWidth(imageRef), imageHeight = CGImageGetHeight(imageRef);
+    CGContextClearRect(context, CGRectMake(0, 0, width, height));
+    CGContextDrawImage(context, CGRectMake(0, (CGFloat)height - imageHeight, imageWidth, imageHeight), imageRef); // top-left aligned
+    CGContextFlush(context);
+    
+    YYImagePixelRect rect = {0, 0, width, height};
+    bool blendOver = false;
+    if (previousFrame) {
+        bool disposeBackground = false;
+        YYImagePixelRect previousRect = {previousFrame.offsetX, height - previousFrame.offsetY - previousFrame.height, previousFrame.width, previousFrame.height};
+        rect = YYImageCanvasDiff(canvas, previous, width, height, previousRect, evenOffset, &disposeBackground, &blendOver);
+        previousFrame.dispose = disposeBackground ? YYImageDisposeBackground : YYImageDisposeNone;
+    }
+    
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst; //bgrA
+    uint32_t *pixels = YYImageCanvasCopyRect(canvas, blendOver ? previous : NULL, width, rect);
+    memcpy(previous, canvas, width * height * 4);
+    if (!pixels) return nil;
+    CGDataProviderRef provider = CGDataProviderCreateWithData(pixels, pixels, rect.width * rect.height * 4, YYCGDataProviderReleaseDataCallback);
+    if (!provider) {
+        free(pixels);
+        return nil;
+    }
+    CGImageRef frameImageRef = CGImageCreate(rect.width, rect.height, 8, 32, rect.width * 4, YYCGColorSpaceGetDeviceRGB(), bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    CFRelease(provider);
+    if (!frameImageRef) return nil;
+    
+    YYImageFrame *frame = [YYImageFrame frameWithImage:[UIImage imageWithCGImage:frameImageRef]];
+    CFRelease(frameImageRef);
+    frame.width = rect.width;
+    frame.height = rect.height;
+    frame.offsetX = rect.x;
+    frame.offsetY = height - rect.y - rect.height;
+    frame.dispose = YYImageDisposeNone;
+    frame.blend = blendOver ? YYImageBlendOver : YYImageBlendNone;
+    return frame;
+}
+
+/**
+ Draws each frame to the canvas and crops it to the changed area.
+ 
+ @param evenOffset Whether the frames' offsets (top-left based) should be even.
+ @param canvasSize Output canvas size.
+ @return The frames with cropped images, or nil if an error occurs.
+ */
+- (NSArray<YYImageFrame *> *)_optimizedFramesWithEvenOffset:(BOOL)evenOffset canvasSize:(CGSize *)canvasSize {
+    NSMutableArray *images = [NSMutableArray new];
+    size_t width = 0, height = 0;
+    for (NSUInteger i = 0; i < _images.count; i++) {
+        CGImageRef imageRef = [self _newCGImageFromIndex:i decoded:NO];
+        if (!imageRef) return nil;
+        if (width < CGImageGetWidth(imageRef)) width = CGImageGetWidth(imageRef);
+        if (height < CGImageGetHeight(imageRef)) height = CGImageGetHeight(imageRef);
+        [images addObject:(__bridge id)imageRef];
+        CFRelease(imageRef);
+    }
+    if (width < 1 || height < 1) return nil;
+    
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, width * 4, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+    uint32_t *previous = malloc(width * height * 4);
+    if (!context || !previous) {
+        if (context) CFRelease(context);
+        if (previous) free(previous);
+        return nil;
+    }
+    
+    NSMutableArray *frames = [NSMutableArray new];
+    for (NSUInteger i = 0; i < images.count; i++) {
+        YYImageFrame *frame = [self _optimizedFrameWithImage:(__bridge CGImageRef)images[i] canvas:context previous:previous previousFrame:frames.lastObject evenOffset:evenOffset];
+        if (!frame) {
+            frames = nil;
+            break;
+        }
+        frame.index = i;
+        frame.duration = [(NSNumber *)_durations[i] doubleValue];
+        [frames addObject:frame];
+    }
+    CFRelease(context);
+    free(previous);
+    if (canvasSize) *canvasSize = CGSizeMake(width, height);
+    return frames;
+}
+
+/**
+ Encodes the frames concurrently (the concurrency is limited by dispatch_apply to the
+ active processor count), and invokes the progress block.
+ 
+ @param count The frame count.
+ @param block The block to encode a frame, it's invoked concurrently on background threads.
+ @return The encoded frame data ordered by index, or nil if an error occurs or the encoding is cancelled.
+ */
+- (NSMutableArray *)_encodeFrames:(NSUInteger)count withBlock:(CFDataRef (^)(NSUInteger index))block {
+    if (count == 0) return nil;
+    void **datas = calloc(count, sizeof(void *)); // retained CFDataRef
+    if (!datas) return nil;
+    void (^progress)(NSUInteger, NSUInteger, BOOL *) = _progressBlock;
+    dispatch_semaphore_t lock = dispatch_semaphore_create(1);
+    __block NSUInteger encodedCount = 0;
+    __block BOOL stop = NO; // cancelled, or a frame is failed
+    
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_apply(count, queue, ^(size_t i) {
+        dispatch_semaphore_wait(lock, DISPATCH_TIME_FOREVER);
+        BOOL stopped = stop;
+        dispatch_semaphore_signal(lock);
+        if (stopped) return;
+        
+        @autoreleasepool {
+            CFDataRef data = block(i);
+            datas[i] = (void *)data;
+            dispatch_semaphore_wait(lock, DISPATCH_TIME_FOREVER);
+            if (!data) {
+                stop = YES;
+            } else if (!stop) {
+                encodedCount++;
+                if (progress) progress(encodedCount, count, &stop);
+            }
+            dispatch_semaphore_signal(lock);
+        }
+    });
+    
+    NSMutableArray *result = stop ? nil : [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        if (!datas[i]) continue;
+        [result addObject:(__bridge id)datas[i]];
+        CFRelease(datas[i]);
+    }
+    free(datas);
+    return result;
+}
+
+/// Appends an APNG `acTL` chunk.
+- (void)_appendAPNGAnimationControlWithFrameCount:(uint32_t)frameCount toData:(NSMutableData *)data {
+    uint32_t acTL[5] = {0};
+    acTL[0] = yy_swap_endian_uint32(8); //length
+    acTL[1] = YY_FOUR_CC('a', 'c', 'T', 'L'); // fourcc
+    acTL[2] = yy_swap_endian_uint32(frameCount); // num frames
+    acTL[3] = yy_swap_endian_uint32((uint32_t)_loopCount); // num plays
+    acTL[4] = yy_swap_endian_uint32((uint32_t)crc32(0, (const Bytef *)(acTL + 1), 12)); //crc32
+    [data appendBytes:acTL length:20];
+}
+
+/// Appends the `IDAT` chunks of a PNG as APNG `fdAT` chunks, the sequence number is increased.
+- (void)_appendAPNGFrameDataWithPNGData:(NSData *)pngData info:(yy_png_info *)info sequence:(uint32_t *)sequence toData:(NSMutableData *)data {
+    for (int d = 0; d < info->chunk_num; d++) {
+        yy_png_chunk_info *dchunk = info->chunks + d;
+        if (dchunk->fourcc == YY_FOUR_CC('I', 'D', 'A', 'T')) {
+            uint32_t length = yy_swap_endian_uint32(dchunk->length + 4);
+            [data appendBytes:&length length:4]; //length
+            uint32_t fourcc = YY_FOUR_CC('f', 'd', 'A', 'T');
+            [data appendBytes:&fourcc length:4]; //fourcc
+            uint32_t sq = yy_swap_endian_uint32(*sequence);
+            [data appendBytes:&sq length:4]; //data (sq)
+            [data appendBytes:(((uint8_t *)pngData.bytes) + dchunk->offset + 8) length:dchunk->length]; //data
+            uint8_t *bytes = ((uint8_t *)data.bytes) + data.length - dchunk->length - 8;
+            uint32_t crc = yy_swap_endian_uint32((uint32_t)crc32(0, bytes, dchunk->length + 8));
+            [data appendBytes:&crc length:4]; //crc
+            
+            (*sequence)++;
+        }
+    }
+}
+
+/// Appends an APNG `fcTL` chunk for the frame.
+- (void)_appendAPNGFrameControl:(YYImageFrame *)frame sequence:(uint32_t)sequence canvasHeight:(NSUInteger)canvasHeight toData:(NSMutableData *)data {
+    yy_png_chunk_fcTL chunk_fcTL = {0};
+    chunk_fcTL.sequence_number = sequence;
+    chunk_fcTL.width = (uint32_t)frame.width;
+    chunk_fcTL.height = (uint32_t)frame.height;
+    chunk_fcTL.x_offset = (uint32_t)frame.offsetX;
+    chunk_fcTL.y_offset = (uint32_t)(canvasHeight - frame.offsetY - frame.height);
+    yy_png_delay_to_fraction(frame.duration, &chunk_fcTL.delay_num, &chunk_fcTL.delay_den);
+    chunk_fcTL.dispose_op = frame.dispose == YYImageDisposeBackground ? YY_PNG_DISPOSE_OP_BACKGROUND : YY_PNG_DISPOSE_OP_NONE;
+    chunk_fcTL.blend_op = frame.blend == YYImageBlendOver ? YY_PNG_BLEND_OP_OVER : YY_PNG_BLEND_OP_SOURCE;
+    
+    uint8_t fcTL[38] = {0};
+    *((uint32_t *)fcTL) = yy_swap_endian_uint32(26); //length
+    *((uint32_t *)(fcTL + 4)) = YY_FOUR_CC('f', 'c', 'T', 'L'); // fourcc
+    yy_png_chunk_fcTL_write(&chunk_fcTL, fcTL + 8);
+    *((uint32_t *)(fcTL + 34)) = yy_swap_endian_uint32((uint32_t)crc32(0, (const Bytef *)(fcTL + 4), 30));
+    [data appendBytes:fcTL length:38];
+}
+
 - (NSData *)_encodeAPNG {
     // encode APNG (ImageIO doesn't support APNG encoding, so we use a custom encoder)
-    NSMutableArray *pngDatas = [NSMutableArray new];
-    NSMutableArray *pngSizes = [NSMutableArray new];
+    NSMutableArray *pngDatas = nil;
+    NSMutableArray *frames = [NSMutableArray new];
     NSUInteger canvasWidth = 0, canvasHeight = 0;
-    for (int i = 0; i < _images.count; i++) {
-        CGImageRef decoded = [self _newCGImageFromIndex:i decoded:YES];
-        if (!decoded) return nil;
-        CGSize size = CGSizeMake(CGImageGetWidth(decoded), CGImageGetHeight(decoded));
-        [pngSizes addObject:[NSValue valueWithCGSize:size]];
-        if (canvasWidth < size.width) canvasWidth = size.width;
-        if (canvasHeight < size.height) canvasHeight = size.height;
-        CFDataRef frameData = YYCGImageCreateEncodedData(decoded, YYImageTypePNG, 1);
-        CFRelease(decoded);
-        if (!frameData) return nil;
-        [pngDatas addObject:(__bridge id)(frameData)];
-        CFRelease(frameData);
-        if (size.width < 1 || size.height < 1) return nil;
-    }
-    CGSize firstFrameSize = [(NSValue *)[pngSizes firstObject] CGSizeValue];
-    if (firstFrameSize.width < canvasWidth || firstFrameSize.height < canvasHeight) {
-        CGImageRef decoded = [self _newCGImageFromIndex:0 decoded:YES];
-        if (!decoded) return nil;
-        CGContextRef context = CGBitmapContextCreate(NULL, canvasWidth, canvasHeight, 8,
-                                                     0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
-        if (!context) {
+    if (_optimizesFrames) {
+        CGSize canvasSize = CGSizeZero;
+        NSArray *optimizedFrames = [self _optimizedFramesWithEvenOffset:NO canvasSize:&canvasSize];
+        if (!optimizedFrames) return nil;
+        canvasWidth = canvasSize.width;
+        canvasHeight = canvasSize.height;
+        pngDatas = [self _encodeFrames:optimizedFrames.count withBlock:^CFDataRef(NSUInteger index) {
+            return YYCGImageCreateEncodedData(((YYImageFrame *)optimizedFrames[index]).image.CGImage, YYImageTypePNG, 1);
+        }];
+        if (!pngDatas) return nil;
+        for (YYImageFrame *frame in optimizedFrames) {
+            frame.image = nil;
+            [frames addObject:frame];
+        }
+    } else {
+        NSUInteger count = _images.count;
+        CGSize *sizes = calloc(count, sizeof(CGSize));
+        if (!sizes) return nil;
+        pngDatas = [self _encodeFrames:count withBlock:^CFDataRef(NSUInteger index) {
+            CGImageRef decoded = [self _newCGImageFromIndex:index decoded:YES];
+            if (!decoded) return NULL;
+            sizes[index] = CGSizeMake(CGImageGetWidth(decoded), CGImageGetHeight(decoded));
+            CFDataRef frameData = YYCGImageCreateEncodedData(decoded, YYImageTypePNG, 1);
             CFRelease(decoded);
-            return nil;
+            return frameData;
+        }];
+        NSMutableArray *pngSizes = [NSMutableArray new];
+        for (NSUInteger i = 0; i < count; i++) {
+            CGSize size = sizes[i];
+            [pngSizes addObject:[NSValue valueWithCGSize:size]];
+            if (canvasWidth < size.width) canvasWidth = size.width;
+            if (canvasHeight < size.height) canvasHeight = size.height;
+            if (size.width < 1 || size.height < 1) pngDatas = nil;
         }
-        CGContextDrawImage(context, CGRectMake(0, canvasHeight - firstFrameSize.height, firstFrameSize.width, firstFrameSize.height), decoded);
-        CFRelease(decoded);
-        CGImageRef extendedImage = CGBitmapContextCreateImage(context);
-        CFRelease(context);
-        if (!extendedImage) return nil;
-        CFDataRef frameData = YYCGImageCreateEncodedData(extendedImage, YYImageTypePNG, 1);
-        if (!frameData) {
+        free(sizes);
+        if (!pngDatas) return nil;
+        CGSize firstFrameSize = [(NSValue *)[pngSizes firstObject] CGSizeValue];
+        if (firstFrameSize.width < canvasWidth || firstFrameSize.height < canvasHeight) {
+            CGImageRef decoded = [self _newCGImageFromIndex:0 decoded:YES];
+            if (!decoded) return nil;
+            CGContextRef context = CGBitmapContextCreate(NULL, canvasWidth, canvasHeight, 8,
+                                                         0, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+            if (!context) {
+                CFRelease(decoded);
+                return nil;
+            }
+            CGContextDrawImage(context, CGRectMake(0, canvasHeight - firstFrameSize.height, firstFrameSize.width, firstFrameSize.height), decoded);
+            CFRelease(decoded);
+            CGImageRef extendedImage = CGBitmapContextCreateImage(context);
+            CFRelease(context);
+            if (!extendedImage) return nil;
+            CFDataRef frameData = YYCGImageCreateEncodedData(extendedImage, YYImageTypePNG, 1);
             CFRelease(extendedImage);
-            return nil;
+            if (!frameData) return nil;
+            pngDatas[0] = (__bridge id)(frameData);
+            CFRelease(frameData);
+            pngSizes[0] = [NSValue valueWithCGSize:CGSizeMake(canvasWidth, canvasHeight)];
+        }
+        
+        // each frame is drawn at the top-left of the cleared canvas
+        for (int i = 0; i < pngSizes.count; i++) {
+            CGSize size = [(NSValue *)pngSizes[i] CGSizeValue];
+            YYImageFrame *frame = [YYImageFrame new];
+            frame.index = i;
+            frame.width = size.width;
+            frame.height = size.height;
+            frame.offsetY = canvasHeight - size.height;
+            frame.duration = [(NSNumber *)_durations[i] doubleValue];
+            frame.dispose = YYImageDisposeBackground;
+            frame.blend = YYImageBlendNone;
+            [frames addObject:frame];
         }
-        pngDatas[0] = (__bridge id)(frameData);
-        CFRelease(frameData);
     }
     
     NSData *firstFrameData = pngDatas[0];
@@ -2577,32 +3483,10 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
         if (!insertBefore && chunk->fourcc == YY_FOUR_CC('I', 'D', 'A', 'T')) {
             insertBefore = YES;
             // insert acTL (APNG Control)
-            uint32_t acTL[5] = {0};
-            acTL[0] = yy_swap_endian_uint32(8); //length
-            acTL[1] = YY_FOUR_CC('a', 'c', 'T', 'L'); // fourcc
-            acTL[2] = yy_swap_endian_uint32((uint32_t)pngDatas.count); // num frames
-            acTL[3] = yy_swap_endian_uint32((uint32_t)_loopCount); // num plays
-            acTL[4] = yy_swap_endian_uint32((uint32_t)crc32(0, (const Bytef *)(acTL + 1), 12)); //crc32
-            [result appendBytes:acTL length:20];
+            [self _appendAPNGAnimationControlWithFrameCount:(uint32_t)pngDatas.count toData:result];
             
             // insert fcTL (first frame control)
-            yy_png_chunk_fcTL chunk_fcTL = {0};
-            chunk_fcTL.sequence_number = apngSequenceIndex;
-            chunk_fcTL.width = (uint32_t)firstFrameSize.width;
-            chunk_fcTL.height = (uint32_t)firstFrameSize.height;
-            yy_png_delay_to_fraction([(NSNumber *)_durations[0] doubleValue], &chunk_fcTL.delay_num, &chunk_fcTL.delay_den);
-            chunk_fcTL.delay_num = chunk_fcTL.delay_num;
-            chunk_fcTL.delay_den = chunk_fcTL.delay_den;
-            chunk_fcTL.dispose_op = YY_PNG_DISPOSE_OP_BACKGROUND;
-            chunk_fcTL.blend_op = YY_PNG_BLEND_OP_SOURCE;
-            
-            uint8_t fcTL[38] = {0};
-            *((uint32_t *)fcTL) = yy_swap_endian_uint32(26); //length
-            *((uint32_t *)(fcTL + 4)) = YY_FOUR_CC('f', 'c', 'T', 'L'); // fourcc
-            yy_png_chunk_fcTL_write(&chunk_fcTL, fcTL + 8);
-            *((uint32_t *)(fcTL + 34)) = yy_swap_endian_uint32((uint32_t)crc32(0, (const Bytef *)(fcTL + 4), 30));
-            [result appendBytes:fcTL length:38];
-            
+            [self _appendAPNGFrameControl:frames[0] sequence:apngSequenceIndex canvasHeight:canvasHeight toData:result];
             apngSequenceIndex++;
         }
         
@@ -2618,44 +3502,12 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
                     return nil;
                 }
                 
-                // insert fcTL (first frame control)
-                yy_png_chunk_fcTL chunk_fcTL = {0};
-                chunk_fcTL.sequence_number = apngSequenceIndex;
-                chunk_fcTL.width = frame->header.width;
-                chunk_fcTL.height = frame->header.height;
-                yy_png_delay_to_fraction([(NSNumber *)_durations[i] doubleValue], &chunk_fcTL.delay_num, &chunk_fcTL.delay_den);
-                chunk_fcTL.delay_num = chunk_fcTL.delay_num;
-                chunk_fcTL.delay_den = chunk_fcTL.delay_den;
-                chunk_fcTL.dispose_op = YY_PNG_DISPOSE_OP_BACKGROUND;
-                chunk_fcTL.blend_op = YY_PNG_BLEND_OP_SOURCE;
-                
-                uint8_t fcTL[38] = {0};
-                *((uint32_t *)fcTL) = yy_swap_endian_uint32(26); //length
-                *((uint32_t *)(fcTL + 4)) = YY_FOUR_CC('f', 'c', 'T', 'L'); // fourcc
-                yy_png_chunk_fcTL_write(&chunk_fcTL, fcTL + 8);
-                *((uint32_t *)(fcTL + 34)) = yy_swap_endian_uint32((uint32_t)crc32(0, (const Bytef *)(fcTL + 4), 30));
-                [result appendBytes:fcTL length:38];
-                
+                // insert fcTL (frame control)
+                [self _appendAPNGFrameControl:frames[i] sequence:apngSequenceIndex canvasHeight:canvasHeight toData:result];
                 apngSequenceIndex++;
                 
                 // insert fdAT (frame data)
-                for (int d = 0; d < frame->chunk_num; d++) {
-                    yy_png_chunk_info *dchunk = frame->chunks + d;
-                    if (dchunk->fourcc == YY_FOUR_CC('I', 'D', 'A', 'T')) {
-                        uint32_t length = yy_swap_endian_uint32(dchunk->length + 4);
-                        [result appendBytes:&length length:4]; //length
-                        uint32_t fourcc = YY_FOUR_CC('f', 'd', 'A', 'T');
-                        [result appendBytes:&fourcc length:4]; //fourcc
-                        uint32_t sq = yy_swap_endian_uint32(apngSequenceIndex);
-                        [result appendBytes:&sq length:4]; //data (sq)
-                        [result appendBytes:(((uint8_t *)frameData.bytes) + dchunk->offset + 8) length:dchunk->length]; //data
-                        uint8_t *bytes = ((uint8_t *)result.bytes) + result.length - dchunk->length - 8;
-                        uint32_t crc = yy_swap_endian_uint32((uint32_t)crc32(0, bytes, dchunk->length + 8));
-                        [result appendBytes:&crc length:4]; //crc
-                        
-                        apngSequenceIndex++;
-                    }
-                }
+                [self _appendAPNGFrameDataWithPNGData:frameData info:frame sequence:&apngSequenceIndex toData:result];
                 yy_png_info_release(frame);
             }
         }
@@ -2669,16 +3521,30 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
 - (NSData *)_encodeWebP {
 #if YYIMAGE_WEBP_ENABLED
     // encode webp
-    NSMutableArray *webpDatas = [NSMutableArray new];
-    for (NSUInteger i = 0; i < _images.count; i++) {
-        CGImageRef image = [self _newCGImageFromIndex:i decoded:NO];
-        if (!image) return nil;
-        CFDataRef frameData = YYCGImageCreateEncodedWebPData(image, _lossless, _quality, 4, YYImagePresetDefault);
-        CFRelease(image);
-        if (!frameData) return nil;
-        [webpDatas addObject:(__bridge id)frameData];
-        CFRelease(frameData);
+    NSArray *webpDatas = nil;
+    NSArray *frames = nil;
+    CGSize canvasSize = CGSizeZero;
+    BOOL lossless = _lossless;
+    CGFloat quality = _quality;
+    if (_optimizesFrames && _images.count > 1) {
+        frames = [self _optimizedFramesWithEvenOffset:YES canvasSize:&canvasSize]; // WebP stores offset / 2
+        if (!frames) return nil;
+        webpDatas = [self _encodeFrames:frames.count withBlock:^CFDataRef(NSUInteger index) {
+            return YYCGImageCreateEncodedWebPData(((YYImageFrame *)frames[index]).image.CGImage, lossless, quality, 4, YYImagePresetDefault);
+        }];
+        for (YYImageFrame *frame in frames) {
+            frame.image = nil;
+        }
+    } else {
+        webpDatas = [self _encodeFrames:_images.count withBlock:^CFDataRef(NSUInteger index) {
+            CGImageRef image = [self _newCGImageFromIndex:index decoded:NO];
+            if (!image) return NULL;
+            CFDataRef frameData = YYCGImageCreateEncodedWebPData(image, lossless, quality, 4, YYImagePresetDefault);
+            CFRelease(image);
+            return frameData;
+        }];
     }
+    if (!webpDatas) return nil;
     if (webpDatas.count == 1) {
         return webpDatas.firstObject;
     } else {
@@ -2695,6 +3561,13 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
             frame.id = WEBP_CHUNK_ANMF;
             frame.dispose_method = WEBP_MUX_DISPOSE_BACKGROUND;
             frame.blend_method = WEBP_MUX_NO_BLEND;
+            if (frames) {
+                YYImageFrame *optimizedFrame = frames[i];
+                frame.x_offset = (int)optimizedFrame.offsetX;
+                frame.y_offset = (int)(canvasSize.height - optimizedFrame.offsetY - optimizedFrame.height);
+                frame.dispose_method = optimizedFrame.dispose == YYImageDisposeBackground ? WEBP_MUX_DISPOSE_BACKGROUND : WEBP_MUX_DISPOSE_NONE;
+                frame.blend_method = optimizedFrame.blend == YYImageBlendOver ? WEBP_MUX_BLEND : WEBP_MUX_NO_BLEND;
+            }
             if (WebPMuxPushFrame(mux, &frame, 0) != WEBP_MUX_OK) {
                 WebPMuxDelete(mux);
                 return nil;
@@ -2721,6 +3594,227 @@ CGImageRef YYCGImageCreateWithWebPData(CFDataRef webpData,
     return nil;
 #endif
 }
+- (BOOL)beginStreamToFile:(NSString *)path {
+    if (_stream || _images.count > 0 || path.length == 0) return NO;
+    if (_type != YYImageTypePNG && _type != YYImageTypeWebP) return NO;
+    FILE *file = fopen(path.fileSystemRepresentation, "wb");
+    if (!file) return NO;
+    _stream = file;
+    _streamPath = path.copy;
+    _streamFailed = NO;
+    _streamFrameCount = 0;
+    _streamSequence = 0;
+    _streamControlOffset = 0;
+    _streamHasAlpha = NO;
+    return YES;
+}
+
+- (BOOL)finishStream {
+    if (!_stream) return NO;
+    BOOL suc = !_streamFailed && _streamPendingFrame;
+    if (suc) suc = [self _streamWriteFrame:_streamPendingFrame data:_streamPendingData];
+    if (suc) suc = _type == YYImageTypePNG ? [self _streamFinishAPNG] : [self _streamFinishWebP];
+    if (fclose(_stream) != 0) suc = NO;
+    _stream = NULL;
+    if (_streamCanvas) CFRelease(_streamCanvas);
+    _streamCanvas = NULL;
+    if (_streamPrevious) free(_streamPrevious);
+    _streamPrevious = NULL;
+    _streamPendingFrame = nil;
+    _streamPendingData = nil;
+    if (!suc) [[NSFileManager defaultManager] removeItemAtPath:_streamPath error:NULL];
+    _streamPath = nil;
+    return suc;
+}
+
+- (void)_streamAddImage:(id)imageSrc duration:(NSTimeInterval)duration {
+    if (_streamFailed) return;
+    @autoreleasepool {
+        CGImageRef imageRef = [self _newCGImageFromSource:imageSrc decoded:NO];
+        if (!imageRef) {
+            _streamFailed = YES;
+            return;
+        }
+        if (!_streamCanvas) { // the canvas size is the first frame's size
+            size_t width = CGImageGetWidth(imageRef), height = CGImageGetHeight(imageRef);
+            _streamCanvas = CGBitmapContextCreate(NULL, width, height, 8, width * 4, YYCGColorSpaceGetDeviceRGB(), kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+            _streamPrevious = malloc(width * height * 4);
+            if (!_streamCanvas || !_streamPrevious) {
+                CFRelease(imageRef);
+                _streamFailed = YES;
+                return;
+            }
+        }
+        
+        // the pending frame's dispose method is decided by this frame
+        YYImageFrame *frame = [self _optimizedFrameWithImage:imageRef
+                                                      canvas:_streamCanvas
+                                                    previous:_streamPrevious
+                                               previousFrame:(_optimizesFrames ? _streamPendingFrame : nil)
+                                                  evenOffset:_type == YYImageTypeWebP];
+        CFRelease(imageRef);
+        if (!frame) {
+            _streamFailed = YES;
+            return;
+        }
+        frame.index = _streamFrameCount + (_streamPendingFrame ? 1 : 0);
+        frame.duration = duration;
+        CFDataRef frameData = NULL;
+        if (_type == YYImageTypePNG) {
+            frameData = YYCGImageCreateEncodedData(frame.image.CGImage, YYImageTypePNG, 1);
+        } else {
+            frameData = YYCGImageCreateEncodedWebPData(frame.image.CGImage, _lossless, _quality, 4, YYImagePresetDefault);
+        }
+        frame.image = nil;
+        if (!frameData) {
+            _streamFailed = YES;
+            return;
+        }
+        
+        if (_streamPendingFrame && ![self _streamWriteFrame:_streamPendingFrame data:_streamPendingData]) {
+            CFRelease(frameData);
+            _streamFailed = YES;
+            return;
+        }
+        _streamPendingFrame = frame;
+        _streamPendingData = (__bridge_transfer NSData *)frameData;
+    }
+}
+
+- (BOOL)_streamWriteFrame:(YYImageFrame *)frame data:(NSData *)frameData {
+    NSMutableData *data = [NSMutableData new];
+    BOOL suc = NO;
+    if (_type == YYImageTypePNG) {
+        suc = [self _streamAppendAPNGFrame:frame pngData:frameData toData:data];
+    } else {
+        suc = [self _streamAppendWebPFrame:frame webpData:frameData toData:data];
+    }
+    if (!suc) return NO;
+    if (fwrite(data.bytes, 1, data.length, _stream) != data.length) return NO;
+    _streamFrameCount++;
+    return YES;
+}
+
+- (BOOL)_streamAppendAPNGFrame:(YYImageFrame *)frame pngData:(NSData *)pngData toData:(NSMutableData *)data {
+    yy_png_info *info = yy_png_info_create(pngData.bytes, (uint32_t)pngData.length);
+    if (!info) return NO;
+    size_t canvasHeight = CGBitmapContextGetHeight(_streamCanvas);
+    if (_streamFrameCount == 0) {
+        // the first frame is the default image: header, chunks before `IDAT`,
+        // acTL (the frame count is written when finished), fcTL, IDAT
+        uint32_t png_header[2];
+        png_header[0] = YY_FOUR_CC(0x89, 0x50, 0x4E, 0x47);
+        png_header[1] = YY_FOUR_CC(0x0D, 0x0A, 0x1A, 0x0A);
+        [data appendBytes:png_header length:8];
+        uint32_t i = 0;
+        for (; i < info->chunk_num; i++) {
+            yy_png_chunk_info *chunk = info->chunks + i;
+            if (chunk->fourcc == YY_FOUR_CC('I', 'D', 'A', 'T')) break;
+            [data appendBytes:((uint8_t *)pngData.bytes) + chunk->offset length:chunk->length + 12];
+        }
+        _streamControlOffset = data.length;
+        [self _appendAPNGAnimationControlWithFrameCount:0 toData:data];
+        [self _appendAPNGFrameControl:frame sequence:_streamSequence canvasHeight:canvasHeight toData:data];
+        _streamSequence++;
+        for (; i < info->chunk_num; i++) {
+            yy_png_chunk_info *chunk = info->chunks + i;
+            if (chunk->fourcc != YY_FOUR_CC('I', 'D', 'A', 'T')) break;
+            [data appendBytes:((uint8_t *)pngData.bytes) + chunk->offset length:chunk->length + 12];
+        }
+    } else {
+        [self _appendAPNGFrameControl:frame sequence:_streamSequence canvasHeight:canvasHeight toData:data];
+        _streamSequence++;
+        [self _appendAPNGFrameDataWithPNGData:pngData info:info sequence:&_streamSequence toData:data];
+    }
+    yy_png_info_release(info);
+    return YES;
+}
+
+- (BOOL)_streamFinishAPNG {
+    uint8_t IEND[12] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+    if (fwrite(IEND, 1, 12, _stream) != 12) return NO;
+    NSMutableData *acTL = [NSMutableData new];
+    [self _appendAPNGAnimationControlWithFrameCount:_streamFrameCount toData:acTL];
+    if (fseeko(_stream, _streamControlOffset, SEEK_SET) != 0) return NO;
+    return fwrite(acTL.bytes, 1, acTL.length, _stream) == acTL.length;
+}
+
+- (BOOL)_streamAppendWebPFrame:(YYImageFrame *)frame webpData:(NSData *)webpData toData:(NSMutableData *)data {
+#if YYIMAGE_WEBP_ENABLED
+    // copy the image chunks (ALPH, VP8, VP8L) of the encoded WebP file into an ANMF chunk
+    const uint8_t *bytes = webpData.bytes;
+    size_t length = webpData.length;
+    if (length < 12 || memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WEBP", 4) != 0) return NO;
+    NSMutableData *payload = [NSMutableData new];
+    for (size_t offset = 12; offset + 8 <= length; ) {
+        const uint8_t *chunk = bytes + offset;
+        size_t size = YYImageReadLittleEndian(chunk + 4, 4);
+        if (size > length - offset - 8) return NO;
+        size_t chunkLength = MIN(8 + size + (size & 1), length - offset);
+        if (memcmp(chunk, "ALPH", 4) == 0 || memcmp(chunk, "VP8 ", 4) == 0 || memcmp(chunk, "VP8L", 4) == 0) {
+            [payload appendBytes:chunk length:chunkLength];
+            if (chunkLength < 8 + size + (size & 1)) [payload increaseLengthBy:1]; // padding
+            if (memcmp(chunk, "ALPH", 4) == 0) _streamHasAlpha = YES;
+            if (memcmp(chunk, "VP8L", 4) == 0 && size >= 5 && (chunk[12] & 0x10)) _streamHasAlpha = YES; // alpha_is_used
+        }
+        offset += chunkLength;
+    }
+    if (payload.length == 0) return NO;
+    
+    uint8_t header[24];
+    if (_streamFrameCount == 0) {
+        // RIFF header (the size is written when finished), VP8X, ANIM
+        memcpy(header, "RIFF", 4);
+        YYImageWriteLittleEndian(header + 4, 0, 4);
+        memcpy(header + 8, "WEBP", 4);
+        [data appendBytes:header length:12];
+        
+        memcpy(header, "VP8X", 4);
+        YYImageWriteLittleEndian(header + 4, 10, 4);
+        YYImageWriteLittleEndian(header + 8, 0x02, 4); // animation flag, the alpha flag is written when finished
+        YYImageWriteLittleEndian(header + 12, (uint32_t)CGBitmapContextGetWidth(_streamCanvas) - 1, 3);
+        YYImageWriteLittleEndian(header + 15, (uint32_t)CGBitmapContextGetHeight(_streamCanvas) - 1, 3);
+        [data appendBytes:header length:18];
+        
+        memcpy(header, "ANIM", 4);
+        YYImageWriteLittleEndian(header + 4, 6, 4);
+        YYImageWriteLittleEndian(header + 8, 0, 4); // background color
+        YYImageWriteLittleEndian(header + 12, (uint32_t)MIN(_loopCount, 0xFFFF), 2);
+        [data appendBytes:header length:14];
+    }
+    
+    size_t canvasHeight = CGBitmapContextGetHeight(_streamCanvas);
+    uint32_t duration = (uint32_t)MIN(frame.duration * 1000.0, 0xFFFFFF);
+    uint8_t flags = 0;
+    if (frame.blend != YYImageBlendOver) flags |= 0x02; // do not blend
+    if (frame.dispose == YYImageDisposeBackground) flags |= 0x01;
+    memcpy(header, "ANMF", 4);
+    YYImageWriteLittleEndian(header + 4, (uint32_t)(16 + payload.length), 4);
+    YYImageWriteLittleEndian(header + 8, (uint32_t)frame.offsetX / 2, 3);
+    YYImageWriteLittleEndian(header + 11, (uint32_t)(canvasHeight - frame.offsetY - frame.height) / 2, 3);
+    YYImageWriteLittleEndian(header + 14, (uint32_t)frame.width - 1, 3);
+    YYImageWriteLittleEndian(header + 17, (uint32_t)frame.height - 1, 3);
+    YYImageWriteLittleEndian(header + 20, duration, 3);
+    header[23] = flags;
+    [data appendBytes:header length:24];
+    [data appendData:payload];
+    return YES;
+#else
+    return NO;
+#endif
+}
+
+- (BOOL)_streamFinishWebP {
+    off_t length = ftello(_stream);
+    if (length < 30 || length - 8 > UINT32_MAX) return NO;
+    uint8_t value[4];
+    YYImageWriteLittleEndian(value, (uint32_t)(length - 8), 4);
+    if (fseeko(_stream, 4, SEEK_SET) != 0 || fwrite(value, 1, 4, _stream) != 4) return NO;
+    value[0] = 0x02 | (_streamHasAlpha ? 0x10 : 0); // VP8X flags
+    if (fseeko(_stream, 20, SEEK_SET) != 0 || fwrite(value, 1, 1, _stream) != 1) return NO;
+    return YES;
+}
+
 - (NSData *)encode {
     if (_images.count == 0) return nil;
     
@@ -0,0 +1,333 @@
+//
+//  YYImageGIF.c
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/18.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#include "YYImageGIF.h"
+#include <stdlib.h>
+#include <string.h>
+
+static inline uint16_t yy_gif_read_uint16(const uint8_t *data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+void yy_gif_info_release(yy_gif_info *info) {
+    if (info) {
+        if (info->frames) free(info->frames);
+        free(info);
+    }
+}
+
+/**
+ Scan the data sub-blocks from an offset.
+ 
+ @param data    gif data
+ @param length  the data's length in bytes
+ @param offset  input: the offset of a sub-block; output: the offset after the
+    last complete sub-block (or the terminator if `terminated`)
+ @param terminated output: whether the terminator (0x00) is found
+ */
+static void yy_gif_scan_sub_blocks(const uint8_t *data, uint32_t length, uint32_t *offset, bool *terminated) {
+    uint32_t p = *offset;
+    *terminated = false;
+    while (p < length) {
+        uint8_t size = data[p];
+        if (size == 0) {
+            p++;
+            *terminated = true;
+            break;
+        }
+        if ((uint64_t)p + 1 + size > length) break;
+        p += 1 + size;
+    }
+    *offset = p;
+}
+
+bool yy_gif_info_update(yy_gif_info *info, const uint8_t *data, uint32_t length) {
+    if (!info->header_parsed) {
+        if (length < 13) return true; // wait for more data
+        if (memcmp(data, "GIF87a", 6) != 0 && memcmp(data, "GIF89a", 6) != 0) return false;
+        uint8_t flags = data[10];
+        uint32_t palette_size = (flags & 0x80) ? (2 << (flags & 0x07)) : 0;
+        if (13 + palette_size * 3 > length) return true;
+        info->width = yy_gif_read_uint16(data + 6);
+        info->height = yy_gif_read_uint16(data + 8);
+        if (info->width == 0 || info->height == 0) return false;
+        info->palette_offset = 13;
+        info->palette_size = palette_size;
+        info->loop_num = 0; // loop forever if there's no loop extension
+        info->offset = 13 + palette_size * 3;
+        info->header_parsed = true;
+    }
+    
+    while (!info->finished) {
+        if (info->in_frame_data) {
+            yy_gif_frame_info *frame = info->frames + info->frame_num - 1;
+            bool terminated = false;
+            yy_gif_scan_sub_blocks(data, length, &info->offset, &terminated);
+            frame->data_end = terminated ? info->offset - 1 : info->offset;
+            if (!terminated) return true; // wait for more data
+            frame->complete = true;
+            info->in_frame_data = false;
+            continue;
+        }
+    
+        if (info->offset >= length) return true;
+        uint8_t introducer = data[info->offset];
+        if (introducer == 0x3B) { // trailer
+            info->finished = true;
+        } else if (introducer == 0x21) { // extension
+            if (info->offset + 2 > length) return true;
+            uint8_t label = data[info->offset + 1];
+            uint32_t end = info->offset + 2;
+            bool terminated = false;
+            yy_gif_scan_sub_blocks(data, length, &end, &terminated);
+            if (!terminated) return true; // parse the whole extension later
+    
+            const uint8_t *block = data + info->offset + 2; // first sub-block
+            if (label == 0xF9 && block[0] >= 4) { // graphic control
+                yy_gif_frame_info *control = &info->control;
+                memset(control, 0, sizeof(yy_gif_frame_info));
+                control->dispose = (block[1] >> 2) & 0x07;
+                control->has_transparency = (block[1] & 0x01) != 0;
+                control->delay = yy_gif_read_uint16(block + 2);
+                control->transparent_index = block[4];
+                info->control_valid = true;
+            } else if (label == 0xFF && block[0] == 11 &&
+                       (memcmp(block + 1, "NETSCAPE2.0", 11) == 0 || memcmp(block + 1, "ANIMEXTS1.0", 11) == 0)) {
+                const uint8_t *sub = block + 12;
+                if (sub < data + end && sub[0] >= 3 && sub[1] == 0x01) {
+                    info->loop_num = yy_gif_read_uint16(sub + 2);
+                }
+            }
+            info->offset = end;
+        } else if (introducer == 0x2C) { // image
+            if (info->offset + 10 > length) return true;
+            const uint8_t *desc = data + info->offset + 1;
+            uint8_t flags = desc[8];
+            uint32_t palette_size = (flags & 0x80) ? (2 << (flags & 0x07)) : 0;
+            uint32_t palette_offset = info->offset + 10;
+            if (palette_offset + palette_size * 3 + 1 > length) return true;
+    
+            if (info->frame_num == info->frame_capacity) {
+                uint32_t capacity = info->frame_capacity ? info->frame_capacity * 2 : 16;
+                yy_gif_frame_info *frames = realloc(info->frames, sizeof(yy_gif_frame_info) * capacity);
+                if (!frames) {
+                    info->finished = true;
+                    return false;
+                }
+                info->frames = frames;
+                info->frame_capacity = capacity;
+            }
+            yy_gif_frame_info *frame = info->frames + info->frame_num;
+            if (info->control_valid) {
+                *frame = info->control;
+            } else {
+                memset(frame, 0, sizeof(yy_gif_frame_info));
+            }
+            info->control_valid = false;
+            frame->x = yy_gif_read_uint16(desc);
+            frame->y = yy_gif_read_uint16(desc + 2);
+            frame->width = yy_gif_read_uint16(desc + 4);
+            frame->height = yy_gif_read_uint16(desc + 6);
+            frame->interlaced = (flags & 0x40) != 0;
+            if (palette_size) {
+                frame->palette_offset = palette_offset;
+                frame->palette_size = palette_size;
+            } else {
+                frame->palette_offset = info->palette_offset;
+                frame->palette_size = info->palette_size;
+            }
+            frame->lzw_code_size = data[palette_offset + palette_size * 3];
+            frame->data_offset = palette_offset + palette_size * 3 + 1;
+            frame->data_end = frame->data_offset;
+            frame->complete = false;
+            if (frame->width == 0 || frame->height == 0 ||
+                (uint32_t)frame->x + frame->width > info->width ||
+                (uint32_t)frame->y + frame->height > info->height ||
+                frame->lzw_code_size < 1 || frame->lzw_code_size >= YY_GIF_MAX_CODE_SIZE) { // invalid image
+                info->finished = true;
+                info->invalid = true;
+                break;
+            }
+            info->frame_num++;
+            info->offset = frame->data_offset;
+            info->in_frame_data = true;
+        } else { // invalid block, ignore the remaining data
+            info->finished = true;
+            info->invalid = true;
+        }
+    }
+    return true;
+}
+
+yy_gif_info *yy_gif_info_create(const uint8_t *data, uint32_t length) {
+    yy_gif_info *info = calloc(1, sizeof(yy_gif_info));
+    if (!info) return NULL;
+    if (!yy_gif_info_update(info, data, length)) {
+        yy_gif_info_release(info);
+        return NULL;
+    }
+    return info;
+}
+
+/**
+ Decode the LZW compressed color indexes of a frame.
+ 
+ @param data    gif file data
+ @param frame   frame info
+ @param indexes output buffer, width * height bytes, in the order of the stored rows
+ @param count   the buffer size
+ @return The count of decoded indexes, it may be less than `count` if the data
+ is incomplete or broken.
+ */
+static uint32_t yy_gif_lzw_decode(const uint8_t *data, const yy_gif_frame_info *frame, uint8_t *indexes, uint32_t count) {
+    uint16_t prefix[1 << YY_GIF_MAX_CODE_SIZE];
+    uint8_t suffix[1 << YY_GIF_MAX_CODE_SIZE];
+    uint8_t stack[(1 << YY_GIF_MAX_CODE_SIZE) + 1];
+    
+    uint32_t clear_code = 1 << frame->lzw_code_size;
+    uint32_t end_code = clear_code + 1;
+    uint32_t next_code = clear_code + 2;
+    uint32_t code_size = frame->lzw_code_size + 1;
+    uint32_t code_mask = (1 << code_size) - 1;
+    int32_t old_code = -1;
+    uint8_t first_index = 0;
+    
+    uint32_t bits = 0, bit_count = 0, decoded = 0;
+    uint32_t p = frame->data_offset;
+    uint32_t block_end = p; // end of current sub-block
+    
+    for (uint32_t i = 0; i < clear_code; i++) {
+        prefix[i] = 0;
+        suffix[i] = (uint8_t)i;
+    }
+    
+    while (decoded < count) {
+        // read a code
+        while (bit_count < code_size) {
+            if (p == block_end) { // next sub-block
+                if (p >= frame->data_end) return decoded;
+                uint8_t size = data[p];
+                if (size == 0) return decoded;
+                p++;
+                block_end = p + size;
+            }
+            bits |= (uint32_t)data[p++] << bit_count;
+            bit_count += 8;
+        }
+        uint32_t code = bits & code_mask;
+        bits >>= code_size;
+        bit_count -= code_size;
+    
+        if (code == clear_code) {
+            next_code = clear_code + 2;
+            code_size = frame->lzw_code_size + 1;
+            code_mask = (1 << code_size) - 1;
+            old_code = -1;
+            continue;
+        }
+        if (code == end_code) break;
+        if (old_code < 0) { // first code after clear
+            if (code > clear_code) break; // invalid
+            indexes[decoded++] = (uint8_t)code;
+            old_code = code;
+            first_index = (uint8_t)code;
+            continue;
+        }
+        if (code > next_code) break; // invalid
+    
+        uint32_t in_code = code;
+        uint32_t sp = 0;
+        if (code == next_code) { // KwKwK
+            stack[sp++] = first_index;
+            code = old_code;
+        }
+        while (code > clear_code) {
+            stack[sp++] = suffix[code];
+            code = prefix[code];
+        }
+        first_index = suffix[code];
+        stack[sp++] = first_index;
+        while (sp > 0 && decoded < count) {
+            indexes[decoded++] = stack[--sp];
+        }
+    
+        if (next_code < (1 << YY_GIF_MAX_CODE_SIZE)) {
+            prefix[next_code] = old_code;
+            suffix[next_code] = first_index;
+            next_code++;
+            if (next_code == (1u << code_size) && code_size < YY_GIF_MAX_CODE_SIZE) {
+                code_size++;
+                code_mask = (1 << code_size) - 1;
+            }
+        }
+        old_code = in_code;
+    }
+    return decoded;
+}
+
+uint8_t *yy_gif_copy_frame_bitmap_at_index(const uint8_t *data,
+                                           const yy_gif_info *info,
+                                           const uint32_t index,
+                                           size_t *bytes_per_row) {
+    if (index >= info->frame_num) return NULL;
+    const yy_gif_frame_info *frame = info->frames + index;
+    uint32_t width = frame->width, height = frame->height;
+    uint32_t count = width * height;
+    size_t stride = ((size_t)width * 4 + 31) & ~(size_t)31;
+    
+    uint8_t *indexes = malloc(count);
+    if (!indexes) return NULL;
+    uint32_t decoded = yy_gif_lzw_decode(data, frame, indexes, count);
+    
+    uint32_t colors[256] = {0}; // transparent black for the unused indexes
+    for (uint32_t i = 0; i < frame->palette_size && i < 256; i++) {
+        const uint8_t *rgb = data + frame->palette_offset + i * 3;
+        colors[i] = 0xFF000000 | ((uint32_t)rgb[0] << 16) | ((uint32_t)rgb[1] << 8) | rgb[2];
+    }
+    if (frame->has_transparency) colors[frame->transparent_index] = 0;
+    
+    uint8_t *bitmap = calloc(1, stride * height);
+    if (!bitmap) {
+        free(indexes);
+        return NULL;
+    }
+    
+    // interlaced rows are stored in 4 passes: every 8th row from 0, every 8th row
+    // from 4, every 4th row from 2, every 2nd row from 1.
+    static const uint32_t pass_start[4] = {0, 4, 2, 1};
+    static const uint32_t pass_step[4] = {8, 8, 4, 2};
+    uint32_t pass = 0, y = 0;
+    for (uint32_t row = 0; row < height && row * width < decoded; row++) {
+        if (frame->interlaced) {
+            if (row == 0) {
+                y = 0;
+            } else {
+                y += pass_step[pass];
+                while (y >= height && pass < 3) {
+                    pass++;
+                    y = pass_start[pass];
+                }
+            }
+        } else {
+            y = row;
+        }
+        const uint8_t *src = indexes + row * width;
+        uint32_t *dest = (uint32_t *)(bitmap + y * stride);
+        uint32_t row_count = decoded - row * width;
+        if (row_count > width) row_count = width;
+        for (uint32_t x = 0; x < row_count; x++) {
+            dest[x] = colors[src[x]];
+        }
+    }
+    free(indexes);
+    *bytes_per_row = stride;
+    return bitmap;
+}
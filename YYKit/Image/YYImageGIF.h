@@ -0,0 +1,165 @@
+//
+//  YYImageGIF.h
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/18.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#ifndef YYImageGIF_h
+#define YYImageGIF_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ GIF spec: https://www.w3.org/Graphics/GIF/spec-gif89a.txt
+
+ ===============================================================================
+ GIF format:
+ header (6): "GIF87a" or "GIF89a"
+ logical screen descriptor (7)
+ global color table (optional)
+ block, block, block, ...
+ trailer (1): 0x3B
+
+ ===============================================================================
+ logical screen descriptor:
+ width              (2) canvas width, little endian
+ height             (2) canvas height, little endian
+ flags              (1) 1<<7 (global color table), 0x07 (table size: 2<<n entries)
+ background index   (1) background color index
+ aspect ratio       (1) ignored
+
+ color table: entries * 3 bytes (r, g, b)
+
+ ===============================================================================
+ block:
+ 0x21 (extension): label (1), data sub-blocks
+ 0x2C (image): image descriptor (9), local color table (optional),
+               LZW minimum code size (1), data sub-blocks
+
+ data sub-blocks: size (1), data (size), size (1), data (size), ..., 0x00
+
+ graphic control extension (label 0xF9), applies to the next image, 4 bytes
+ flags              (1) 0x1C (disposal method), 1<<0 (transparent color)
+ delay              (2) delay time in 1/100 second
+ transparent index  (1) transparent color index
+
+ application extension (label 0xFF), "NETSCAPE2.0" or "ANIMEXTS1.0"
+ sub-block (3): 0x01, loop count (2), 0 indicates infinite looping
+
+ image descriptor:
+ left, top          (2, 2) position in canvas (top-left origin)
+ width, height      (2, 2) size of the image
+ flags              (1) 1<<7 (local color table), 1<<6 (interlaced), 0x07 (table size)
+
+ ===============================================================================
+ `disposal method` specifies what to be done after the image is displayed:
+ 0: not specified, 1: do not dispose (NONE)
+ 2: restore to background (BACKGROUND, clear to transparent as the browsers do)
+ 3: restore to previous (PREVIOUS)
+ */
+
+#define YY_GIF_MAX_CODE_SIZE 12
+
+typedef enum {
+    YY_GIF_DISPOSE_NONE = 0,
+    YY_GIF_DISPOSE_BACKGROUND = 2,
+    YY_GIF_DISPOSE_PREVIOUS = 3,
+} yy_gif_dispose_method;
+
+typedef struct {
+    uint16_t x;                 ///< x position in canvas (top-left origin)
+    uint16_t y;                 ///< y position in canvas (top-left origin)
+    uint16_t width;             ///< image width
+    uint16_t height;            ///< image height
+    uint16_t delay;             ///< delay time in 1/100 second
+    uint8_t dispose;            ///< see yy_gif_dispose_method
+    bool has_transparency;      ///< whether `transparent_index` is used
+    uint8_t transparent_index;  ///< transparent color index
+    bool interlaced;            ///< whether the rows are interlaced
+    uint32_t palette_offset;    ///< color table offset in data
+    uint32_t palette_size;      ///< color table entry count, 0 if no color table
+    uint8_t lzw_code_size;      ///< LZW minimum code size
+    uint32_t data_offset;       ///< offset of the first data sub-block
+    uint32_t data_end;          ///< offset after the last complete data sub-block
+    bool complete;              ///< whether all the data sub-blocks are available
+} yy_gif_frame_info;
+
+typedef struct {
+    uint16_t width;             ///< canvas width
+    uint16_t height;            ///< canvas height
+    uint32_t palette_offset;    ///< global color table offset in data
+    uint32_t palette_size;      ///< global color table entry count, 0 if no global color table
+    uint32_t loop_num;          ///< loop count, 0 indicates infinite looping
+    yy_gif_frame_info *frames;  ///< frame index
+    uint32_t frame_num;         ///< frame count
+    uint32_t frame_capacity;    ///< frame buffer capacity
+    
+    // parser state, for incremental data
+    bool header_parsed;         ///< whether the header and global color table are parsed
+    bool finished;              ///< trailer is found, or the data is invalid
+    bool invalid;               ///< an invalid block is found, the remaining data is ignored
+    bool in_frame_data;         ///< parsing the data sub-blocks of the last frame
+    uint32_t offset;            ///< offset of the next block (or sub-block) to parse
+    bool control_valid;         ///< a graphic control extension is waiting for the next image
+    yy_gif_frame_info control;  ///< the graphic control of the next image
+} yy_gif_info;
+
+/**
+ Create a gif info with the available data of a gif file.
+ 
+ @param data   gif file data.
+ @param length the data's length in bytes.
+ @return A gif info object, you may call yy_gif_info_update() with more data,
+ and call yy_gif_info_release() to release it. Returns NULL if an error occurs.
+ */
+yy_gif_info *yy_gif_info_create(const uint8_t *data, uint32_t length);
+
+/**
+ Parse the new data of a gif file, the frames which are found are appended to
+ the info's frame index. It can be called again with more data (the previous
+ data should be the prefix of the new data).
+ 
+ @param info   gif info
+ @param data   gif file data
+ @param length the data's length in bytes
+ @return false if the data is not a valid gif file (the header is invalid or no memory).
+ */
+bool yy_gif_info_update(yy_gif_info *info, const uint8_t *data, uint32_t length);
+
+/// Release a gif info which is created by yy_gif_info_create().
+void yy_gif_info_release(yy_gif_info *info);
+
+/**
+ Decode a frame of a gif file to a bitmap, only the frame's rect (not the whole
+ canvas) is decoded. The pixels which are transparent or not available (the data
+ is incomplete) are filled with 0.
+ 
+ @param data  gif file data
+ @param info  gif info
+ @param index frame index (zero-based)
+ @param bytes_per_row output, the bytes per row of the bitmap
+ @return A frame bitmap (frame.width x frame.height, 32 bits per pixel, premultiplied
+ alpha first in host byte order, as kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst),
+ call free() to release the bitmap. Returns NULL if an error occurs.
+ */
+uint8_t *yy_gif_copy_frame_bitmap_at_index(const uint8_t *data,
+                                           const yy_gif_info *info,
+                                           const uint32_t index,
+                                           size_t *bytes_per_row);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YYImageGIF_h */
@@ -0,0 +1,129 @@
+//
+//  YYImagePipeline.h
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/18.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <UIKit/UIKit.h>
+
+#if __has_include(<YYKit/YYKit.h>)
+#import <YYKit/YYWebImageManager.h>
+#else
+#import "YYWebImageManager.h"
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ YYImagePipeline records a chain of image operations, and executes them with one
+ bitmap buffer.
+ 
+ @discussion Chaining the methods in `UIImage+YYAdd` (such as resize, round corner
+ and tint) creates a bitmap and an image for each step. The pipeline merges all the
+ geometry operations into a single drawing of the source image (the later resizes
+ and clips are applied as transforms and clip paths), and merges the color operations
+ (tint, saturation) into one color matrix, which is applied to the pixels in a single
+ pass (with NEON/SSE2 when available).
+ 
+ The result is same as calling the `UIImage+YYAdd` methods in order, except for
+ some rounding differences.
+ 
+ Sample Code:
+ 
+     YYImagePipeline *pipeline = [YYImagePipeline new];
+     [pipeline addResizeToSize:CGSizeMake(40, 40) contentMode:UIViewContentModeScaleAspectFill];
+     [pipeline addRoundCornerRadius:20];
+     [pipeline addTintColor:[UIColor grayColor]];
+    
+     [imageView setImageWithURL:url
+                    placeholder:nil
+                        options:kNilOptions
+                       progress:nil
+                      transform:pipeline.transformBlock
+                     completion:nil];
+ 
+ The operations should be added before the pipeline is used, the `processImage:`
+ method is thread-safe if no operation is being added.
+ */
+@interface YYImagePipeline : NSObject <NSCopying>
+
+/** The count of operations. */
+@property (nonatomic, readonly) NSUInteger operationCount;
+
+/**
+ Adds an operation to resize the image, same as `-[UIImage imageByResizeToSize:contentMode:]`.
+ 
+ @param size        The new size to be scaled, values should be positive.
+ @param contentMode The content mode for image content.
+ */
+- (void)addResizeToSize:(CGSize)size contentMode:(UIViewContentMode)contentMode;
+
+/**
+ Adds an operation to round the corners, same as `-[UIImage imageByRoundCornerRadius:]`.
+ 
+ @param radius The radius of each corner oval.
+ */
+- (void)addRoundCornerRadius:(CGFloat)radius;
+
+/**
+ Adds an operation to round the corners, same as
+ `-[UIImage imageByRoundCornerRadius:corners:borderWidth:borderColor:borderLineJoin:]`.
+ 
+ @param radius         The radius of each corner oval.
+ @param corners        The corners to be rounded.
+ @param borderWidth    The inset border line width.
+ @param borderColor    The border stroke color. nil means clear color.
+ @param borderLineJoin The border line join.
+ */
+- (void)addRoundCornerRadius:(CGFloat)radius
+                     corners:(UIRectCorner)corners
+                 borderWidth:(CGFloat)borderWidth
+                 borderColor:(nullable UIColor *)borderColor
+              borderLineJoin:(CGLineJoin)borderLineJoin;
+
+/**
+ Adds an operation to tint the image with the alpha channel, same as
+ `-[UIImage imageByTintColor:]`.
+ 
+ @param color The tint color.
+ */
+- (void)addTintColor:(UIColor *)color;
+
+/**
+ Adds an operation to adjust the saturation.
+ 
+ @param saturation A value of 1.0 produces no change, values less than 1.0 desaturate
+    the image, 0 means gray scale.
+ */
+- (void)addSaturation:(CGFloat)saturation;
+
+/**
+ Adds an operation to convert the image to gray scale, same as `-[UIImage imageByGrayscale]`.
+ */
+- (void)addGrayscale;
+
+/**
+ Executes the operations with an image.
+ 
+ @param image The source image.
+ @return A new image, or nil if an error occurs. It returns the source image if
+    there's no operation.
+ */
+- (nullable UIImage *)processImage:(UIImage *)image;
+
+/**
+ A transform block which executes a copy of current operations, it can be used
+ as the `transform` parameter of `YYWebImageManager` and the web image categories.
+ The same block is returned until an operation is added, so the requests with it
+ can share a download.
+ */
+@property (nonatomic, readonly) YYWebImageTransformBlock transformBlock;
+
+@end
+
+NS_ASSUME_NONNULL_END
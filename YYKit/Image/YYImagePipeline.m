@@ -0,0 +1,391 @@
+//
+//  YYImagePipeline.m
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/18.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "YYImagePipeline.h"
+#import "YYCGUtilities.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#import <arm_neon.h>
+#define YY_PIPELINE_NEON 1
+#elif defined(__SSE2__)
+#import <emmintrin.h>
+#define YY_PIPELINE_SSE2 1
+#endif
+
+/// Color matrix in (R, G, B, A) order: out[i] = sum(m[i][j] * in[j]), for premultiplied color.
+typedef struct {
+    float m[4][4];
+} YYImageColorMatrix;
+
+static const YYImageColorMatrix YYImageColorMatrixIdentity = {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+
+/// Returns a matrix which applies `a` then `b`.
+static YYImageColorMatrix YYImageColorMatrixConcat(YYImageColorMatrix a, YYImageColorMatrix b) {
+    YYImageColorMatrix r;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            r.m[i][j] = b.m[i][0] * a.m[0][j] + b.m[i][1] * a.m[1][j] + b.m[i][2] * a.m[2][j] + b.m[i][3] * a.m[3][j];
+        }
+    }
+    return r;
+}
+
+/**
+ Applies a color matrix to a premultiplied ARGB (alpha first in memory) bitmap in place.
+ The color channels are clamped to the alpha channel to keep the pixels premultiplied.
+ 
+ @param m  The matrix in memory channel order (A, R, G, B): out[j] = sum(m[j][i] * in[i]).
+ */
+static void YYImageApplyColorMatrix(uint8_t *data, size_t width, size_t height, size_t bytesPerRow, const float m[4][4]) {
+#if YY_PIPELINE_NEON
+    float32x4_t c[4];
+    for (int i = 0; i < 4; i++) {
+        float column[4] = {m[0][i], m[1][i], m[2][i], m[3][i]};
+        c[i] = vld1q_f32(column);
+    }
+    float32x4_t zero = vdupq_n_f32(0), max = vdupq_n_f32(255), half = vdupq_n_f32(0.5f);
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *p = data + y * bytesPerRow;
+        for (size_t x = 0; x < width; x++, p += 4) {
+            uint8x8_t b = vreinterpret_u8_u32(vld1_dup_u32((const uint32_t *)(const void *)p));
+            float32x4_t v = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(b))));
+            float32x4_t o = vmulq_n_f32(c[0], vgetq_lane_f32(v, 0));
+            o = vmlaq_n_f32(o, c[1], vgetq_lane_f32(v, 1));
+            o = vmlaq_n_f32(o, c[2], vgetq_lane_f32(v, 2));
+            o = vmlaq_n_f32(o, c[3], vgetq_lane_f32(v, 3));
+            o = vminq_f32(vmaxq_f32(o, zero), max);
+            o = vminq_f32(o, vdupq_n_f32(vgetq_lane_f32(o, 0))); // color <= alpha
+            uint32x4_t u = vcvtq_u32_f32(vaddq_f32(o, half));
+            uint8x8_t r = vmovn_u16(vcombine_u16(vmovn_u32(u), vdup_n_u16(0)));
+            vst1_lane_u32((uint32_t *)(void *)p, vreinterpret_u32_u8(r), 0);
+        }
+    }
+#elif YY_PIPELINE_SSE2
+    __m128 c[4];
+    for (int i = 0; i < 4; i++) {
+        c[i] = _mm_setr_ps(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+    __m128 zero = _mm_setzero_ps(), max = _mm_set1_ps(255);
+    __m128i zeroi = _mm_setzero_si128();
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *p = data + y * bytesPerRow;
+        for (size_t x = 0; x < width; x++, p += 4) {
+            uint32_t pixel;
+            memcpy(&pixel, p, 4);
+            __m128i vi = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pixel), zeroi), zeroi);
+            __m128 v = _mm_cvtepi32_ps(vi);
+            __m128 o = _mm_mul_ps(c[0], _mm_shuffle_ps(v, v, 0x00));
+            o = _mm_add_ps(o, _mm_mul_ps(c[1], _mm_shuffle_ps(v, v, 0x55)));
+            o = _mm_add_ps(o, _mm_mul_ps(c[2], _mm_shuffle_ps(v, v, 0xAA)));
+            o = _mm_add_ps(o, _mm_mul_ps(c[3], _mm_shuffle_ps(v, v, 0xFF)));
+            o = _mm_min_ps(_mm_max_ps(o, zero), max);
+            o = _mm_min_ps(o, _mm_shuffle_ps(o, o, 0x00)); // color <= alpha
+            vi = _mm_cvtps_epi32(o);
+            vi = _mm_packus_epi16(_mm_packs_epi32(vi, vi), vi);
+            pixel = (uint32_t)_mm_cvtsi128_si32(vi);
+            memcpy(p, &pixel, 4);
+        }
+    }
+#else
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *p = data + y * bytesPerRow;
+        for (size_t x = 0; x < width; x++, p += 4) {
+            float v[4] = {p[0], p[1], p[2], p[3]}, o[4];
+            for (int j = 0; j < 4; j++) {
+                o[j] = m[j][0] * v[0] + m[j][1] * v[1] + m[j][2] * v[2] + m[j][3] * v[3];
+                o[j] = o[j] < 0 ? 0 : o[j] > 255 ? 255 : o[j];
+            }
+            for (int j = 1; j < 4; j++) {
+                if (o[j] > o[0]) o[j] = o[0]; // color <= alpha
+            }
+            for (int j = 0; j < 4; j++) {
+                p[j] = (uint8_t)(o[j] + 0.5f);
+            }
+        }
+    }
+#endif
+}
+
+
+typedef NS_ENUM(NSUInteger, YYImagePipelineOperationType) {
+    YYImagePipelineOperationResize = 0,
+    YYImagePipelineOperationRoundCorner,
+    YYImagePipelineOperationColorMatrix,
+};
+
+/// An operation of pipeline, immutable after it's added.
+@interface _YYImagePipelineOperation : NSObject
+@property (nonatomic) YYImagePipelineOperationType type;
+@property (nonatomic) CGSize size;                     ///< resize
+@property (nonatomic) UIViewContentMode contentMode;   ///< resize
+@property (nonatomic) CGFloat radius;                  ///< round corner
+@property (nonatomic) UIRectCorner corners;            ///< round corner
+@property (nonatomic) CGFloat borderWidth;             ///< round corner
+@property (nonatomic, strong) UIColor *borderColor;    ///< round corner
+@property (nonatomic) CGLineJoin borderLineJoin;       ///< round corner
+@property (nonatomic) YYImageColorMatrix matrix;       ///< color matrix
+@end
+
+@implementation _YYImagePipelineOperation
+@end
+
+
+@implementation YYImagePipeline {
+    NSMutableArray *_operations;
+    dispatch_semaphore_t _lock; ///< guards _transformBlock
+    YYWebImageTransformBlock _transformBlock; ///< cleared when an operation is added
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) return nil;
+    _operations = [NSMutableArray new];
+    _lock = dispatch_semaphore_create(1);
+    return self;
+}
+
+- (void)_addOperation:(_YYImagePipelineOperation *)op {
+    [_operations addObject:op];
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    _transformBlock = nil;
+    dispatch_semaphore_signal(_lock);
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    YYImagePipeline *pipeline = [self.class new];
+    [pipeline->_operations addObjectsFromArray:_operations];
+    return pipeline;
+}
+
+- (NSUInteger)operationCount {
+    return _operations.count;
+}
+
+- (void)addResizeToSize:(CGSize)size contentMode:(UIViewContentMode)contentMode {
+    _YYImagePipelineOperation *op = [_YYImagePipelineOperation new];
+    op.type = YYImagePipelineOperationResize;
+    op.size = size;
+    op.contentMode = contentMode;
+    [self _addOperation:op];
+}
+
+- (void)addRoundCornerRadius:(CGFloat)radius {
+    [self addRoundCornerRadius:radius corners:UIRectCornerAllCorners borderWidth:0 borderColor:nil borderLineJoin:kCGLineJoinMiter];
+}
+
+- (void)addRoundCornerRadius:(CGFloat)radius
+                     corners:(UIRectCorner)corners
+                 borderWidth:(CGFloat)borderWidth
+                 borderColor:(UIColor *)borderColor
+              borderLineJoin:(CGLineJoin)borderLineJoin {
+    _YYImagePipelineOperation *op = [_YYImagePipelineOperation new];
+    op.type = YYImagePipelineOperationRoundCorner;
+    op.radius = radius;
+    op.corners = corners;
+    op.borderWidth = borderWidth;
+    op.borderColor = borderColor;
+    op.borderLineJoin = borderLineJoin;
+    [self _addOperation:op];
+}
+
+- (void)addTintColor:(UIColor *)color {
+    CGFloat r = 0, g = 0, b = 0, a = 0;
+    if (![color getRed:&r green:&g blue:&b alpha:&a]) return;
+    // fill with color, then keep the image's alpha (destination in)
+    YYImageColorMatrix matrix = {{{0, 0, 0, r * a}, {0, 0, 0, g * a}, {0, 0, 0, b * a}, {0, 0, 0, a}}};
+    _YYImagePipelineOperation *op = [_YYImagePipelineOperation new];
+    op.type = YYImagePipelineOperationColorMatrix;
+    op.matrix = matrix;
+    [self _addOperation:op];
+}
+
+- (void)addSaturation:(CGFloat)saturation {
+    // These values appear in the W3C Filter Effects spec:
+    // https://dvcs.w3.org/hg/FXTF/raw-file/default/filters/Publish.html#grayscaleEquivalent
+    float s = saturation;
+    YYImageColorMatrix matrix = {{
+        {0.2126 + 0.7874 * s, 0.7152 - 0.7152 * s, 0.0722 - 0.0722 * s, 0},
+        {0.2126 - 0.2126 * s, 0.7152 + 0.2848 * s, 0.0722 - 0.0722 * s, 0},
+        {0.2126 - 0.2126 * s, 0.7152 - 0.7152 * s, 0.0722 + 0.9278 * s, 0},
+        {0,                   0,                   0,                   1},
+    }};
+    _YYImagePipelineOperation *op = [_YYImagePipelineOperation new];
+    op.type = YYImagePipelineOperationColorMatrix;
+    op.matrix = matrix;
+    [self _addOperation:op];
+}
+
+- (void)addGrayscale {
+    [self addSaturation:0];
+}
+
+- (YYWebImageTransformBlock)transformBlock {
+    // Return the same block until the operations are changed, so the web image
+    // requests with this pipeline can share a download (they compare the blocks).
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    if (!_transformBlock) {
+        YYImagePipeline *pipeline = [self copy];
+        _transformBlock = ^UIImage *(UIImage *image, NSURL *url) {
+            return [pipeline processImage:image];
+        };
+    }
+    YYWebImageTransformBlock block = _transformBlock;
+    dispatch_semaphore_signal(_lock);
+    return block;
+}
+
+- (UIImage *)processImage:(UIImage *)image {
+    if (!image) return nil;
+    NSArray *operations = _operations.copy;
+    NSUInteger count = operations.count;
+    if (count == 0) return image;
+    CGFloat scale = image.scale;
+    
+    // Stage `i` is the input of operation `i` (stage 0 is the source image, stage
+    // `count` is the result). Each resize maps the previous stage to the next stage,
+    // transforms[i] maps stage `i` to the result.
+    CGSize *sizes = malloc((count + 1) * sizeof(CGSize));
+    CGAffineTransform *transforms = malloc((count + 1) * sizeof(CGAffineTransform));
+    if (!sizes || !transforms) {
+        free(sizes);
+        free(transforms);
+        return nil;
+    }
+    sizes[0] = image.size;
+    for (NSUInteger i = 0; i < count; i++) {
+        _YYImagePipelineOperation *op = operations[i];
+        sizes[i + 1] = op.type == YYImagePipelineOperationResize ? op.size : sizes[i];
+    }
+    transforms[count] = CGAffineTransformIdentity;
+    for (NSInteger i = count - 1; i >= 0; i--) {
+        _YYImagePipelineOperation *op = operations[i];
+        CGAffineTransform step = CGAffineTransformIdentity;
+        if (op.type == YYImagePipelineOperationResize && sizes[i].width > 0 && sizes[i].height > 0) {
+            CGRect rect = YYCGRectFitWithContentMode(CGRectMake(0, 0, op.size.width, op.size.height), sizes[i], op.contentMode);
+            step = CGAffineTransformMakeTranslation(rect.origin.x, rect.origin.y);
+            step = CGAffineTransformScale(step, rect.size.width / sizes[i].width, rect.size.height / sizes[i].height);
+        }
+        transforms[i] = CGAffineTransformConcat(step, transforms[i + 1]);
+    }
+    CGSize size = sizes[count];
+    
+    // The clips (in result coordinates) of each operation. A clip is
+    // applied to the contents drawn by the previous operations.
+    NSMutableArray *clips = [NSMutableArray new];
+    NSMutableArray *clipIndexes = [NSMutableArray new];
+    for (NSUInteger i = 0; i < count; i++) {
+        _YYImagePipelineOperation *op = operations[i];
+        CGRect bounds = CGRectMake(0, 0, sizes[i + 1].width, sizes[i + 1].height);
+        UIBezierPath *path = nil;
+        if (op.type == YYImagePipelineOperationResize) {
+            path = [UIBezierPath bezierPathWithRect:bounds];
+        } else if (op.type == YYImagePipelineOperationRoundCorner) {
+            CGFloat minSize = MIN(bounds.size.width, bounds.size.height);
+            if (op.borderWidth < minSize / 2) {
+                path = [UIBezierPath bezierPathWithRoundedRect:CGRectInset(bounds, op.borderWidth, op.borderWidth) byRoundingCorners:op.corners cornerRadii:CGSizeMake(op.radius, op.borderWidth)];
+                [path closePath];
+            } else {
+                path = [UIBezierPath bezierPathWithRect:CGRectZero];
+            }
+        }
+        if (!path) continue;
+        [path applyTransform:transforms[i + 1]];
+        [clips addObject:path];
+        [clipIndexes addObject:@(i)];
+    }
+    
+    CGContextRef context = YYCGContextCreateARGBBitmapContext(size, NO, scale);
+    if (!context) {
+        free(sizes);
+        free(transforms);
+        return nil;
+    }
+    void (^clipAfter)(NSInteger) = ^(NSInteger index) {
+        for (NSUInteger c = 0; c < clips.count; c++) {
+            if ([clipIndexes[c] integerValue] <= index) continue;
+            CGContextAddPath(context, ((UIBezierPath *)clips[c]).CGPath);
+            CGContextClip(context);
+        }
+    };
+    void (^applyColorMatrix)(YYImageColorMatrix) = ^(YYImageColorMatrix matrix) {
+        // (R, G, B, A) to memory order (A, R, G, B)
+        static const int lanes[4] = {1, 2, 3, 0};
+        float m[4][4];
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                m[lanes[i]][lanes[j]] = matrix.m[i][j];
+            }
+        }
+        YYImageApplyColorMatrix(CGBitmapContextGetData(context), CGBitmapContextGetWidth(context), CGBitmapContextGetHeight(context), CGBitmapContextGetBytesPerRow(context), m);
+    };
+    
+    // draw the source image once
+    CGContextSaveGState(context);
+    clipAfter(-1);
+    CGContextConcatCTM(context, transforms[0]);
+    UIGraphicsPushContext(context);
+    [image drawInRect:CGRectMake(0, 0, image.size.width, image.size.height)];
+    UIGraphicsPopContext();
+    CGContextRestoreGState(context);
+    
+    // the color matrices are merged, and the pending matrix is applied before a border is drawn
+    YYImageColorMatrix matrix = YYImageColorMatrixIdentity;
+    BOOL hasMatrix = NO;
+    for (NSUInteger i = 0; i < count; i++) {
+        _YYImagePipelineOperation *op = operations[i];
+        if (op.type == YYImagePipelineOperationColorMatrix) {
+            matrix = YYImageColorMatrixConcat(matrix, op.matrix);
+            hasMatrix = YES;
+            continue;
+        }
+        if (op.type != YYImagePipelineOperationRoundCorner) continue;
+        
+        CGRect rect = CGRectMake(0, 0, sizes[i + 1].width, sizes[i + 1].height);
+        CGFloat minSize = MIN(rect.size.width, rect.size.height);
+        CGFloat borderWidth = op.borderWidth;
+        if (!op.borderColor || borderWidth <= 0 || borderWidth >= minSize / 2) continue;
+        if (hasMatrix) {
+            applyColorMatrix(matrix);
+            matrix = YYImageColorMatrixIdentity;
+            hasMatrix = NO;
+        }
+        
+        // same as -[UIImage imageByRoundCornerRadius:corners:borderWidth:borderColor:borderLineJoin:]
+        CGFloat strokeInset = (floor(borderWidth * scale) + 0.5) / scale;
+        CGRect strokeRect = CGRectInset(rect, strokeInset, strokeInset);
+        CGFloat strokeRadius = op.radius > scale / 2 ? op.radius - scale / 2 : 0;
+        UIBezierPath *path = [UIBezierPath bezierPathWithRoundedRect:strokeRect byRoundingCorners:op.corners cornerRadii:CGSizeMake(strokeRadius, borderWidth)];
+        [path closePath];
+        path.lineWidth = borderWidth;
+        path.lineJoinStyle = op.borderLineJoin;
+        
+        CGContextSaveGState(context);
+        clipAfter(i);
+        CGContextConcatCTM(context, transforms[i + 1]);
+        UIGraphicsPushContext(context);
+        [op.borderColor setStroke];
+        [path stroke];
+        UIGraphicsPopContext();
+        CGContextRestoreGState(context);
+    }
+    if (hasMatrix) applyColorMatrix(matrix);
+    free(sizes);
+    free(transforms);
+    
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    CFRelease(context);
+    if (!imageRef) return nil;
+    UIImage *result = [UIImage imageWithCGImage:imageRef scale:scale orientation:UIImageOrientationUp];
+    CFRelease(imageRef);
+    return result;
+}
+
+@end
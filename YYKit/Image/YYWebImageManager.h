@@ -74,6 +74,11 @@ typedef NS_OPTIONS(NSUInteger, YYWebImageOptions) {
     /// This flag will add the URL to a blacklist (in memory) when the URL fail to be downloaded,
     /// so the library won't keep trying.
     YYWebImageOptionIgnoreFailedURL = 1 << 14,
+    
+    /// Only download the image data and store it to disk cache, without decoding.
+    /// The completion block gets a nil image (and nil error if succeed).
+    /// This is used for prefetching, see `YYWebImagePrefetcher`.
+    YYWebImageOptionStoreDataOnly = 1 << 15,
 };
 
 /// Indicated where the image came from.
@@ -156,6 +161,31 @@ typedef void (^YYWebImageCompletionBlock)(UIImage * _Nullable image,
                                           YYWebImageStage stage,
                                           NSError * _Nullable error);
 
+/// The priority of an image request in manager's queue.
+typedef NS_ENUM(NSInteger, YYWebImagePriority) {
+    
+    /// Low priority, such as downloading images for later use.
+    YYWebImagePriorityBackground = 0,
+    
+    /// Normal priority, for the images which will be displayed soon (prefetch).
+    YYWebImagePriorityPrefetch,
+    
+    /// High priority, for the images which are displaying (the default).
+    YYWebImagePriorityVisible,
+};
+
+/// The order to start the requests with same priority.
+typedef NS_ENUM(NSUInteger, YYWebImageExecutionOrder) {
+    
+    /// First in first out (the default).
+    YYWebImageExecutionOrderFIFO = 0,
+    
+    /// Last in first out, the latest requests start first.
+    /// This is useful when the user scrolls fast and the earlier requests are
+    /// for the cells which are already off screen.
+    YYWebImageExecutionOrderLIFO,
+};
+
 
 
 
@@ -188,6 +218,15 @@ typedef void (^YYWebImageCompletionBlock)(UIImage * _Nullable image,
 /**
  Creates and returns a new image operation, the operation will start immediately.
  
+ @discussion If there's already a running operation for the same cache key (see
+ `cacheKeyForURL:`) with the same transform block and compatible options, the new
+ operation will be attached to the running one instead of starting another download
+ and decode. It receives the same progress and result, and cancelling it only
+ detaches its own blocks: the download is cancelled after all the requests which
+ share it are cancelled. The transform blocks are compared by pointer, so reuse
+ the same block object (such as `YYImagePipeline.transformBlock`) for the requests
+ which should share a download. The requests without cache key are never shared.
+ 
  @param url        The image url (remote or local file path).
  @param options    The options to control image operation.
  @param progress   Progress block which will be invoked on background thread (pass nil to avoid).
@@ -201,6 +240,61 @@ typedef void (^YYWebImageCompletionBlock)(UIImage * _Nullable image,
                                             transform:(nullable YYWebImageTransformBlock)transform
                                            completion:(nullable YYWebImageCompletionBlock)completion;
 
+/**
+ Creates and returns a new image operation with a priority.
+ 
+ @discussion The priority is used by the manager's `queue` to choose the next 
+ operation to start, it has no effect when the queue is nil. If the request is 
+ attached to a running operation with same cache key, the running operation's
+ priority is raised if needed.
+ 
+ @param url        The image url (remote or local file path).
+ @param options    The options to control image operation.
+ @param priority   The priority of the request.
+ @param progress   Progress block which will be invoked on background thread (pass nil to avoid).
+ @param transform  Transform block which will be invoked on background thread  (pass nil to avoid).
+ @param completion Completion block which will be invoked on background thread  (pass nil to avoid).
+ @return A new image operation.
+ */
+- (nullable YYWebImageOperation *)requestImageWithURL:(NSURL *)url
+                                              options:(YYWebImageOptions)options
+                                             priority:(YYWebImagePriority)priority
+                                             progress:(nullable YYWebImageProgressBlock)progress
+                                            transform:(nullable YYWebImageTransformBlock)transform
+                                           completion:(nullable YYWebImageCompletionBlock)completion;
+
+/**
+ Changes the priority of the running (or waiting) request for a cache key.
+ For example, lower the priority to `YYWebImagePriorityPrefetch` when the cell
+ scrolls off screen, and raise it back when the cell appears again.
+ 
+ @param priority The new priority.
+ @param cacheKey The cache key of the request, see `cacheKeyForURL:`.
+ @return Whether there's a running request for the key.
+ */
+- (BOOL)setPriority:(YYWebImagePriority)priority forKey:(NSString *)cacheKey;
+
+/**
+ Cancels the running (or waiting) request for a cache key, including all the 
+ requests attached to it. The completion blocks get `YYWebImageStageCancelled`.
+ 
+ @param cacheKey The cache key of the request, see `cacheKeyForURL:`.
+ */
+- (void)cancelRequestForKey:(NSString *)cacheKey;
+
+/**
+ The order to start the waiting requests with same priority in `queue`.
+ Default is YYWebImageExecutionOrderFIFO.
+ 
+ @discussion With LIFO order, the manager keeps the waiting requests in a stack
+ for each priority, and adds the newest one (of the highest priority) to `queue`
+ when a request it added finishes. It keeps up to `maxConcurrentOperationCount`
+ of the queue (or the count of active processors if it's the default value) 
+ unfinished requests in the queue, so the requests still run concurrently.
+ The order only affects the requests created after the value is changed.
+ */
+@property (nonatomic) YYWebImageExecutionOrder executionOrder;
+
 /**
  The image cache used by image operation. 
  You can set it to nil to avoid image cache.
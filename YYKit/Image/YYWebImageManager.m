@@ -14,7 +14,32 @@
 #import "YYWebImageOperation.h"
 #import "YYImageCoder.h"
 
-@implementation YYWebImageManager
+@interface YYWebImageOperation (YYWebImageManager)
+/// Attach a new (not started) operation to this running operation.
+/// Returns NO if they cannot share the result, or this operation is finished.
+- (BOOL)_addFollower:(YYWebImageOperation *)operation;
+/// Cancel this operation and all the followers.
+- (void)_cancelWithFollowers;
+@end
+
+
+static inline NSOperationQueuePriority YYWebImageQueuePriority(YYWebImagePriority priority) {
+    switch (priority) {
+        case YYWebImagePriorityBackground: return NSOperationQueuePriorityVeryLow;
+        case YYWebImagePriorityPrefetch: return NSOperationQueuePriorityLow;
+        default: return NSOperationQueuePriorityHigh;
+    }
+}
+
+#define kPriorityCount (YYWebImagePriorityVisible + 1)
+
+
+@implementation YYWebImageManager {
+    dispatch_semaphore_t _runningLock;
+    NSMutableDictionary *_runningOperations; ///< cache key -> YYWebImageOperation
+    NSMutableArray *_waitingOperations[kPriorityCount]; ///< LIFO stacks, the operations not added to queue yet
+    NSMutableSet *_feedingOperations; ///< the operations moved from the stacks to queue, and not finished
+}
 
 + (instancetype)sharedManager {
     static YYWebImageManager *manager;
@@ -41,6 +66,12 @@
     _cache = cache;
     _queue = queue;
     _timeout = 15.0;
+    _runningLock = dispatch_semaphore_create(1);
+    _runningOperations = [NSMutableDictionary new];
+    for (NSUInteger i = 0; i < kPriorityCount; i++) {
+        _waitingOperations[i] = [NSMutableArray new];
+    }
+    _feedingOperations = [NSMutableSet new];
     if (YYImageWebPAvailable()) {
         _headers = @{ @"Accept" : @"image/webp,image/*;q=0.8" };
     } else {
@@ -54,6 +85,15 @@
                                     progress:(YYWebImageProgressBlock)progress
                                    transform:(YYWebImageTransformBlock)transform
                                   completion:(YYWebImageCompletionBlock)completion {
+    return [self requestImageWithURL:url options:options priority:YYWebImagePriorityVisible progress:progress transform:transform completion:completion];
+}
+
+- (YYWebImageOperation *)requestImageWithURL:(NSURL *)url
+                                     options:(YYWebImageOptions)options
+                                    priority:(YYWebImagePriority)priority
+                                    progress:(YYWebImageProgressBlock)progress
+                                   transform:(YYWebImageTransformBlock)transform
+                                  completion:(YYWebImageCompletionBlock)completion {
     
     NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
     request.timeoutInterval = _timeout;
@@ -75,8 +115,45 @@
         operation.credential = [NSURLCredential credentialWithUser:_username password:_password persistence:NSURLCredentialPersistenceForSession];
     }
     if (operation) {
+        if (priority < YYWebImagePriorityBackground) priority = YYWebImagePriorityBackground;
+        if (priority > YYWebImagePriorityVisible) priority = YYWebImagePriorityVisible;
+        operation.queuePriority = YYWebImageQueuePriority(priority);
+        
+        // without cache key (nil url, or filtered out), the operation is not shared
+        NSString *cacheKey = operation.cacheKey;
+        if (cacheKey) {
+            // lookup and register in one lock, so the concurrent requests of a key
+            // can't both miss (the operation never takes _runningLock in its lock)
+            dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+            YYWebImageOperation *running = _runningOperations[cacheKey];
+            BOOL followed = running && [running _addFollower:operation];
+            if (!followed) _runningOperations[cacheKey] = operation;
+            dispatch_semaphore_signal(_runningLock);
+            if (followed) {
+                if (running.queuePriority < operation.queuePriority) [self _setPriority:priority forOperation:running];
+                return operation;
+            }
+        }
+        
         NSOperationQueue *queue = _queue;
-        if (queue) {
+        BOOL lifo = queue && _executionOrder == YYWebImageExecutionOrderLIFO;
+        if (cacheKey || lifo) {
+            __weak typeof(self) _self = self;
+            __weak typeof(operation) _operation = operation;
+            operation.completionBlock = ^{
+                __strong typeof(_self) self = _self;
+                if (!self) return;
+                if (cacheKey) [self _removeRunningOperation:_operation forKey:cacheKey];
+                if (lifo) [self _feedingOperationDidFinish:_operation];
+            };
+        }
+        
+        if (lifo) {
+            dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+            [_waitingOperations[priority] addObject:operation];
+            dispatch_semaphore_signal(_runningLock);
+            [self _feedQueue];
+        } else if (queue) {
             [queue addOperation:operation];
         } else {
             [operation start];
@@ -85,6 +162,104 @@
     return operation;
 }
 
+/// The max count of the operations moved from the LIFO stacks to queue.
+- (NSUInteger)_maxFeedingCount {
+    NSInteger count = _queue.maxConcurrentOperationCount;
+    if (count == NSOperationQueueDefaultMaxConcurrentOperationCount) {
+        count = MAX([NSProcessInfo processInfo].activeProcessorCount, 2);
+    }
+    return MAX(count, 1);
+}
+
+/**
+ Moves the newest waiting operations (higher priority first) to queue until there
+ are enough unfinished ones, so the queue never holds old requests while the newer
+ ones are waiting. The cancelled operations are moved directly, they finish without
+ downloading.
+ */
+- (void)_feedQueue {
+    NSUInteger maxCount = [self _maxFeedingCount];
+    NSMutableArray *operations = [NSMutableArray new];
+    dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+    for (NSInteger p = kPriorityCount - 1; p >= 0; p--) {
+        NSMutableArray *stack = _waitingOperations[p];
+        for (NSInteger i = (NSInteger)stack.count - 1; i >= 0; i--) {
+            YYWebImageOperation *operation = stack[i];
+            if (operation.isCancelled) {
+                [operations addObject:operation];
+                [stack removeObjectAtIndex:i];
+            }
+        }
+        while (stack.count > 0 && _feedingOperations.count < maxCount) {
+            YYWebImageOperation *operation = stack.lastObject;
+            [stack removeLastObject];
+            [_feedingOperations addObject:operation];
+            [operations addObject:operation];
+        }
+    }
+    dispatch_semaphore_signal(_runningLock);
+    
+    NSOperationQueue *queue = _queue;
+    for (YYWebImageOperation *operation in operations) {
+        if (queue) {
+            [queue addOperation:operation];
+        } else {
+            [operation start];
+        }
+    }
+}
+
+- (void)_feedingOperationDidFinish:(YYWebImageOperation *)operation {
+    if (!operation) return;
+    dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+    [_feedingOperations removeObject:operation];
+    dispatch_semaphore_signal(_runningLock);
+    [self _feedQueue];
+}
+
+/// Sets the queue priority, and moves the operation to the stack of the priority if it's waiting.
+- (void)_setPriority:(YYWebImagePriority)priority forOperation:(YYWebImageOperation *)operation {
+    if (priority < YYWebImagePriorityBackground) priority = YYWebImagePriorityBackground;
+    if (priority > YYWebImagePriorityVisible) priority = YYWebImagePriorityVisible;
+    operation.queuePriority = YYWebImageQueuePriority(priority);
+    dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+    for (NSUInteger p = 0; p < kPriorityCount; p++) {
+        NSUInteger index = [_waitingOperations[p] indexOfObjectIdenticalTo:operation];
+        if (index == NSNotFound) continue;
+        if (p != (NSUInteger)priority) {
+            [_waitingOperations[p] removeObjectAtIndex:index];
+            [_waitingOperations[priority] addObject:operation];
+        }
+        break;
+    }
+    dispatch_semaphore_signal(_runningLock);
+}
+
+- (void)_removeRunningOperation:(YYWebImageOperation *)operation forKey:(NSString *)cacheKey {
+    dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+    YYWebImageOperation *running = _runningOperations[cacheKey];
+    if (!running || running == operation) [_runningOperations removeObjectForKey:cacheKey];
+    dispatch_semaphore_signal(_runningLock);
+}
+
+- (BOOL)setPriority:(YYWebImagePriority)priority forKey:(NSString *)cacheKey {
+    if (!cacheKey) return NO;
+    dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+    YYWebImageOperation *running = _runningOperations[cacheKey];
+    dispatch_semaphore_signal(_runningLock);
+    if (!running) return NO;
+    [self _setPriority:priority forOperation:running];
+    return YES;
+}
+
+- (void)cancelRequestForKey:(NSString *)cacheKey {
+    if (!cacheKey) return;
+    dispatch_semaphore_wait(_runningLock, DISPATCH_TIME_FOREVER);
+    YYWebImageOperation *running = _runningOperations[cacheKey];
+    dispatch_semaphore_signal(_runningLock);
+    [running _cancelWithFollowers];
+}
+
 - (NSDictionary *)headersForURL:(NSURL *)url {
     if (!url) return nil;
     return _headersFilter ? _headersFilter(url, _headers) : _headers;
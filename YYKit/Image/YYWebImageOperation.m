@@ -41,16 +41,21 @@ static BOOL YYCGImageLastPixelFilled(CGImageRef image) {
     return !isAlpha;
 }
 
-/// Returns JPEG SOS (Start Of Scan) Marker
-static NSData *JPEGSOSMarker() {
-    // "Start Of Scan" Marker
-    static NSData *marker = nil;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        uint8_t bytes[2] = {0xFF, 0xDA};
-        marker = [NSData dataWithBytes:bytes length:2];
-    });
-    return marker;
+/// Returns the count of JPEG SOS (Start Of Scan) Markers (0xFF 0xDA) in the bytes.
+/// `lastByte` is the last byte before these bytes, so the marker across two
+/// received chunks is also counted.
+static NSUInteger JPEGSOSMarkerCount(const uint8_t *bytes, NSUInteger length, uint8_t lastByte) {
+    if (!bytes || length == 0) return 0;
+    NSUInteger count = 0;
+    if (lastByte == 0xFF && bytes[0] == 0xDA) count++;
+    const uint8_t *cur = bytes, *end = bytes + length;
+    while (cur < end - 1) {
+        cur = memchr(cur, 0xFF, end - 1 - cur);
+        if (!cur) break;
+        if (cur[1] == 0xDA) count++;
+        cur++;
+    }
+    return count;
 }
 
 
@@ -98,15 +103,32 @@ static void URLInBlackListAdd(NSURL *url) {
 @property (nonatomic, strong) YYImageDecoder *progressiveDecoder;
 @property (nonatomic, assign) BOOL progressiveIgnored;
 @property (nonatomic, assign) BOOL progressiveDetected;
-@property (nonatomic, assign) NSUInteger progressiveScanedLength;
+@property (nonatomic, assign) NSUInteger progressiveScanCount;
+@property (nonatomic, assign) NSUInteger progressiveDisplayedScanCount;
+@property (nonatomic, assign) uint8_t progressiveLastByte;
 @property (nonatomic, assign) NSUInteger progressiveDisplayCount;
 
 @property (nonatomic, copy) YYWebImageProgressBlock progress;
 @property (nonatomic, copy) YYWebImageTransformBlock transform;
 @property (nonatomic, copy) YYWebImageCompletionBlock completion;
+
+@property (nonatomic, strong) NSMutableArray *followers; ///< Array<YYWebImageOperation>, requests attached to this operation
+@property (strong) YYWebImageOperation *leader; ///< The operation which does the work for this request
+@property (nonatomic, assign) BOOL subscriberCancelled; ///< The caller cancelled, but followers still need the result
 @end
 
 
+/// The options which change the result of an operation, only the requests with
+/// same options (and same transform) can share one operation.
+static const YYWebImageOptions YYWebImageOptionsAffectResult =
+    YYWebImageOptionProgressive | YYWebImageOptionProgressiveBlur |
+    YYWebImageOptionUseNSURLCache | YYWebImageOptionAllowInvalidSSLCertificates |
+    YYWebImageOptionHandleCookies | YYWebImageOptionRefreshImageCache |
+    YYWebImageOptionIgnoreDiskCache | YYWebImageOptionIgnoreImageDecoding |
+    YYWebImageOptionIgnoreAnimatedImage | YYWebImageOptionIgnoreFailedURL |
+    YYWebImageOptionStoreDataOnly;
+
+
 @implementation YYWebImageOperation
 @synthesize executing = _executing;
 @synthesize finished = _finished;
@@ -232,6 +254,84 @@ static void URLInBlackListAdd(NSURL *url) {
     [_lock unlock];
 }
 
+#pragma mark - Followers
+
+- (BOOL)_addFollower:(YYWebImageOperation *)operation {
+    if (!operation || operation == self) return NO;
+    if (operation.transform != _transform) return NO;
+    if ((operation.options & YYWebImageOptionsAffectResult) != (_options & YYWebImageOptionsAffectResult)) return NO;
+    if (![operation.cacheKey isEqualToString:_cacheKey]) return NO;
+    
+    BOOL added = NO;
+    [_lock lock];
+    if (![self isCancelled] && ![self isFinished]) {
+        if (!_followers) _followers = [NSMutableArray new];
+        [_followers addObject:operation];
+        operation.leader = self;
+        operation.executing = YES;
+        added = YES;
+    }
+    [_lock unlock];
+    return added;
+}
+
+- (void)_removeFollower:(YYWebImageOperation *)operation {
+    BOOL shouldCancel = NO;
+    [_lock lock];
+    NSUInteger index = [_followers indexOfObjectIdenticalTo:operation];
+    if (index != NSNotFound) {
+        [_followers removeObjectAtIndex:index];
+        operation.leader = nil;
+        operation.executing = NO;
+        operation.finished = YES;
+        [operation performSelector:@selector(_cancelOperation) onThread:[[self class] _networkThread] withObject:nil waitUntilDone:NO modes:@[NSDefaultRunLoopMode]];
+        shouldCancel = _subscriberCancelled && _followers.count == 0;
+    }
+    [_lock unlock];
+    if (shouldCancel) [self cancel]; // no one needs the result
+}
+
+- (void)_cancelWithFollowers {
+    [_lock lock];
+    NSArray *followers = _followers.copy;
+    [_lock unlock];
+    [self cancel]; // only detach the caller if there're followers
+    for (YYWebImageOperation *follower in followers) {
+        [follower cancel]; // the last one cancels this operation
+    }
+}
+
+/// Calls the progress block of the caller and all followers, should be called in lock.
+- (void)_callProgressWithReceivedSize:(NSInteger)receivedSize expectedSize:(NSInteger)expectedSize {
+    if (_progress) _progress(receivedSize, expectedSize);
+    for (YYWebImageOperation *follower in _followers) {
+        if (follower.progress) follower.progress(receivedSize, expectedSize);
+    }
+}
+
+/// Calls the completion block of the caller and all followers, should be called in lock.
+/// The followers are finished if stage is `YYWebImageStageFinished`.
+- (void)_callCompletionWithImage:(UIImage *)image from:(YYWebImageFromType)from stage:(YYWebImageStage)stage error:(NSError *)error {
+    if (_completion) _completion(image, _request.URL, from, stage, error);
+    NSArray *followers = _followers;
+    if (stage == YYWebImageStageFinished) _followers = nil;
+    for (YYWebImageOperation *follower in followers) {
+        if (follower.completion) follower.completion(image, follower.request.URL, from, stage, error);
+        if (stage == YYWebImageStageFinished) {
+            follower.leader = nil;
+            follower.executing = NO;
+            follower.finished = YES;
+        }
+    }
+}
+
+- (BOOL)_hasCompletion {
+    [_lock lock];
+    BOOL has = _completion != nil || _followers.count > 0;
+    [_lock unlock];
+    return has;
+}
+
 #pragma mark - Runs in operation thread
 
 - (void)_finish {
@@ -252,7 +352,7 @@ static void URLInBlackListAdd(NSURL *url) {
             if (image) {
                 [_lock lock];
                 if (![self isCancelled]) {
-                    if (_completion) _completion(image, _request.URL, YYWebImageFromMemoryCache, YYWebImageStageFinished, nil);
+                    [self _callCompletionWithImage:image from:YYWebImageFromMemoryCache stage:YYWebImageStageFinished error:nil];
                 }
                 [self _finish];
                 [_lock unlock];
@@ -263,6 +363,14 @@ static void URLInBlackListAdd(NSURL *url) {
                 dispatch_async([self.class _imageQueue], ^{
                     __strong typeof(_self) self = _self;
                     if (!self || [self isCancelled]) return;
+                    if (self.options & YYWebImageOptionStoreDataOnly) { // no need to decode
+                        if ([self.cache containsImageForKey:self.cacheKey withType:YYImageCacheTypeDisk]) {
+                            [self performSelector:@selector(_didFindImageDataInDiskCache) onThread:[self.class _networkThread] withObject:nil waitUntilDone:NO];
+                        } else {
+                            [self performSelector:@selector(_startRequest:) onThread:[self.class _networkThread] withObject:nil waitUntilDone:NO];
+                        }
+                        return;
+                    }
                     UIImage *image = [self.cache getImageForKey:self.cacheKey withType:YYImageCacheTypeDisk];
                     if (image) {
                         [self.cache setImage:image imageData:nil forKey:self.cacheKey withType:YYImageCacheTypeMemory];
@@ -286,7 +394,7 @@ static void URLInBlackListAdd(NSURL *url) {
             NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorFileDoesNotExist userInfo:@{ NSLocalizedDescriptionKey : @"Failed to load URL, blacklisted." }];
             [_lock lock];
             if (![self isCancelled]) {
-                if (_completion) _completion(nil, _request.URL, YYWebImageFromNone, YYWebImageStageFinished, error);
+                [self _callCompletionWithImage:nil from:YYWebImageFromNone stage:YYWebImageStageFinished error:error];
             }
             [self _finish];
             [_lock unlock];
@@ -328,13 +436,20 @@ static void URLInBlackListAdd(NSURL *url) {
 }
 
 
+// runs on network thread, called from outer "cancel" when followers still need the result
+- (void)_callCancelledCompletion:(YYWebImageCompletionBlock)completion {
+    @autoreleasepool {
+        completion(nil, _request.URL, YYWebImageFromNone, YYWebImageStageCancelled, nil);
+    }
+}
+
 // runs on network thread
 - (void)_didReceiveImageFromDiskCache:(UIImage *)image {
     @autoreleasepool {
         [_lock lock];
         if (![self isCancelled]) {
             if (image) {
-                if (_completion) _completion(image, _request.URL, YYWebImageFromDiskCache, YYWebImageStageFinished, nil);
+                [self _callCompletionWithImage:image from:YYWebImageFromDiskCache stage:YYWebImageStageFinished error:nil];
                 [self _finish];
             } else {
                 [self _startRequest:nil];
@@ -344,11 +459,32 @@ static void URLInBlackListAdd(NSURL *url) {
     }
 }
 
+// runs on network thread
+- (void)_didFindImageDataInDiskCache {
+    @autoreleasepool {
+        [_lock lock];
+        if (![self isCancelled]) {
+            [self _callCompletionWithImage:nil from:YYWebImageFromDiskCache stage:YYWebImageStageFinished error:nil];
+            [self _finish];
+        }
+        [_lock unlock];
+    }
+}
+
 - (void)_didReceiveImageFromWeb:(UIImage *)image {
     @autoreleasepool {
         [_lock lock];
         if (![self isCancelled]) {
-            if (_cache) {
+            BOOL dataOnly = (_options & YYWebImageOptionStoreDataOnly) != 0;
+            BOOL succeed = image || (dataOnly && _data.length);
+            if (_cache && dataOnly) {
+                if (_data.length && !(_options & YYWebImageOptionIgnoreDiskCache)) {
+                    NSData *data = _data;
+                    dispatch_async([YYWebImageOperation _imageQueue], ^{
+                        [_cache setImage:nil imageData:data forKey:_cacheKey withType:YYImageCacheTypeDisk];
+                    });
+                }
+            } else if (_cache) {
                 if (image || (_options & YYWebImageOptionRefreshImageCache)) {
                     NSData *data = _data;
                     dispatch_async([YYWebImageOperation _imageQueue], ^{
@@ -360,7 +496,7 @@ static void URLInBlackListAdd(NSURL *url) {
             }
             _data = nil;
             NSError *error = nil;
-            if (!image) {
+            if (!succeed) {
                 error = [NSError errorWithDomain:@"com.ibireme.yykit.image" code:-1 userInfo:@{ NSLocalizedDescriptionKey : @"Web image decode fail." }];
                 if (_options & YYWebImageOptionIgnoreFailedURL) {
                     if (URLBlackListContains(_request.URL)) {
@@ -370,7 +506,7 @@ static void URLInBlackListAdd(NSURL *url) {
                     }
                 }
             }
-            if (_completion) _completion(image, _request.URL, YYWebImageFromRemote, YYWebImageStageFinished, error);
+            [self _callCompletionWithImage:image from:YYWebImageFromRemote stage:YYWebImageStageFinished error:error];
             [self _finish];
         }
         [_lock unlock];
@@ -436,11 +572,9 @@ static void URLInBlackListAdd(NSURL *url) {
                 if (_expectedSize < 0) _expectedSize = -1;
             }
             _data = [NSMutableData dataWithCapacity:_expectedSize > 0 ? _expectedSize : 0];
-            if (_progress) {
-                [_lock lock];
-                if (![self isCancelled]) _progress(0, _expectedSize);
-                [_lock unlock];
-            }
+            [_lock lock];
+            if (![self isCancelled]) [self _callProgressWithReceivedSize:0 expectedSize:_expectedSize];
+            [_lock unlock];
         }
     }
 }
@@ -453,18 +587,20 @@ static void URLInBlackListAdd(NSURL *url) {
         if (canceled) return;
         
         if (data) [_data appendData:data];
-        if (_progress) {
-            [_lock lock];
-            if (![self isCancelled]) {
-                _progress(_data.length, _expectedSize);
-            }
-            [_lock unlock];
+        [_lock lock];
+        if (![self isCancelled]) {
+            [self _callProgressWithReceivedSize:_data.length expectedSize:_expectedSize];
         }
+        [_lock unlock];
         
         /*--------------------------- progressive ----------------------------*/
         BOOL progressive = (_options & YYWebImageOptionProgressive) > 0;
         BOOL progressiveBlur = (_options & YYWebImageOptionProgressiveBlur) > 0;
-        if (!_completion || !(progressive || progressiveBlur)) return;
+        if (progressiveBlur && !_progressiveIgnored && data.length) { // only scan the new bytes
+            _progressiveScanCount += JPEGSOSMarkerCount(data.bytes, data.length, _progressiveLastByte);
+            _progressiveLastByte = ((const uint8_t *)data.bytes)[data.length - 1];
+        }
+        if (!(progressive || progressiveBlur) || ![self _hasCompletion]) return;
         if (data.length <= 16) return;
         if (_expectedSize > 0 && data.length >= _expectedSize * 0.99) return;
         if (_progressiveIgnored) return;
@@ -476,11 +612,13 @@ static void URLInBlackListAdd(NSURL *url) {
         if (!_progressiveDecoder) {
             _progressiveDecoder = [[YYImageDecoder alloc] initWithScale:[UIScreen mainScreen].scale];
         }
+        // The decoder keeps an incremental source (ImageIO incremental source or
+        // WebPIDecoder), which only parses the bytes appended since last update.
         [_progressiveDecoder updateData:_data final:NO];
         if ([self isCancelled]) return;
         
         if (_progressiveDecoder.type == YYImageTypeUnknown ||
-            _progressiveDecoder.type == YYImageTypeWebP ||
+            (_progressiveDecoder.type == YYImageTypeWebP && !YYImageWebPAvailable()) ||
             _progressiveDecoder.type == YYImageTypeOther) {
             _progressiveDecoder = nil;
             _progressiveIgnored = YES;
@@ -501,7 +639,7 @@ static void URLInBlackListAdd(NSURL *url) {
             if (frame.image) {
                 [_lock lock];
                 if (![self isCancelled]) {
-                    _completion(frame.image, _request.URL, YYWebImageFromRemote, YYWebImageStageProgress, nil);
+                    [self _callCompletionWithImage:frame.image from:YYWebImageFromRemote stage:YYWebImageStageProgress error:nil];
                     _lastProgressiveDecodeTimestamp = now;
                 }
                 [_lock unlock];
@@ -521,12 +659,9 @@ static void URLInBlackListAdd(NSURL *url) {
                     _progressiveDetected = YES;
                 }
                 
-                NSInteger scanLength = (NSInteger)_data.length - (NSInteger)_progressiveScanedLength - 4;
-                if (scanLength <= 2) return;
-                NSRange scanRange = NSMakeRange(_progressiveScanedLength, scanLength);
-                NSRange markerRange = [_data rangeOfData:JPEGSOSMarker() options:kNilOptions range:scanRange];
-                _progressiveScanedLength = _data.length;
-                if (markerRange.location == NSNotFound) return;
+                // a new scan is started since last display, so the previous scan is complete
+                if (_progressiveScanCount == _progressiveDisplayedScanCount) return;
+                _progressiveDisplayedScanCount = _progressiveScanCount;
                 if ([self isCancelled]) return;
                 
             } else if (_progressiveDecoder.type == YYImageTypePNG) {
@@ -562,7 +697,7 @@ static void URLInBlackListAdd(NSURL *url) {
             if (image) {
                 [_lock lock];
                 if (![self isCancelled]) {
-                    _completion(image, _request.URL, YYWebImageFromRemote, YYWebImageStageProgress, nil);
+                    [self _callCompletionWithImage:image from:YYWebImageFromRemote stage:YYWebImageStageProgress error:nil];
                     _lastProgressiveDecodeTimestamp = now;
                 }
                 [_lock unlock];
@@ -581,6 +716,13 @@ static void URLInBlackListAdd(NSURL *url) {
                 __strong typeof(_self) self = _self;
                 if (!self) return;
                 
+                if (self.options & YYWebImageOptionStoreDataOnly) { // just check the data type
+                    if (YYImageDetectType((__bridge CFDataRef)self.data) == YYImageTypeUnknown) self.data = nil;
+                    if ([self isCancelled]) return;
+                    [self performSelector:@selector(_didReceiveImageFromWeb:) onThread:[self.class _networkThread] withObject:nil waitUntilDone:NO];
+                    return;
+                }
+                
                 BOOL shouldDecode = (self.options & YYWebImageOptionIgnoreImageDecoding) == 0;
                 BOOL allowAnimation = (self.options & YYWebImageOptionIgnoreAnimatedImage) == 0;
                 UIImage *image;
@@ -643,9 +785,7 @@ static void URLInBlackListAdd(NSURL *url) {
     @autoreleasepool {
         [_lock lock];
         if (![self isCancelled]) {
-            if (_completion) {
-                _completion(nil, _request.URL, YYWebImageFromNone, YYWebImageStageFinished, error);
-            }
+            [self _callCompletionWithImage:nil from:YYWebImageFromNone stage:YYWebImageStageFinished error:error];
             _connection = nil;
             _data = nil;
             if (![_request.URL isFileURL] && (_options & YYWebImageOptionShowNetworkActivity)) {
@@ -706,6 +846,27 @@ static void URLInBlackListAdd(NSURL *url) {
 
 - (void)cancel {
     [_lock lock];
+    YYWebImageOperation *leader = _leader;
+    if (leader) { // this request is attached to another operation, just detach it
+        [super cancel];
+        self.cancelled = YES;
+        [_lock unlock];
+        [leader _removeFollower:self];
+        return;
+    }
+    if (_followers.count > 0 && ![self isCancelled]) { // keep working for the followers
+        if (!_subscriberCancelled) {
+            _subscriberCancelled = YES;
+            YYWebImageCompletionBlock completion = _completion;
+            _progress = nil;
+            _completion = nil;
+            if (completion) {
+                [self performSelector:@selector(_callCancelledCompletion:) onThread:[[self class] _networkThread] withObject:completion waitUntilDone:NO modes:@[NSDefaultRunLoopMode]];
+            }
+        }
+        [_lock unlock];
+        return;
+    }
     if (![self isCancelled]) {
         [super cancel];
         self.cancelled = YES;
@@ -0,0 +1,116 @@
+//
+//  YYWebImagePrefetcher.h
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/17.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <UIKit/UIKit.h>
+
+#if __has_include(<YYKit/YYKit.h>)
+#import <YYKit/YYWebImageManager.h>
+#else
+#import "YYWebImageManager.h"
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The block invoked when an URL in the prefetch batch is done (finished, skipped or failed).
+ 
+ @param doneCount  The count of URLs which are done.
+ @param totalCount The count of URLs in the batch.
+ */
+typedef void(^YYWebImagePrefetcherProgressBlock)(NSUInteger doneCount, NSUInteger totalCount);
+
+/**
+ The block invoked when the prefetch batch is done or cancelled.
+ 
+ @param finishedCount The count of URLs which are fetched and stored to cache.
+ @param skippedCount  The count of URLs which are already in cache.
+ @param failedCount   The count of URLs which are failed to fetch.
+ @param cancelled     Whether the batch is cancelled.
+ */
+typedef void(^YYWebImagePrefetcherCompletionBlock)(NSUInteger finishedCount,
+                                                   NSUInteger skippedCount,
+                                                   NSUInteger failedCount,
+                                                   BOOL cancelled);
+
+
+/**
+ YYWebImagePrefetcher fetches a batch of images to image cache ahead of display,
+ such as the images of next page in a feed.
+ 
+ @discussion It limits the count of concurrent requests, skips the images already
+ in cache, and uses a low priority (`YYWebImagePriorityPrefetch` by default) so
+ the visible images are not blocked. The requests share the manager's running
+ operations, so an image being prefetched is not downloaded again when it's displayed.
+ 
+ Sample Code:
+ 
+     YYWebImagePrefetcher *prefetcher = [YYWebImagePrefetcher new];
+     prefetcher.storesDataOnly = YES;
+     [prefetcher prefetchURLs:nextPageURLs progress:nil completion:nil];
+ 
+ */
+@interface YYWebImagePrefetcher : NSObject
+
+/**
+ Creates a prefetcher with `[YYWebImageManager sharedManager]`.
+ */
+- (instancetype)init;
+
+/**
+ Creates a prefetcher with a manager.
+ 
+ @param manager The manager used to fetch images, and its cache is used to store them.
+ @return A new prefetcher.
+ */
+- (instancetype)initWithManager:(YYWebImageManager *)manager NS_DESIGNATED_INITIALIZER;
+
+/** The manager used to fetch images. */
+@property (nonatomic, strong, readonly) YYWebImageManager *manager;
+
+/** The max count of concurrent requests. Default is 3. */
+@property NSUInteger maxConcurrentCount;
+
+/** The options of requests. Default is 0. */
+@property YYWebImageOptions options;
+
+/** The priority of requests. Default is YYWebImagePriorityPrefetch. */
+@property YYWebImagePriority priority;
+
+/**
+ Whether to store the image data to disk cache only, without decoding. Default is NO.
+ 
+ @discussion If the value is NO, the images are decoded and stored to both memory
+ and disk cache, so they can be displayed immediately. Set it to YES for images
+ which are not going to be displayed soon, it saves the CPU and memory cost of
+ decoding. See `YYWebImageOptionStoreDataOnly`.
+ */
+@property BOOL storesDataOnly;
+
+/**
+ Prefetches a batch of URLs. The unfinished batch (if exists) will be cancelled.
+ 
+ @param urls       The image URLs.
+ @param progress   The block invoked on main thread when an URL is done. Pass nil to avoid it.
+ @param completion The block invoked on main thread when all the URLs are done,
+    or the batch is cancelled. Pass nil to avoid it.
+ */
+- (void)prefetchURLs:(NSArray<NSURL *> *)urls
+            progress:(nullable YYWebImagePrefetcherProgressBlock)progress
+          completion:(nullable YYWebImagePrefetcherCompletionBlock)completion;
+
+/**
+ Cancels the current batch, includes the running requests.
+ */
+- (void)cancelAll;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,173 @@
+//
+//  YYWebImagePrefetcher.m
+//  YYKit <https://github.com/ibireme/YYKit>
+//
+//  Created by agent on 26/10/17.
+//  Copyright (c) 2026 agent.
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "YYWebImagePrefetcher.h"
+#import "YYWebImageOperation.h"
+#import "YYImageCache.h"
+
+@implementation YYWebImagePrefetcher {
+    dispatch_queue_t _queue; ///< all the states below are accessed in this queue
+    NSUInteger _batch;       ///< increased when a batch is started or cancelled
+    NSMutableArray *_pendingURLs;
+    NSMutableArray *_runningOperations;
+    NSUInteger _totalCount;
+    NSUInteger _finishedCount;
+    NSUInteger _skippedCount;
+    NSUInteger _failedCount;
+    YYWebImagePrefetcherProgressBlock _progress;
+    YYWebImagePrefetcherCompletionBlock _completion;
+}
+
+- (instancetype)init {
+    return [self initWithManager:[YYWebImageManager sharedManager]];
+}
+
+- (instancetype)initWithManager:(YYWebImageManager *)manager {
+    self = [super init];
+    if (!self) return nil;
+    _manager = manager;
+    _queue = dispatch_queue_create("com.ibireme.yykit.webimage.prefetcher", DISPATCH_QUEUE_SERIAL);
+    _pendingURLs = [NSMutableArray new];
+    _runningOperations = [NSMutableArray new];
+    _maxConcurrentCount = 3;
+    _priority = YYWebImagePriorityPrefetch;
+    return self;
+}
+
+- (void)dealloc {
+    for (NSOperation *operation in _runningOperations) {
+        [operation cancel];
+    }
+}
+
+- (void)prefetchURLs:(NSArray<NSURL *> *)urls progress:(YYWebImagePrefetcherProgressBlock)progress completion:(YYWebImagePrefetcherCompletionBlock)completion {
+    urls = urls.copy;
+    dispatch_async(_queue, ^{
+        [self _cancelBatch];
+        for (NSURL *url in urls) {
+            if ([url isKindOfClass:[NSURL class]]) [_pendingURLs addObject:url];
+        }
+        _totalCount = _pendingURLs.count;
+        _progress = progress;
+        _completion = completion;
+        if (_totalCount == 0) {
+            [self _callCompletionCancelled:NO];
+        } else {
+            [self _startNext];
+        }
+    });
+}
+
+- (void)cancelAll {
+    dispatch_async(_queue, ^{
+        [self _cancelBatch];
+    });
+}
+
+#pragma mark - private (runs in _queue)
+
+- (void)_cancelBatch {
+    _batch++;
+    NSArray *operations = _runningOperations.copy;
+    [_runningOperations removeAllObjects];
+    [_pendingURLs removeAllObjects];
+    for (NSOperation *operation in operations) {
+        [operation cancel];
+    }
+    if (_totalCount > 0) [self _callCompletionCancelled:YES];
+}
+
+- (void)_startNext {
+    YYImageCache *cache = _manager.cache;
+    YYImageCacheType cacheType = self.storesDataOnly ? YYImageCacheTypeDisk : YYImageCacheTypeAll;
+    YYWebImageOptions options = self.options;
+    if (self.storesDataOnly) options |= YYWebImageOptionStoreDataOnly;
+    NSUInteger maxCount = self.maxConcurrentCount;
+    if (maxCount == 0) maxCount = 1;
+    
+    while (_runningOperations.count < maxCount && _pendingURLs.count > 0) {
+        NSURL *url = _pendingURLs.firstObject;
+        [_pendingURLs removeObjectAtIndex:0];
+    
+        NSString *key = [_manager cacheKeyForURL:url];
+        if (!key || (cache && [cache containsImageForKey:key withType:cacheType])) {
+            _skippedCount++;
+            [self _itemDidFinish];
+            continue;
+        }
+    
+        __weak typeof(self) _self = self;
+        // weak, the operation retains this completion block
+        __block __weak YYWebImageOperation *_operation = nil;
+        NSUInteger batch = _batch;
+        YYWebImageOperation *operation = [_manager requestImageWithURL:url options:options priority:self.priority progress:nil transform:nil completion:^(UIImage *image, NSURL *url, YYWebImageFromType from, YYWebImageStage stage, NSError *error) {
+            if (stage == YYWebImageStageProgress) return;
+            BOOL succeed = (stage == YYWebImageStageFinished) && !error && (image || (options & YYWebImageOptionStoreDataOnly));
+            __strong typeof(_self) self = _self;
+            if (!self) return;
+            dispatch_async(self->_queue, ^{
+                // runs after `_operation` is set, the operation is retained by `_runningOperations`
+                [self _operation:_operation didFinishInBatch:batch succeed:succeed];
+            });
+        }];
+        _operation = operation;
+        if (operation) {
+            [_runningOperations addObject:operation];
+        } else {
+            _failedCount++;
+            [self _itemDidFinish];
+        }
+    }
+}
+
+- (void)_operation:(YYWebImageOperation *)operation didFinishInBatch:(NSUInteger)batch succeed:(BOOL)succeed {
+    if (batch != _batch) return; // cancelled
+    NSUInteger index = [_runningOperations indexOfObjectIdenticalTo:operation];
+    if (index == NSNotFound) return;
+    [_runningOperations removeObjectAtIndex:index];
+    if (succeed) {
+        _finishedCount++;
+    } else {
+        _failedCount++;
+    }
+    [self _itemDidFinish];
+    [self _startNext];
+}
+
+- (void)_itemDidFinish {
+    NSUInteger done = _finishedCount + _skippedCount + _failedCount;
+    NSUInteger total = _totalCount;
+    YYWebImagePrefetcherProgressBlock progress = _progress;
+    if (progress) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            progress(done, total);
+        });
+    }
+    if (done == total) [self _callCompletionCancelled:NO];
+}
+
+- (void)_callCompletionCancelled:(BOOL)cancelled {
+    YYWebImagePrefetcherCompletionBlock completion = _completion;
+    NSUInteger finished = _finishedCount, skipped = _skippedCount, failed = _failedCount;
+    _progress = nil;
+    _completion = nil;
+    _totalCount = 0;
+    _finishedCount = 0;
+    _skippedCount = 0;
+    _failedCount = 0;
+    if (completion) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(finished, skipped, failed, cancelled);
+        });
+    }
+}
+
+@end
@@ -49,6 +49,7 @@ FOUNDATION_EXPORT const unsigned char YYKitVersionString[];
 
 #import <YYKit/CALayer+YYAdd.h>
 #import <YYKit/YYCGUtilities.h>
+#import <YYKit/YYBoxBlur.h>
 
 #import <YYKit/NSObject+YYModel.h>
 #import <YYKit/YYClassInfo.h>
@@ -56,6 +57,7 @@ FOUNDATION_EXPORT const unsigned char YYKitVersionString[];
 #import <YYKit/YYCache.h>
 #import <YYKit/YYMemoryCache.h>
 #import <YYKit/YYDiskCache.h>
+#import <YYKit/YYCacheStatistics.h>
 #import <YYKit/YYKVStorage.h>
 
 #import <YYKit/YYImage.h>
@@ -66,6 +68,8 @@ FOUNDATION_EXPORT const unsigned char YYKitVersionString[];
 #import <YYKit/YYImageCache.h>
 #import <YYKit/YYWebImageOperation.h>
 #import <YYKit/YYWebImageManager.h>
+#import <YYKit/YYWebImagePrefetcher.h>
+#import <YYKit/YYImagePipeline.h>
 #import <YYKit/UIImageView+YYWebImage.h>
 #import <YYKit/UIButton+YYWebImage.h>
 #import <YYKit/MKAnnotationView+YYWebImage.h>
@@ -140,6 +144,7 @@ FOUNDATION_EXPORT const unsigned char YYKitVersionString[];
 
 #import "CALayer+YYAdd.h"
 #import "YYCGUtilities.h"
+#import "YYBoxBlur.h"
 
 #import "NSObject+YYModel.h"
 #import "YYClassInfo.h"
@@ -147,6 +152,7 @@ FOUNDATION_EXPORT const unsigned char YYKitVersionString[];
 #import "YYCache.h"
 #import "YYMemoryCache.h"
 #import "YYDiskCache.h"
+#import "YYCacheStatistics.h"
 #import "YYKVStorage.h"
 
 #import "YYImage.h"
@@ -157,6 +163,8 @@ FOUNDATION_EXPORT const unsigned char YYKitVersionString[];
 #import "YYImageCache.h"
 #import "YYWebImageOperation.h"
 #import "YYWebImageManager.h"
+#import "YYWebImagePrefetcher.h"
+#import "YYImagePipeline.h"
 #import "UIImageView+YYWebImage.h"
 #import "UIButton+YYWebImage.h"
 #import "MKAnnotationView+YYWebImage.h"